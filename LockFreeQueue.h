@@ -22,6 +22,9 @@
  * SOFTWARE.
  */
 
+#include "platform.h"
+#include "stats.h"
+
 /**
  * Lock free queue for 1 writer and 1 reader threads.
  * 
@@ -39,8 +42,10 @@
  * To do this 2 separate locks should be introduced for writers and readers.
  * In this case writer will block other writers but not readers and other way around for readers.
  * This will give lock independence between writers and readers.
+ *
+ * Stats policy defines which counters are collected (see stats.h). By default nothing is collected.
  */
-template <class T>
+template <class T, class Stats = types::no_stats>
 class LockFreeQueue
 {
 public:
@@ -78,22 +83,37 @@ public:
      */
     bool IsWriterFinished() { return isWriterFinished; }
 
+    /**
+     * Current values of the counters.
+     */
+    types::queue_stats Snapshot() const { return Stats::snapshot(writerStats, readerStats); }
+
 private:
     T *readerTop    = nullptr;
     T *writerTop    = nullptr;
     T *writerBottom = nullptr;
 
+    // counters of each side are kept on their own cache line. Disabled counters are empty and are not aligned
+    // so they don't add any padding.
+    alignas(Stats::enabled ? TYPES_CACHE_LINE_SIZE : alignof(typename Stats::writer_side))
+        typename Stats::writer_side writerStats;
+    alignas(Stats::enabled ? TYPES_CACHE_LINE_SIZE : alignof(typename Stats::reader_side))
+        typename Stats::reader_side readerStats;
+
     bool isWriterFinished = false;
 };
 
-template<class T>
-bool LockFreeQueue<T>::Write(T* data)
+template<class T, class Stats>
+bool LockFreeQueue<T, Stats>::Write(T* data)
 {
     assert(!isWriterFinished);
     assert(data != nullptr);
 
     data->next = nullptr;
 
+    writerStats.on_write(1, writerTop == nullptr);
+    writerStats.on_depth(readerStats);
+
     if (writerTop != nullptr)
     {
         writerBottom->next = data;
@@ -106,6 +126,7 @@ bool LockFreeQueue<T>::Write(T* data)
 
     if (readerTop == nullptr) // reader don't have anything to read
     {
+        writerStats.on_handoff(readerStats);
         readerTop = writerTop; // give reader writer's queue
         writerTop = nullptr; // P1: start new writers queue
         return true;
@@ -113,8 +134,8 @@ bool LockFreeQueue<T>::Write(T* data)
     return false;
 }
 
-template<class T>
-bool LockFreeQueue<T>::Read(T*& data)
+template<class T, class Stats>
+bool LockFreeQueue<T, Stats>::Read(T*& data)
 {
     // If writer stoped in Write() method before command marked as P1 there could be 2 situations:
     // 1. If writer/reader threads/cpus became synchronized reader will not go inside a following 'if' and goes to the
@@ -135,10 +156,14 @@ bool LockFreeQueue<T>::Read(T*& data)
             writerTop = nullptr;
 
             if (readerTop == nullptr) // nothing to read
+            {
+                readerStats.on_empty_read();
                 return false;
+            }
         }
         else
         {
+            readerStats.on_empty_read();
             return false;
         }
     }
@@ -148,6 +173,7 @@ bool LockFreeQueue<T>::Read(T*& data)
     // Also we can garantee here that readerTop != nullptr
     data = readerTop;
     readerTop = data->next;
+    readerStats.on_read(1);
 
     return true;
 }
@@ -157,8 +183,8 @@ bool LockFreeQueue<T>::Read(T*& data)
  * its queue is not empty. In this case reader will not receive data from writers queue.
  * Calling of this method by writer will not influence of calling Read() method by reader.
  */
-template<class T>
-bool LockFreeQueue<T>::Flush()
+template<class T, class Stats>
+bool LockFreeQueue<T, Stats>::Flush()
 {
     assert(!isWriterFinished);
 
@@ -169,6 +195,7 @@ bool LockFreeQueue<T>::Flush()
 
     if (readerTop == nullptr)
     {
+        writerStats.on_handoff(readerStats);
         readerTop = writerTop;
         writerTop = nullptr;
         return true;
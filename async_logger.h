@@ -0,0 +1,581 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Oleg Khryptul aka HaronK
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef TYPES_ASYNC_LOGGER_H
+#define TYPES_ASYNC_LOGGER_H
+
+// NOTE: queue.h and node_pool.h should be included before this file.
+// Logger thread and lane registry use std::atomic directly and are not checked with Relacy Race Detector library.
+// Output uses POSIX open()/write().
+
+#include "platform.h"
+
+#include <atomic>
+#include <cassert>
+#include <cerrno>
+#include <chrono>
+#include <cstdio>
+#include <cstring>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <type_traits>
+#include <vector>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+namespace types
+{
+
+/**
+ * Binary log record. Arguments are stored raw and formatted by the logger thread.
+ */
+struct log_record
+{
+    static const std::size_t max_args = 8;
+    static const std::size_t text_capacity = 128; // bytes for copies of string arguments
+
+    struct arg
+    {
+        enum kind_type : std::uint8_t
+        {
+            signed_int,
+            unsigned_int,
+            floating,
+            character,
+            boolean,
+            pointer,
+            text // offset and size in record's text buffer
+        };
+
+        kind_type kind;
+        union
+        {
+            long long i;
+            unsigned long long u;
+            double d;
+            char c;
+            bool b;
+            const void *p;
+            struct
+            {
+                std::uint16_t offset;
+                std::uint16_t size;
+            } s;
+        };
+    };
+
+    // fields are filled by the writer, nothing is initialized here
+    log_record() {}
+
+    log_record *next;
+    const char *format;
+    std::uint64_t time_ns; // system clock
+    std::uint8_t count;
+    std::uint16_t text_size;
+    arg args[max_args];
+    char text[text_capacity];
+};
+
+/**
+ * Asynchronous logger. Calling threads only store a record, formatting and output are done by the logger thread.
+ *
+ * Each calling thread attaches its own producer which has a queue of records (1 writer, 1 reader) and a
+ * node_pool the records are taken from, so logging a message takes no locks and in a steady state no
+ * allocations: the record gets format string pointer, time stamp and raw arguments and is written to the
+ * queue. Logger thread polls the queues of all producers, formats records into a buffer and writes it with
+ * one write() call when the buffer is full or when there is nothing more to format. Records are returned to
+ * the pools in batches.
+ *
+ * Format string should be a string literal or live as long as the logger. Each `{}` in it is replaced by the
+ * next argument. Integers, floating point values, chars, bools and pointers are stored by value, strings
+ * (`const char*`, `std::string`) are copied to the record and truncated if the record is full.
+ * Messages of one producer are written in order, messages of different producers are ordered by the time
+ * they are seen by the logger thread and have their time stamps.
+ *
+ * If lane capacity is set then a message written to a full queue is dropped and counted.
+ * When the queues are empty the logger thread sleeps for idle_sleep, producers never wake it up.
+ *
+ * Producers should be destroyed before the logger. Logger's destructor writes all remaining messages of
+ * destroyed producers, lanes of the producers that are still alive are leaked and their messages are lost.
+ *
+ * Example:
+ *   async_logger logger("app.log");
+ *   auto log = logger.attach();                              // in each thread
+ *   log.log("order {} filled at {} by {}", id, price, name);
+ */
+class async_logger
+{
+    struct lane
+    {
+        explicit lane(std::size_t capacity)
+            : records(queue<log_record>::flush_policy(), queue<log_record>::capacity_policy(capacity)), pool(64)
+        {
+        }
+
+        ~lane()
+        {
+            records.clear([this](log_record *r) { pool.deallocate(r); });
+        }
+
+        queue<log_record> records;
+        node_pool<log_record> pool;
+
+        // set by the producer after its last access to the lane, logger deletes the lane only after that
+        std::atomic<bool> released{false};
+    };
+
+public:
+    /**
+     * Logger options.
+     */
+    struct options
+    {
+        options() : buffer_size(64 * 1024), lane_capacity(0), idle_sleep(1000) {}
+
+        std::size_t buffer_size;              // formatted bytes written at once
+        std::size_t lane_capacity;            // records per producer, 0 - unbounded
+        std::chrono::microseconds idle_sleep; // sleep of the logger thread when all lanes are empty
+    };
+
+    /**
+     * Write messages to the descriptor. Descriptor is not closed by the logger.
+     */
+    explicit async_logger(int fd = STDOUT_FILENO, const options &opts = options())
+        : fd(fd), owns_fd(false), config(opts)
+    {
+        start();
+    }
+
+    /**
+     * Append messages to the file. If it can't be opened messages are discarded and error() is set.
+     */
+    explicit async_logger(const char *path, const options &opts = options())
+        : fd(::open(path, O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC, 0644)), owns_fd(true), config(opts)
+    {
+        if (fd < 0)
+        {
+            last_error.store(errno, std::memory_order_relaxed);
+        }
+        start();
+    }
+
+    ~async_logger()
+    {
+        stopping.store(true, std::memory_order_release);
+        worker.join();
+
+        if (owns_fd && fd >= 0)
+        {
+            ::close(fd);
+        }
+    }
+
+    async_logger(const async_logger&) = delete;
+    async_logger& operator=(const async_logger&) = delete;
+
+    /**
+     * Logging interface of one thread.
+     */
+    class producer
+    {
+    public:
+        producer(producer &&other) : l(other.l), drops(other.drops)
+        {
+            other.l = nullptr;
+        }
+
+        ~producer()
+        {
+            if (l != nullptr)
+            {
+                l->records.set_writer_finished();
+                l->released.store(true, std::memory_order_release);
+            }
+        }
+
+        producer(const producer&) = delete;
+        producer& operator=(const producer&) = delete;
+
+        /**
+         * Store the message. Formatting and output are done by the logger thread.
+         *
+         * @return true if message was written otherwise false (lane is full, message is dropped).
+         */
+        template<class... Args>
+        bool log(const char *format, const Args&... args)
+        {
+            static_assert(sizeof...(Args) <= log_record::max_args, "Too many arguments of a log message");
+
+            auto r = l->pool.allocate();
+            r->format    = format;
+            r->time_ns   = std::chrono::duration_cast<std::chrono::nanoseconds>(
+                std::chrono::system_clock::now().time_since_epoch()).count();
+            r->count     = 0;
+            r->text_size = 0;
+
+            int expand[] = {0, (encode(*r, args), 0)...};
+            (void) expand;
+
+            if (l->records.try_write(r) == queue<log_record>::write_result::written)
+            {
+                return true;
+            }
+
+            l->pool.deallocate(r);
+            drops++;
+            return false;
+        }
+
+        /**
+         * Number of messages dropped because the lane was full.
+         */
+        std::size_t dropped() const
+        {
+            return drops;
+        }
+
+    private:
+        friend class async_logger;
+
+        explicit producer(lane *l) : l(l), drops(0) {}
+
+        template<class T>
+        static typename std::enable_if<std::is_integral<T>::value && std::is_signed<T>::value &&
+                                       !std::is_same<T, char>::value>::type
+        encode(log_record &r, T value)
+        {
+            auto &a = r.args[r.count++];
+            a.kind = log_record::arg::signed_int;
+            a.i    = value;
+        }
+
+        template<class T>
+        static typename std::enable_if<std::is_integral<T>::value && std::is_unsigned<T>::value &&
+                                       !std::is_same<T, bool>::value && !std::is_same<T, char>::value>::type
+        encode(log_record &r, T value)
+        {
+            auto &a = r.args[r.count++];
+            a.kind = log_record::arg::unsigned_int;
+            a.u    = value;
+        }
+
+        template<class T>
+        static typename std::enable_if<std::is_floating_point<T>::value>::type encode(log_record &r, T value)
+        {
+            auto &a = r.args[r.count++];
+            a.kind = log_record::arg::floating;
+            a.d    = value;
+        }
+
+        static void encode(log_record &r, char value)
+        {
+            auto &a = r.args[r.count++];
+            a.kind = log_record::arg::character;
+            a.c    = value;
+        }
+
+        static void encode(log_record &r, bool value)
+        {
+            auto &a = r.args[r.count++];
+            a.kind = log_record::arg::boolean;
+            a.b    = value;
+        }
+
+        template<class T>
+        static void encode(log_record &r, const T *value)
+        {
+            auto &a = r.args[r.count++];
+            a.kind = log_record::arg::pointer;
+            a.p    = value;
+        }
+
+        static void encode(log_record &r, const char *value)
+        {
+            encode_text(r, value != nullptr ? value : "(null)", value != nullptr ? std::strlen(value) : 6);
+        }
+
+        static void encode(log_record &r, char *value)
+        {
+            encode(r, static_cast<const char*>(value));
+        }
+
+        template<std::size_t N>
+        static void encode(log_record &r, const char (&value)[N])
+        {
+            encode_text(r, value, std::strlen(value));
+        }
+
+        static void encode(log_record &r, const std::string &value)
+        {
+            encode_text(r, value.data(), value.size());
+        }
+
+        static void encode_text(log_record &r, const char *value, std::size_t size)
+        {
+            size = std::min(size, log_record::text_capacity - r.text_size);
+            std::memcpy(r.text + r.text_size, value, size);
+
+            auto &a = r.args[r.count++];
+            a.kind     = log_record::arg::text;
+            a.s.offset = r.text_size;
+            a.s.size   = static_cast<std::uint16_t>(size);
+
+            r.text_size += static_cast<std::uint16_t>(size);
+        }
+
+        lane *l;
+        std::size_t drops;
+    };
+
+    /**
+     * Create producer for the calling thread. Takes a lock, so it should be done once per thread.
+     * Producer must be destroyed before the logger. Otherwise its messages after the logger's destruction
+     * are lost and its lane is never freed.
+     */
+    producer attach()
+    {
+        auto l = new lane(config.lane_capacity);
+        {
+            std::lock_guard<std::mutex> lock(lanes_lock);
+            added_lanes.push_back(l);
+        }
+        has_added_lanes.store(true, std::memory_order_release);
+
+        return producer(l);
+    }
+
+    /**
+     * Errno of the failed open() or write() call, 0 if there was no error.
+     */
+    int error() const
+    {
+        return last_error.load(std::memory_order_relaxed);
+    }
+
+    /**
+     * Append formatted record to the string: time stamp in seconds with microseconds and the message.
+     */
+    static void format(const log_record &r, std::string &out);
+
+private:
+    void start()
+    {
+        worker = std::thread([this] { run(); });
+    }
+
+    void run();
+    std::size_t poll(std::vector<lane*> &lanes, std::string &out);
+    void write_out(std::string &out);
+
+    static void format_arg(const log_record &r, const log_record::arg &a, std::string &out);
+
+    const int fd;
+    const bool owns_fd;
+    const options config;
+
+    std::mutex lanes_lock;
+    std::vector<lane*> added_lanes;
+    std::atomic<bool> has_added_lanes{false};
+
+    std::atomic<bool> stopping{false};
+    std::atomic<int> last_error{0};
+
+    std::thread worker;
+};
+
+/*
+ * Logger thread. Polls the lanes until the logger is stopped and all lanes are empty.
+ */
+inline void async_logger::run()
+{
+    std::vector<lane*> lanes;
+    std::string out;
+    out.reserve(config.buffer_size + 1024);
+
+    for (;;)
+    {
+        // producers' writes happen before the stop, so the lanes are read to the end after it is seen
+        bool stop = stopping.load(std::memory_order_acquire);
+
+        if (has_added_lanes.load(std::memory_order_acquire))
+        {
+            std::lock_guard<std::mutex> lock(lanes_lock);
+            lanes.insert(lanes.end(), added_lanes.begin(), added_lanes.end());
+            added_lanes.clear();
+            has_added_lanes.store(false, std::memory_order_relaxed);
+        }
+
+        if (poll(lanes, out) != 0)
+        {
+            continue;
+        }
+
+        if (!out.empty())
+        {
+            write_out(out);
+        }
+
+        if (stop)
+        {
+            break;
+        }
+
+        std::this_thread::sleep_for(config.idle_sleep);
+    }
+
+    // producers should be destroyed before the logger. Lane of a producer that is still alive is leaked:
+    // the producer keeps writing to it and sets its released flag when it is destroyed.
+    assert(lanes.empty());
+    for (auto l : lanes)
+    {
+        if (l->released.load(std::memory_order_acquire))
+        {
+            delete l;
+        }
+    }
+}
+
+/*
+ * Format records of all lanes. Lanes of finished producers are deleted after their last records.
+ */
+inline std::size_t async_logger::poll(std::vector<lane*> &lanes, std::string &out)
+{
+    std::size_t count = 0;
+
+    for (std::size_t i = 0; i < lanes.size(); )
+    {
+        auto l = lanes[i];
+        // writer_finished flag is not enough: the producer still touches the queue after setting it
+        bool finished = l->released.load(std::memory_order_acquire);
+
+        // drain() takes one segment, the last segments of a finished producer are taken in a loop
+        for (;;)
+        {
+            node_pool<log_record>::return_batch batch(l->pool, 64);
+            auto n = l->records.drain([&](log_record *r)
+            {
+                format(*r, out);
+                batch.deallocate(r);
+
+                if (out.size() >= config.buffer_size)
+                {
+                    write_out(out);
+                }
+            });
+
+            count += n;
+            if (n == 0 || !finished)
+            {
+                break;
+            }
+        }
+
+        if (finished)
+        {
+            lanes[i] = lanes.back();
+            lanes.pop_back();
+            delete l;
+        }
+        else
+        {
+            ++i;
+        }
+    }
+
+    return count;
+}
+
+inline void async_logger::write_out(std::string &out)
+{
+    if (fd >= 0)
+    {
+        const char *data = out.data();
+        std::size_t size = out.size();
+        while (size > 0)
+        {
+            auto n = ::write(fd, data, size);
+            if (n < 0)
+            {
+                if (errno == EINTR)
+                {
+                    continue;
+                }
+                last_error.store(errno, std::memory_order_relaxed);
+                break;
+            }
+            data += n;
+            size -= static_cast<std::size_t>(n);
+        }
+    }
+
+    out.clear();
+}
+
+inline void async_logger::format(const log_record &r, std::string &out)
+{
+    char stamp[32];
+    auto n = std::snprintf(stamp, sizeof(stamp), "%llu.%06llu ",
+                           static_cast<unsigned long long>(r.time_ns / 1000000000),
+                           static_cast<unsigned long long>(r.time_ns % 1000000000 / 1000));
+    out.append(stamp, n);
+
+    std::size_t next_arg = 0;
+    const char *p = r.format;
+    for (const char *s = p; *s != '\0'; ++s)
+    {
+        if (s[0] == '{' && s[1] == '}' && next_arg < r.count)
+        {
+            out.append(p, s - p);
+            format_arg(r, r.args[next_arg++], out);
+            p = ++s + 1;
+        }
+    }
+    out.append(p);
+    out.push_back('\n');
+}
+
+inline void async_logger::format_arg(const log_record &r, const log_record::arg &a, std::string &out)
+{
+    char buf[32];
+    int n = 0;
+
+    switch (a.kind)
+    {
+    case log_record::arg::signed_int:   n = std::snprintf(buf, sizeof(buf), "%lld", a.i); break;
+    case log_record::arg::unsigned_int: n = std::snprintf(buf, sizeof(buf), "%llu", a.u); break;
+    case log_record::arg::floating:     n = std::snprintf(buf, sizeof(buf), "%g", a.d);   break;
+    case log_record::arg::pointer:      n = std::snprintf(buf, sizeof(buf), "%p", a.p);   break;
+    case log_record::arg::character:    out.push_back(a.c);                               return;
+    case log_record::arg::boolean:      out.append(a.b ? "true" : "false");               return;
+    case log_record::arg::text:         out.append(r.text + a.s.offset, a.s.size);        return;
+    }
+
+    out.append(buf, n);
+}
+
+} // namespace types
+
+#endif // TYPES_ASYNC_LOGGER_H
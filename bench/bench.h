@@ -0,0 +1,449 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Oleg Khryptul aka HaronK
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// Common helpers for the benchmarks in this directory: timing, latency percentiles,
+// thread pinning, command line parsing and CSV/JSON reporting.
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <sstream>
+#include <string>
+#include <thread>
+#include <vector>
+
+#ifdef __linux__
+#include <pthread.h>
+#include <sched.h>
+#endif
+
+namespace bench
+{
+
+inline std::uint64_t now_ns()
+{
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(
+        std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+/**
+ * Pin calling thread to the cpu. Cpu index is wrapped around the number of available cpus.
+ *
+ * @return true if thread was pinned otherwise false.
+ */
+inline bool pin_thread(int cpu)
+{
+#ifdef __linux__
+    auto cpus = std::thread::hardware_concurrency();
+    if (cpu < 0 || cpus == 0)
+        return false;
+
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu % cpus, &set);
+    return pthread_setaffinity_np(pthread_self(), sizeof(set), &set) == 0;
+#else
+    (void) cpu;
+    return false;
+#endif
+}
+
+/**
+ * Collects latency samples and calculates percentiles.
+ */
+class latency_recorder
+{
+public:
+    void reserve(std::size_t n)
+    {
+        samples.reserve(n);
+    }
+
+    void add(std::uint64_t ns)
+    {
+        samples.push_back(ns);
+    }
+
+    void merge(const latency_recorder &other)
+    {
+        samples.insert(samples.end(), other.samples.begin(), other.samples.end());
+    }
+
+    /**
+     * @param p Percentile in [0, 100] range.
+     * @return latency in nanoseconds.
+     */
+    std::uint64_t percentile(double p)
+    {
+        if (samples.empty())
+            return 0;
+
+        auto idx = static_cast<std::size_t>(p / 100.0 * (samples.size() - 1));
+        std::nth_element(samples.begin(), samples.begin() + idx, samples.end());
+        return samples[idx];
+    }
+
+private:
+    std::vector<std::uint64_t> samples;
+};
+
+/**
+ * One benchmark result.
+ * Mode is a text label of the variant, metric is a benchmark specific number described by the benchmark.
+ */
+struct result
+{
+    std::string name;
+    std::string mode;
+    std::size_t payload   = 0;
+    int producers         = 0;
+    int consumers         = 0;
+    bool pinned           = false;
+    std::uint64_t items   = 0;
+    double seconds        = 0;
+    std::uint64_t p50     = 0;
+    std::uint64_t p99     = 0;
+    std::uint64_t p999    = 0;
+    double metric         = 0;
+
+    double ops_per_sec() const
+    {
+        return seconds > 0 ? items / seconds : 0;
+    }
+
+    void set_latency(latency_recorder &lat)
+    {
+        p50  = lat.percentile(50);
+        p99  = lat.percentile(99);
+        p999 = lat.percentile(99.9);
+    }
+};
+
+/**
+ * Command line options shared by all benchmarks.
+ *
+ *   --items <n>            number of items per run
+ *   --runs <n>             number of runs; the best run is reported
+ *   --format <csv|json>    output format
+ *   --out <file>           output file (stdout by default)
+ *   --pin <0|1|both>       thread pinning mode
+ *   --payloads <a,b,...>   payload sizes in bytes
+ *   --threads <PxC,...>    producer x consumer combinations
+ *   --cpus <a,b,...>       cpus used for pinning, in thread start order
+ */
+struct options
+{
+    std::uint64_t items = 200000;
+    int runs            = 1;
+    std::string format  = "csv";
+    std::string out;
+    std::vector<bool> pin = {false, true};
+    std::vector<std::size_t> payloads = {8, 64, 256, 1024};
+    std::vector<std::pair<int, int>> threads = {{1, 1}, {2, 1}, {2, 2}, {4, 4}};
+    std::vector<int> cpus;
+
+    bool parse(int argc, const char* argv[])
+    {
+        for (int i = 1; i < argc; ++i)
+        {
+            std::string arg = argv[i];
+            if (i + 1 >= argc)
+                return false;
+
+            std::string value = argv[++i];
+            if (arg == "--items")
+                items = std::stoull(value);
+            else if (arg == "--runs")
+                runs = std::max(1, std::stoi(value));
+            else if (arg == "--format")
+                format = value;
+            else if (arg == "--out")
+                out = value;
+            else if (arg == "--pin")
+                pin = value == "both" ? std::vector<bool>{false, true} : std::vector<bool>{value == "1"};
+            else if (arg == "--payloads")
+                payloads = parse_list<std::size_t>(value);
+            else if (arg == "--cpus")
+                cpus = parse_list<int>(value);
+            else if (arg == "--threads")
+            {
+                threads.clear();
+                for (auto &t : split(value))
+                {
+                    auto x = t.find('x');
+                    if (x == std::string::npos)
+                        return false;
+                    threads.emplace_back(std::stoi(t.substr(0, x)), std::stoi(t.substr(x + 1)));
+                }
+            }
+            else
+                return false;
+        }
+        return format == "csv" || format == "json";
+    }
+
+    /**
+     * Cpu for the thread with the given start index.
+     */
+    int cpu(int index) const
+    {
+        return cpus.empty() ? index : cpus[index % cpus.size()];
+    }
+
+    static void usage(const char *name)
+    {
+        std::cout << "Usage: " << name << " [--items <n>] [--runs <n>] [--format <csv|json>] [--out <file>]\n"
+                     "       [--pin <0|1|both>] [--payloads <a,b,...>] [--threads <PxC,...>] [--cpus <a,b,...>]\n";
+    }
+
+private:
+    static std::vector<std::string> split(const std::string &s)
+    {
+        std::vector<std::string> parts;
+        std::stringstream ss(s);
+        std::string part;
+        while (std::getline(ss, part, ','))
+        {
+            if (!part.empty())
+                parts.push_back(part);
+        }
+        return parts;
+    }
+
+    template<class T>
+    static std::vector<T> parse_list(const std::string &s)
+    {
+        std::vector<T> values;
+        for (auto &part : split(s))
+            values.push_back(static_cast<T>(std::stoll(part)));
+        return values;
+    }
+};
+
+/**
+ * Writes results in CSV or JSON format.
+ */
+class report
+{
+public:
+    explicit report(const options &opts) : opts(opts) {}
+
+    /**
+     * Run benchmark function opts.runs times and keep the fastest result.
+     */
+    template<class Function>
+    void run(Function f)
+    {
+        result best;
+        for (int i = 0; i < opts.runs; ++i)
+        {
+            auto r = f();
+            if (i == 0 || r.seconds < best.seconds)
+                best = r;
+        }
+        results.push_back(best);
+
+        std::cerr << best.name << " " << best.mode << " payload=" << best.payload << " " << best.producers << "x"
+                  << best.consumers << (best.pinned ? " pinned" : "") << ": " << static_cast<std::uint64_t>(best.ops_per_sec())
+                  << " ops/s, p50=" << best.p50 << "ns p99=" << best.p99 << "ns p99.9=" << best.p999 << "ns metric=" << best.metric
+                  << "\n";
+    }
+
+    void write() const
+    {
+        if (opts.out.empty())
+        {
+            write(std::cout);
+        }
+        else
+        {
+            std::ofstream f(opts.out);
+            write(f);
+        }
+    }
+
+private:
+    void write(std::ostream &o) const
+    {
+        if (opts.format == "json")
+        {
+            o << "[\n";
+            for (std::size_t i = 0; i < results.size(); ++i)
+            {
+                auto &r = results[i];
+                o << "  {\"name\": \"" << r.name << "\", \"mode\": \"" << r.mode << "\", \"payload\": " << r.payload
+                  << ", \"producers\": " << r.producers << ", \"consumers\": " << r.consumers
+                  << ", \"pinned\": " << (r.pinned ? "true" : "false") << ", \"items\": " << r.items
+                  << ", \"seconds\": " << r.seconds << ", \"ops_per_sec\": " << r.ops_per_sec()
+                  << ", \"p50_ns\": " << r.p50 << ", \"p99_ns\": " << r.p99 << ", \"p999_ns\": " << r.p999
+                  << ", \"metric\": " << r.metric << "}"
+                  << (i + 1 < results.size() ? "," : "") << "\n";
+            }
+            o << "]\n";
+        }
+        else
+        {
+            o << "name,mode,payload,producers,consumers,pinned,items,seconds,ops_per_sec,p50_ns,p99_ns,p999_ns,metric\n";
+            for (auto &r : results)
+            {
+                o << r.name << "," << r.mode << "," << r.payload << "," << r.producers << "," << r.consumers << ","
+                  << r.pinned << "," << r.items << "," << r.seconds << "," << r.ops_per_sec() << "," << r.p50 << ","
+                  << r.p99 << "," << r.p999 << "," << r.metric << "\n";
+            }
+        }
+    }
+
+    const options &opts;
+    std::vector<result> results;
+};
+
+/**
+ * Queue element with N bytes of payload and the time when it was written.
+ */
+template<std::size_t N>
+struct payload
+{
+    payload() : next(nullptr), stamp(0) {}
+
+    payload *next;
+    std::uint64_t stamp;
+    char data[N];
+};
+
+/**
+ * Payload for queues linked by several writers concurrently (mpsc_queue).
+ */
+template<std::size_t N>
+struct atomic_payload
+{
+    atomic_payload() : next(nullptr), stamp(0) {}
+
+    std::atomic<atomic_payload*> next;
+    std::uint64_t stamp;
+    char data[N];
+};
+
+/**
+ * Run producers and consumers in separate threads.
+ * Nodes are preallocated so only the queue itself is measured.
+ * Write function has signature void(int producer, Node*) and read function bool(int consumer, Node*&).
+ * Threads are pinned in start order: producers first, then consumers.
+ */
+template<class Node, class Write, class Read>
+result run_threaded(const char *name, const options &opts, int producers, int consumers, bool pinned,
+                    Write write, Read read)
+{
+    auto per_producer = opts.items / producers;
+    auto total        = per_producer * producers;
+
+    std::vector<Node> nodes(total);
+    std::vector<latency_recorder> latencies(consumers);
+    std::atomic<std::uint64_t> consumed(0);
+    std::atomic<int> ready(0);
+    std::atomic<bool> go(false);
+
+    auto start_barrier = [&](int index)
+    {
+        if (pinned)
+            pin_thread(opts.cpu(index));
+        ready.fetch_add(1);
+        while (!go.load(std::memory_order_acquire))
+            std::this_thread::yield();
+    };
+
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; ++p)
+    {
+        threads.emplace_back([&, p]
+        {
+            start_barrier(p);
+
+            auto first = nodes.data() + p * per_producer;
+            for (std::uint64_t i = 0; i < per_producer; ++i)
+            {
+                first[i].stamp = now_ns();
+                write(p, &first[i]);
+            }
+        });
+    }
+    for (int c = 0; c < consumers; ++c)
+    {
+        threads.emplace_back([&, c]
+        {
+            start_barrier(producers + c);
+
+            auto &lat = latencies[c];
+            lat.reserve(total / consumers);
+
+            std::uint64_t local = 0;
+            Node *node = nullptr;
+            for (;;)
+            {
+                if (read(c, node))
+                {
+                    lat.add(now_ns() - node->stamp);
+                    local++;
+                    continue;
+                }
+
+                if (consumed.fetch_add(local) + local >= total)
+                    break;
+                local = 0;
+                std::this_thread::yield();
+            }
+        });
+    }
+
+    while (ready.load() != producers + consumers)
+        std::this_thread::yield();
+
+    auto start = now_ns();
+    go.store(true, std::memory_order_release);
+    for (auto &t : threads)
+        t.join();
+    auto finish = now_ns();
+
+    result r;
+    r.name      = name;
+    r.mode      = "threads";
+    r.payload   = sizeof(Node::data);
+    r.producers = producers;
+    r.consumers = consumers;
+    r.pinned    = pinned;
+    r.items     = total;
+    r.seconds   = (finish - start) / 1e9;
+
+    latency_recorder all;
+    for (auto &lat : latencies)
+        all.merge(lat);
+    r.set_latency(all);
+
+    return r;
+}
+
+} // namespace bench
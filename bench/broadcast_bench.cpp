@@ -0,0 +1,191 @@
+
+#include <atomic>
+#include <cassert>
+#include <memory>
+#include <thread>
+#include <vector>
+
+using namespace std;
+
+#include "ring_queue.h"
+#include "broadcast_queue.h"
+
+#include "bench.h"
+
+static const std::size_t capacity = 1024;
+
+/*
+ * Message passed by value: write time stamp and payload.
+ */
+template<std::size_t N>
+struct message
+{
+    std::uint64_t stamp = 0;
+    char data[N];
+};
+
+/*
+ * One writer sends every item to every reader. Latency is measured from write to read in each reader.
+ * Write function has signature bool(const Message&) and returns false if the item should be written again,
+ * read function has signature bool(int reader, Message&).
+ */
+template<class Message, class Write, class Read>
+bench::result run_fan_out(const char *name, const bench::options &opts, int readers, bool pinned,
+                          Write write, Read read)
+{
+    std::vector<bench::latency_recorder> latencies(readers);
+    std::atomic<int> ready(0);
+    std::atomic<bool> go(false);
+
+    auto start_barrier = [&](int index)
+    {
+        if (pinned)
+            bench::pin_thread(opts.cpu(index));
+        ready.fetch_add(1);
+        while (!go.load(std::memory_order_acquire))
+            std::this_thread::yield();
+    };
+
+    std::vector<std::thread> threads;
+    threads.emplace_back([&]
+    {
+        start_barrier(0);
+
+        Message m;
+        for (std::uint64_t i = 0; i < opts.items; ++i)
+        {
+            m.stamp = bench::now_ns();
+            while (!write(m))
+                std::this_thread::yield();
+        }
+    });
+    for (int r = 0; r < readers; ++r)
+    {
+        threads.emplace_back([&, r]
+        {
+            start_barrier(1 + r);
+
+            auto &lat = latencies[r];
+            lat.reserve(opts.items);
+
+            Message m;
+            for (std::uint64_t i = 0; i < opts.items; )
+            {
+                if (read(r, m))
+                {
+                    lat.add(bench::now_ns() - m.stamp);
+                    i++;
+                }
+                else
+                {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+
+    while (ready.load() != readers + 1)
+        std::this_thread::yield();
+
+    auto start = bench::now_ns();
+    go.store(true, std::memory_order_release);
+    for (auto &t : threads)
+        t.join();
+    auto finish = bench::now_ns();
+
+    bench::latency_recorder all;
+    for (auto &lat : latencies)
+        all.merge(lat);
+
+    bench::result r;
+    r.name      = name;
+    r.mode      = "fan_out";
+    r.payload   = sizeof(Message::data);
+    r.producers = 1;
+    r.consumers = readers;
+    r.pinned    = pinned;
+    r.items     = opts.items;
+    r.seconds   = (finish - start) / 1e9;
+    r.set_latency(all);
+
+    return r;
+}
+
+template<std::size_t N>
+void run_payload(bench::report &report, const bench::options &opts)
+{
+    using Message = message<N>;
+    using Broadcast = types::broadcast_queue<Message, capacity>;
+    using Ring = types::ring_queue<Message, capacity>;
+
+    for (auto pinned : opts.pin)
+    {
+        for (auto &t : opts.threads)
+        {
+            int readers = t.second;
+
+            report.run([&]
+            {
+                std::unique_ptr<Broadcast> q(new Broadcast(readers));
+                return run_fan_out<Message>("broadcast_queue", opts, readers, pinned,
+                                            [&](const Message &m) { return q->write(m); },
+                                            [&](int r, Message &m) { return q->read(r, m); });
+            });
+
+            // the same fan-out with a copy of each message in a ring_queue per reader
+            report.run([&]
+            {
+                std::vector<std::unique_ptr<Ring>> rings;
+                for (int r = 0; r < readers; ++r)
+                    rings.emplace_back(new Ring());
+
+                std::size_t next = 0; // first ring that didn't get the current message
+                return run_fan_out<Message>("ring_queue_per_reader", opts, readers, pinned,
+                                            [&](const Message &m)
+                                            {
+                                                for (; next < rings.size(); ++next)
+                                                {
+                                                    if (!rings[next]->write(m))
+                                                        return false;
+                                                }
+                                                next = 0;
+                                                return true;
+                                            },
+                                            [&](int r, Message &m) { return rings[r]->read(m); });
+            });
+        }
+    }
+}
+
+int main(int argc, const char* argv[])
+{
+    bench::options opts;
+    opts.threads  = {{1, 1}, {1, 2}, {1, 4}, {1, 8}};
+    opts.payloads = {8, 64};
+
+    if (!opts.parse(argc, argv))
+    {
+        bench::options::usage(argv[0]);
+        return 1;
+    }
+
+    bench::report report(opts);
+
+    // producers in --threads option are ignored, there is always one writer
+    for (auto payload : opts.payloads)
+    {
+        switch (payload)
+        {
+        case 8:    run_payload<8>(report, opts);    break;
+        case 64:   run_payload<64>(report, opts);   break;
+        case 256:  run_payload<256>(report, opts);  break;
+        default:
+            std::cerr << "Unsupported payload size " << payload << ", use one of: 8, 64, 256\n";
+            return 1;
+        }
+    }
+
+    report.write();
+
+    return 0;
+}
@@ -0,0 +1,109 @@
+
+#include <atomic>
+#include <cassert>
+#include <fstream>
+#include <memory>
+#include <thread>
+
+using namespace std;
+
+#include "queue.h"
+
+#include "bench.h"
+
+/*
+ * Cpu topology from sysfs. Returns -1 if it is not available.
+ */
+int read_topology(int cpu, const char *name)
+{
+    std::ifstream f("/sys/devices/system/cpu/cpu" + std::to_string(cpu) + "/topology/" + name);
+    int value = -1;
+    f >> value;
+    return value;
+}
+
+/*
+ * Find pairs of cpus for the writer and reader threads:
+ * - "core": different cores of the same socket;
+ * - "socket": different sockets.
+ * Cpus passed with --cpus are used as is.
+ */
+std::vector<std::pair<std::string, std::vector<int>>> cpu_pairs(const bench::options &opts)
+{
+    std::vector<std::pair<std::string, std::vector<int>>> pairs;
+    if (!opts.cpus.empty())
+    {
+        pairs.emplace_back("custom", opts.cpus);
+        return pairs;
+    }
+
+    int cpus = std::thread::hardware_concurrency();
+    int package0 = read_topology(0, "physical_package_id");
+    int core0    = read_topology(0, "core_id");
+
+    int same_socket = -1, other_socket = -1;
+    for (int cpu = 1; cpu < cpus; ++cpu)
+    {
+        int package = read_topology(cpu, "physical_package_id");
+        int core    = read_topology(cpu, "core_id");
+
+        if (same_socket < 0 && package == package0 && core != core0)
+            same_socket = cpu;
+        if (other_socket < 0 && package != package0)
+            other_socket = cpu;
+    }
+
+    if (same_socket > 0)
+        pairs.emplace_back("core", std::vector<int>{0, same_socket});
+    else
+        std::cerr << "No second core found, producer and consumer share the cpu.\n";
+    if (other_socket > 0)
+        pairs.emplace_back("socket", std::vector<int>{0, other_socket});
+    if (pairs.empty())
+        pairs.emplace_back("shared", std::vector<int>{0, 0});
+
+    return pairs;
+}
+
+template<class Layout>
+void run_layout(bench::report &report, const bench::options &opts, const char *name, const std::string &placement)
+{
+    using Node  = bench::payload<8>;
+    using Queue = types::queue<Node, Layout>;
+
+    report.run([&]
+    {
+        Queue q;
+        auto r = bench::run_threaded<Node>(name, opts, 1, 1, true,
+                                           [&](int, Node *n) { q.write(n); },
+                                           [&](int, Node *&n) { return q.read(n); });
+        r.mode = placement;
+        return r;
+    });
+}
+
+int main(int argc, const char* argv[])
+{
+    bench::options opts;
+    opts.items = 2000000;
+    if (!opts.parse(argc, argv))
+    {
+        bench::options::usage(argv[0]);
+        return 1;
+    }
+
+    bench::report report(opts);
+
+    for (auto &pair : cpu_pairs(opts))
+    {
+        auto pair_opts = opts;
+        pair_opts.cpus = pair.second;
+
+        run_layout<types::compact_layout>(report, pair_opts, "compact", pair.first);
+        run_layout<types::cache_aligned_layout>(report, pair_opts, "cache_aligned", pair.first);
+    }
+
+    report.write();
+
+    return 0;
+}
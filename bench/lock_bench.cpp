@@ -0,0 +1,106 @@
+
+#include <atomic>
+#include <cassert>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+using namespace std;
+
+#include "locks.h"
+#include "combining_guard.h"
+#include "queue.h"
+#include "writer.h"
+#include "guard.h"
+
+#include "bench.h"
+
+/*
+ * Producers write to one queue through guard<writer<queue>, Lock>, one consumer reads without a lock.
+ * Queue is drained completely by every run so nothing is left for the queue destructor.
+ */
+template<class Node, class Lock>
+void run_lock(bench::report &report, const bench::options &opts, const char *name, int producers, bool pinned)
+{
+    using Queue = types::queue<Node>;
+
+    report.run([&]
+    {
+        auto q = std::make_shared<Queue>();
+        types::guard<types::writer<Queue>, Lock> gw(q);
+        return bench::run_threaded<Node>(name, opts, producers, 1, pinned,
+                                         [&](int, Node *n) { gw->write(n); },
+                                         [&](int, Node *&n) { return q->read(n); });
+    });
+}
+
+/*
+ * The same with combining_guard<writer<queue>>.
+ */
+template<class Node>
+void run_combining(bench::report &report, const bench::options &opts, int producers, bool pinned)
+{
+    using Queue  = types::queue<Node>;
+    using Writer = types::writer<Queue>;
+
+    report.run([&]
+    {
+        auto q = std::make_shared<Queue>();
+        std::unique_ptr<types::combining_guard<Writer>> cw(new types::combining_guard<Writer>(q));
+        return bench::run_threaded<Node>("combining_guard", opts, producers, 1, pinned,
+                                         [&](int, Node *n) { cw->with([n](Writer &w) { w.write(n); }); },
+                                         [&](int, Node *&n) { return q->read(n); });
+    });
+}
+
+template<std::size_t N>
+void run_payload(bench::report &report, const bench::options &opts)
+{
+    using Node = bench::payload<N>;
+
+    for (auto pinned : opts.pin)
+    {
+        for (auto &t : opts.threads)
+        {
+            run_lock<Node, std::mutex>(report, opts, "std::mutex", t.first, pinned);
+            run_lock<Node, types::ttas_spinlock>(report, opts, "ttas_spinlock", t.first, pinned);
+            run_lock<Node, types::ticket_lock>(report, opts, "ticket_lock", t.first, pinned);
+            run_lock<Node, types::mcs_lock>(report, opts, "mcs_lock", t.first, pinned);
+            run_lock<Node, types::adaptive_mutex>(report, opts, "adaptive_mutex", t.first, pinned);
+            run_combining<Node>(report, opts, t.first, pinned);
+        }
+    }
+}
+
+int main(int argc, const char* argv[])
+{
+    bench::options opts;
+    opts.payloads = {8};
+    opts.threads  = {{2, 1}, {4, 1}, {8, 1}, {16, 1}, {32, 1}, {64, 1}};
+
+    if (!opts.parse(argc, argv))
+    {
+        bench::options::usage(argv[0]);
+        return 1;
+    }
+
+    bench::report report(opts);
+
+    for (auto payload : opts.payloads)
+    {
+        switch (payload)
+        {
+        case 8:    run_payload<8>(report, opts);    break;
+        case 64:   run_payload<64>(report, opts);   break;
+        case 256:  run_payload<256>(report, opts);  break;
+        case 1024: run_payload<1024>(report, opts); break;
+        default:
+            std::cerr << "Unsupported payload size " << payload << ", use one of: 8, 64, 256, 1024\n";
+            return 1;
+        }
+    }
+
+    report.write();
+
+    return 0;
+}
@@ -0,0 +1,187 @@
+
+#include <atomic>
+#include <cassert>
+#include <cstdio>
+#include <fstream>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include <unistd.h>
+
+using namespace std;
+
+#include "queue.h"
+#include "node_pool.h"
+#include "async_logger.h"
+
+#include "bench.h"
+
+/*
+ * Each producer logs its share of opts.items messages with an integer, a floating point and a string argument.
+ * Throughput and latency are measured for the calling threads only (every 16th call is sampled).
+ * Time in milliseconds until all messages are written (logger is destroyed) is reported as the metric.
+ * Start function creates the logging state and returns a function void(int producer, int i) for each thread,
+ * finish function is called when all producers are done.
+ */
+template<class Start, class Finish>
+bench::result run_log(const char *name, const bench::options &opts, int producers, bool pinned,
+                      Start start_producer, Finish finish)
+{
+    auto per_producer = opts.items / producers;
+
+    std::vector<bench::latency_recorder> latencies(producers);
+    std::vector<std::uint64_t> elapsed(producers);
+    std::atomic<int> ready(0);
+    std::atomic<bool> go(false);
+
+    std::vector<std::thread> threads;
+    for (int p = 0; p < producers; ++p)
+    {
+        threads.emplace_back([&, p]
+        {
+            auto log = start_producer(p);
+
+            if (pinned)
+                bench::pin_thread(opts.cpu(p));
+            ready.fetch_add(1);
+            while (!go.load(std::memory_order_acquire))
+                std::this_thread::yield();
+
+            auto &lat = latencies[p];
+            lat.reserve(per_producer / 16 + 1);
+
+            auto start = bench::now_ns();
+            for (std::uint64_t i = 0; i < per_producer; ++i)
+            {
+                if (i % 16 == 0)
+                {
+                    auto call = bench::now_ns();
+                    log(p, i);
+                    lat.add(bench::now_ns() - call);
+                }
+                else
+                {
+                    log(p, i);
+                }
+            }
+            elapsed[p] = bench::now_ns() - start;
+        });
+    }
+
+    while (ready.load() != producers)
+        std::this_thread::yield();
+
+    auto start = bench::now_ns();
+    go.store(true, std::memory_order_release);
+    for (auto &t : threads)
+        t.join();
+    finish();
+    auto finish_ns = bench::now_ns();
+
+    bench::latency_recorder all;
+    for (auto &lat : latencies)
+        all.merge(lat);
+
+    std::uint64_t slowest = 0;
+    for (auto e : elapsed)
+        slowest = std::max(slowest, e);
+
+    bench::result r;
+    r.name      = name;
+    r.mode      = "threads";
+    r.payload   = 0;
+    r.producers = producers;
+    r.consumers = 1;
+    r.pinned    = pinned;
+    r.items     = per_producer * producers;
+    r.seconds   = slowest / 1e9;
+    r.metric    = (finish_ns - start) / 1e6;
+    r.set_latency(all);
+
+    return r;
+}
+
+int main(int argc, const char* argv[])
+{
+    bench::options opts;
+    opts.items    = 1000000;
+    opts.threads  = {{1, 1}, {2, 1}, {4, 1}};
+
+    if (!opts.parse(argc, argv))
+    {
+        bench::options::usage(argv[0]);
+        return 1;
+    }
+
+    std::string path = "logger_bench." + std::to_string(::getpid()) + ".log";
+
+    bench::report report(opts);
+
+    // consumers in --threads option are ignored, there is always one output file
+    for (auto pinned : opts.pin)
+    {
+        for (auto &t : opts.threads)
+        {
+            int producers = t.first;
+
+            report.run([&]
+            {
+                std::unique_ptr<types::async_logger> logger(new types::async_logger(path.c_str()));
+                std::vector<std::unique_ptr<types::async_logger::producer>> handles(producers);
+
+                auto r = run_log("async_logger", opts, producers, pinned,
+                                 [&](int p)
+                                 {
+                                     handles[p].reset(new types::async_logger::producer(logger->attach()));
+                                     auto h = handles[p].get();
+                                     return [h](int p, std::uint64_t i)
+                                     {
+                                         h->log("producer {} order {} price {} side {}", p, i, 100.25, "buy");
+                                     };
+                                 },
+                                 [&]
+                                 {
+                                     handles.clear();
+                                     logger.reset();
+                                 });
+                std::remove(path.c_str());
+                return r;
+            });
+
+            // synchronous output the way the tests print: formatting and buffered write in the calling thread
+            for (auto flush : {false, true})
+            {
+                report.run([&]
+                {
+                    std::ofstream out(path);
+                    std::mutex lock;
+
+                    auto r = run_log(flush ? "ofstream_endl" : "ofstream", opts, producers, pinned,
+                                     [&](int)
+                                     {
+                                         return [&](int p, std::uint64_t i)
+                                         {
+                                             std::lock_guard<std::mutex> l(lock);
+                                             out << "producer " << p << " order " << i << " price " << 100.25
+                                                 << " side " << "buy";
+                                             if (flush)
+                                                 out << std::endl;
+                                             else
+                                                 out << "\n";
+                                         };
+                                     },
+                                     [&] { out.close(); });
+                    std::remove(path.c_str());
+                    return r;
+                });
+            }
+        }
+    }
+
+    report.write();
+
+    return 0;
+}
@@ -0,0 +1,142 @@
+
+#include <atomic>
+#include <cassert>
+#include <memory>
+#include <thread>
+
+using namespace std;
+
+#include "queue.h"
+#include "node_pool.h"
+
+#include "bench.h"
+
+/*
+ * Writer allocates each element and reader frees it in another thread.
+ * Number of elements in flight is limited by window so the pool doesn't grow without bound
+ * when the reader is slower than the writer.
+ */
+template<class Node, class Allocate, class Free>
+bench::result run_alloc(const char *name, const bench::options &opts, bool pinned, std::uint64_t window,
+                        Allocate allocate, Free free)
+{
+    types::queue<Node> q;
+    std::atomic<std::uint64_t> consumed(0);
+    bench::latency_recorder lat;
+    lat.reserve(opts.items);
+
+    auto start = bench::now_ns();
+
+    std::thread writer([&]
+    {
+        if (pinned)
+            bench::pin_thread(opts.cpu(0));
+
+        for (std::uint64_t i = 0; i < opts.items; ++i)
+        {
+            while (i - consumed.load(std::memory_order_relaxed) >= window)
+                std::this_thread::yield();
+
+            auto n = allocate();
+            n->stamp = bench::now_ns();
+            q.write(n);
+        }
+    });
+
+    std::thread reader([&]
+    {
+        if (pinned)
+            bench::pin_thread(opts.cpu(1));
+
+        std::uint64_t count = 0;
+        while (count < opts.items)
+        {
+            auto n = q.drain([&](Node *n)
+            {
+                lat.add(bench::now_ns() - n->stamp);
+                free(n);
+            });
+
+            if (n == 0)
+                std::this_thread::yield();
+
+            count += n;
+            consumed.store(count, std::memory_order_relaxed);
+        }
+    });
+
+    writer.join();
+    reader.join();
+
+    auto finish = bench::now_ns();
+
+    bench::result r;
+    r.name      = name;
+    r.mode      = "threads";
+    r.payload   = sizeof(Node::data);
+    r.producers = 1;
+    r.consumers = 1;
+    r.pinned    = pinned;
+    r.items     = opts.items;
+    r.seconds   = (finish - start) / 1e9;
+    r.set_latency(lat);
+
+    return r;
+}
+
+template<std::size_t N>
+void run_payload(bench::report &report, const bench::options &opts)
+{
+    using Node = bench::payload<N>;
+    const std::uint64_t window = 4096;
+
+    for (auto pinned : opts.pin)
+    {
+        report.run([&]
+        {
+            return run_alloc<Node>("new_delete", opts, pinned, window,
+                                   [] { return new Node(); },
+                                   [](Node *n) { delete n; });
+        });
+
+        report.run([&]
+        {
+            types::node_pool<Node> pool(window);
+            typename types::node_pool<Node>::return_batch batch(pool);
+            return run_alloc<Node>("node_pool", opts, pinned, window,
+                                   [&] { return pool.allocate(); },
+                                   [&](Node *n) { batch.deallocate(n); });
+        });
+    }
+}
+
+int main(int argc, const char* argv[])
+{
+    bench::options opts;
+    opts.items = 1000000;
+    if (!opts.parse(argc, argv))
+    {
+        bench::options::usage(argv[0]);
+        return 1;
+    }
+
+    bench::report report(opts);
+
+    for (auto payload : opts.payloads)
+    {
+        switch (payload)
+        {
+        case 8:    run_payload<8>(report, opts);    break;
+        case 64:   run_payload<64>(report, opts);   break;
+        case 256:  run_payload<256>(report, opts);  break;
+        case 1024: run_payload<1024>(report, opts); break;
+        default:
+            std::cerr << "Unsupported payload size " << payload << ", use one of: 8, 64, 256, 1024\n";
+            return 1;
+        }
+    }
+
+    report.write();
+
+    return 0;
+}
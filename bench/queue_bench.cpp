@@ -0,0 +1,185 @@
+
+#include <atomic>
+#include <cassert>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+using namespace std;
+
+#include "queue.h"
+#include "ring_queue.h"
+#include "mpmc_queue.h"
+#include "mpsc_queue.h"
+#include "queue_mesh.h"
+#include "writer.h"
+#include "reader.h"
+#include "guard.h"
+#include "LockFreeQueue.h"
+
+#include "bench.h"
+
+template<class T>
+using GuardedWriter = types::guard<types::writer<T>>;
+
+template<class T>
+using GuardedReader = types::guard<types::reader<T>>;
+
+/*
+ * Write and read bursts of items in the same thread.
+ */
+template<class Node, class Write, class Read>
+bench::result run_inline(const char *name, const bench::options &opts, Write write, Read read)
+{
+    const std::uint64_t burst = 16;
+    auto total = opts.items / burst * burst;
+
+    std::vector<Node> nodes(total);
+    bench::latency_recorder lat;
+    lat.reserve(total);
+
+    auto start = bench::now_ns();
+    for (std::uint64_t i = 0; i < total; i += burst)
+    {
+        for (std::uint64_t j = i; j < i + burst; ++j)
+        {
+            nodes[j].stamp = bench::now_ns();
+            write(&nodes[j]);
+        }
+
+        Node *node = nullptr;
+        while (read(node))
+            lat.add(bench::now_ns() - node->stamp);
+    }
+    auto finish = bench::now_ns();
+
+    bench::result r;
+    r.name      = name;
+    r.mode      = "inline";
+    r.payload   = sizeof(Node::data);
+    r.producers = 1;
+    r.consumers = 1;
+    r.items     = total;
+    r.seconds   = (finish - start) / 1e9;
+    r.set_latency(lat);
+
+    return r;
+}
+
+/*
+ * Queues reclaim remaining items with delete but nodes here belong to the benchmark.
+ * Every run drains its queue completely so nothing is left for the destructor.
+ */
+template<std::size_t N>
+void run_payload(bench::report &report, const bench::options &opts)
+{
+    using Node  = bench::payload<N>;
+    using Queue = types::queue<Node>;
+
+    report.run([&]
+    {
+        Queue q;
+        return run_inline<Node>("queue", opts,
+                                [&](Node *n) { q.write(n); },
+                                [&](Node *&n) { return q.read(n); });
+    });
+
+    // LockFreeQueue has no atomics so it is measured in the same thread only.
+    report.run([&]
+    {
+        LockFreeQueue<Node> q;
+        return run_inline<Node>("LockFreeQueue", opts,
+                                [&](Node *n) { q.Write(n); },
+                                [&](Node *&n) { return q.Read(n) || (q.Flush() && q.Read(n)); });
+    });
+
+    for (auto pinned : opts.pin)
+    {
+        report.run([&]
+        {
+            Queue q;
+            return bench::run_threaded<Node>("queue", opts, 1, 1, pinned,
+                                             [&](int, Node *n) { q.write(n); },
+                                             [&](int, Node *&n) { return q.read(n); });
+        });
+
+        report.run([&]
+        {
+            std::unique_ptr<types::ring_queue<Node*, 1024>> q(new types::ring_queue<Node*, 1024>());
+            return bench::run_threaded<Node>("ring_queue", opts, 1, 1, pinned,
+                                             [&](int, Node *n) { while (!q->write(n)) std::this_thread::yield(); },
+                                             [&](int, Node *&n) { return q->read(n); });
+        });
+
+        for (auto &t : opts.threads)
+        {
+            report.run([&]
+            {
+                auto q = std::make_shared<Queue>();
+                GuardedWriter<Queue> gw(q);
+                GuardedReader<Queue> gr(q);
+                return bench::run_threaded<Node>("guard", opts, t.first, t.second, pinned,
+                                                 [&](int, Node *n) { gw->write(n); },
+                                                 [&](int, Node *&n) { return gr->read(n); });
+            });
+
+            report.run([&]
+            {
+                std::unique_ptr<types::mpmc_queue<Node*, 1024>> q(new types::mpmc_queue<Node*, 1024>());
+                return bench::run_threaded<Node>("mpmc_queue", opts, t.first, t.second, pinned,
+                                                 [&](int, Node *n) { while (!q->write(n)) std::this_thread::yield(); },
+                                                 [&](int, Node *&n) { return q->read(n); });
+            });
+
+            if (t.second == 1)
+            {
+                using MpscNode = bench::atomic_payload<N>;
+                report.run([&]
+                {
+                    types::mpsc_queue<MpscNode> q;
+                    return bench::run_threaded<MpscNode>("mpsc_queue", opts, t.first, 1, pinned,
+                                                         [&](int, MpscNode *n) { q.write(n); },
+                                                         [&](int, MpscNode *&n) { return q.read(n); });
+                });
+            }
+
+            report.run([&]
+            {
+                types::queue_mesh<Node> mesh(t.first, t.second);
+                return bench::run_threaded<Node>("queue_mesh", opts, t.first, t.second, pinned,
+                                                 [&](int p, Node *n) { mesh.write(p, n); },
+                                                 [&](int c, Node *&n) { return mesh.read(c, n); });
+            });
+        }
+    }
+}
+
+int main(int argc, const char* argv[])
+{
+    bench::options opts;
+    if (!opts.parse(argc, argv))
+    {
+        bench::options::usage(argv[0]);
+        return 1;
+    }
+
+    bench::report report(opts);
+
+    for (auto payload : opts.payloads)
+    {
+        switch (payload)
+        {
+        case 8:    run_payload<8>(report, opts);    break;
+        case 64:   run_payload<64>(report, opts);   break;
+        case 256:  run_payload<256>(report, opts);  break;
+        case 1024: run_payload<1024>(report, opts); break;
+        default:
+            std::cerr << "Unsupported payload size " << payload << ", use one of: 8, 64, 256, 1024\n";
+            return 1;
+        }
+    }
+
+    report.write();
+
+    return 0;
+}
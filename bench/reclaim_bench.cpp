@@ -0,0 +1,257 @@
+
+#include <atomic>
+#include <cassert>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+#include "reclaim.h"
+
+#include "bench.h"
+
+/*
+ * Element replaced by the writer and read by the readers.
+ */
+template<std::size_t N>
+struct node
+{
+    std::uint64_t stamp = 0;
+    char data[N];
+};
+
+/*
+ * Readers read the shared element opts.items times each while the writer keeps replacing it.
+ * Reports readers' throughput and latency of one protected read (sampled), the number of writer's replacements
+ * is the metric.
+ * Setup function void(int thread) is called by each thread before the start, readers have indexes
+ * [0, readers) and the writer has index readers. Read function has signature std::uint64_t(int reader) and
+ * returns the stamp of the read element, replace function has signature void(std::uint64_t stamp).
+ */
+template<class Setup, class Read, class Replace>
+bench::result run_readers(const char *name, const bench::options &opts, std::size_t payload, int readers,
+                          bool pinned, Setup setup, Read read, Replace replace)
+{
+    std::vector<bench::latency_recorder> latencies(readers);
+    std::atomic<int> ready(0);
+    std::atomic<int> running(readers);
+    std::atomic<std::uint64_t> checksum(0); // keeps reads from being optimized out
+    std::atomic<bool> go(false);
+    std::uint64_t replaced = 0;
+
+    auto start_barrier = [&](int index)
+    {
+        if (pinned)
+            bench::pin_thread(opts.cpu(index));
+        ready.fetch_add(1);
+        while (!go.load(std::memory_order_acquire))
+            std::this_thread::yield();
+    };
+
+    std::vector<std::thread> threads;
+    threads.emplace_back([&]
+    {
+        setup(readers);
+        start_barrier(0);
+
+        while (running.load(std::memory_order_relaxed) != 0)
+        {
+            replace(++replaced);
+            if (replaced % 64 == 0)
+                std::this_thread::yield();
+        }
+    });
+    for (int r = 0; r < readers; ++r)
+    {
+        threads.emplace_back([&, r]
+        {
+            setup(r);
+            start_barrier(1 + r);
+
+            auto &lat = latencies[r];
+            lat.reserve(opts.items / 64 + 1);
+
+            std::uint64_t sum = 0;
+            for (std::uint64_t i = 0; i < opts.items; ++i)
+            {
+                if (i % 64 == 0)
+                {
+                    auto start = bench::now_ns();
+                    sum += read(r);
+                    lat.add(bench::now_ns() - start);
+                }
+                else
+                {
+                    sum += read(r);
+                }
+            }
+            checksum.fetch_add(sum, std::memory_order_relaxed);
+
+            running.fetch_sub(1, std::memory_order_relaxed);
+        });
+    }
+
+    while (ready.load() != readers + 1)
+        std::this_thread::yield();
+
+    auto start = bench::now_ns();
+    go.store(true, std::memory_order_release);
+    for (auto &t : threads)
+        t.join();
+    auto finish = bench::now_ns();
+
+    bench::latency_recorder all;
+    for (auto &lat : latencies)
+        all.merge(lat);
+
+    bench::result r;
+    r.name      = name;
+    r.mode      = "readers";
+    r.payload   = payload;
+    r.producers = 1;
+    r.consumers = readers;
+    r.pinned    = pinned;
+    r.items     = opts.items * readers;
+    r.seconds   = (finish - start) / 1e9;
+    r.metric    = static_cast<double>(replaced);
+    r.set_latency(all);
+
+    return r;
+}
+
+/*
+ * Each thread attaches to the domain in setup(), handles are destroyed after all threads are finished.
+ */
+template<class Domain, std::size_t N>
+void run_domain(bench::report &report, const bench::options &opts, const char *name, int readers, bool pinned)
+{
+    using Node = node<N>;
+
+    report.run([&]
+    {
+        Domain domain;
+        std::atomic<Node*> shared(new Node());
+        std::vector<std::unique_ptr<typename Domain::thread_handle>> handles(readers + 1);
+
+        auto result = run_readers(name, opts, N, readers, pinned,
+                                  [&](int index)
+                                  {
+                                      handles[index].reset(
+                                          new typename Domain::thread_handle(domain.attach()));
+                                  },
+                                  [&](int r)
+                                  {
+                                      auto guard = handles[r]->pin();
+                                      return guard.protect(0, shared)->stamp;
+                                  },
+                                  [&](std::uint64_t stamp)
+                                  {
+                                      auto n = new Node();
+                                      n->stamp = stamp;
+                                      handles[readers]->retire(shared.exchange(n));
+                                  });
+
+        handles.clear();
+        delete shared.load();
+
+        return result;
+    });
+}
+
+template<std::size_t N>
+void run_payload(bench::report &report, const bench::options &opts)
+{
+    using Node = node<N>;
+
+    for (auto pinned : opts.pin)
+    {
+        for (auto &t : opts.threads)
+        {
+            int readers = t.second;
+
+            // no reclamation: replaced elements are deleted after the run
+            report.run([&]
+            {
+                std::atomic<Node*> shared(new Node());
+                std::vector<Node*> garbage;
+
+                auto result = run_readers("leak", opts, N, readers, pinned,
+                                          [](int) {},
+                                          [&](int) { return shared.load(std::memory_order_acquire)->stamp; },
+                                          [&](std::uint64_t stamp)
+                                          {
+                                              auto n = new Node();
+                                              n->stamp = stamp;
+                                              garbage.push_back(shared.exchange(n));
+                                          });
+
+                for (auto n : garbage)
+                    delete n;
+                delete shared.load();
+
+                return result;
+            });
+
+            run_domain<types::hazard_reclaim<1>, N>(report, opts, "hazard_reclaim", readers, pinned);
+            run_domain<types::epoch_reclaim, N>(report, opts, "epoch_reclaim", readers, pinned);
+
+            // reference counting: the element is copied under a lock and released by the last owner
+            report.run([&]
+            {
+                std::mutex lock;
+                std::shared_ptr<Node> shared(new Node());
+
+                return run_readers("shared_ptr", opts, N, readers, pinned,
+                                   [](int) {},
+                                   [&](int)
+                                   {
+                                       std::shared_ptr<Node> n;
+                                       {
+                                           std::lock_guard<std::mutex> l(lock);
+                                           n = shared;
+                                       }
+                                       return n->stamp;
+                                   },
+                                   [&](std::uint64_t stamp)
+                                   {
+                                       std::shared_ptr<Node> n(new Node());
+                                       n->stamp = stamp;
+                                       std::lock_guard<std::mutex> l(lock);
+                                       shared.swap(n);
+                                   });
+            });
+        }
+    }
+}
+
+int main(int argc, const char* argv[])
+{
+    bench::options opts;
+    opts.threads  = {{1, 1}, {1, 2}, {1, 4}};
+    opts.payloads = {8, 256};
+
+    if (!opts.parse(argc, argv))
+    {
+        bench::options::usage(argv[0]);
+        return 1;
+    }
+
+    bench::report report(opts);
+
+    // producers in --threads option are ignored, there is always one writer
+    for (auto payload : opts.payloads)
+    {
+        switch (payload)
+        {
+        case 8:    run_payload<8>(report, opts);    break;
+        case 256:  run_payload<256>(report, opts);  break;
+        default:
+            std::cerr << "Unsupported payload size " << payload << ", use one of: 8, 256\n";
+            return 1;
+        }
+    }
+
+    report.write();
+
+    return 0;
+}
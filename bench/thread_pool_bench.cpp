@@ -0,0 +1,128 @@
+
+#include <atomic>
+#include <cassert>
+#include <memory>
+#include <mutex>
+#include <thread>
+
+using namespace std;
+
+#include "queue.h"
+#include "thread_pool.h"
+
+#include "bench.h"
+
+static const int fib_n      = 32;
+static const int fib_cutoff = 18; // smaller problems are solved sequentially
+
+std::uint64_t fib_seq(int n)
+{
+    return n < 2 ? n : fib_seq(n - 1) + fib_seq(n - 2);
+}
+
+std::uint64_t fib(types::thread_pool &pool, int n)
+{
+    if (n < fib_cutoff)
+        return fib_seq(n);
+
+    auto f = pool.submit([&pool, n] { return fib(pool, n - 1); });
+    auto b = fib(pool, n - 2);
+    return pool.wait(f) + b;
+}
+
+/*
+ * Number of tasks submitted by fib().
+ */
+std::uint64_t fib_tasks(int n)
+{
+    return n < fib_cutoff ? 0 : 1 + fib_tasks(n - 1) + fib_tasks(n - 2);
+}
+
+bench::result make_result(const char *mode, int workers, std::uint64_t items, std::uint64_t start)
+{
+    bench::result r;
+    r.name      = "thread_pool";
+    r.mode      = mode;
+    r.producers = workers;
+    r.consumers = workers;
+    r.items     = items;
+    r.seconds   = (bench::now_ns() - start) / 1e9;
+    return r;
+}
+
+/*
+ * Recursive fork/join: every task submits a subtask and waits for it helping other workers.
+ */
+bench::result run_fork_join(int workers)
+{
+    types::thread_pool pool(workers);
+
+    auto start = bench::now_ns();
+    auto f = pool.submit([&pool] { return fib(pool, fib_n); });
+    auto value = pool.wait(f);
+    auto r = make_result("fork_join", workers, fib_tasks(fib_n), start);
+
+    if (value != fib_seq(fib_n))
+        std::cerr << "Wrong fib result " << value << "\n";
+
+    return r;
+}
+
+/*
+ * Fan-out: external thread posts many small tasks, latency is measured from post to run.
+ */
+bench::result run_fan_out(int workers, std::uint64_t items)
+{
+    types::thread_pool pool(workers);
+
+    std::vector<std::uint64_t> latencies(items);
+    std::atomic<std::uint64_t> done(0);
+
+    auto start = bench::now_ns();
+    for (std::uint64_t i = 0; i < items; ++i)
+    {
+        auto stamp = bench::now_ns();
+        pool.post([&, i, stamp]
+        {
+            latencies[i] = bench::now_ns() - stamp;
+            done.fetch_add(1, std::memory_order_release);
+        });
+    }
+
+    while (done.load(std::memory_order_acquire) != items)
+        std::this_thread::yield();
+
+    auto r = make_result("fan_out", workers, items, start);
+
+    bench::latency_recorder latency;
+    latency.reserve(items);
+    for (auto ns : latencies)
+        latency.add(ns);
+    r.set_latency(latency);
+    return r;
+}
+
+int main(int argc, const char* argv[])
+{
+    bench::options opts;
+    opts.threads = {{1, 1}, {2, 2}, {4, 4}, {8, 8}};
+
+    if (!opts.parse(argc, argv))
+    {
+        bench::options::usage(argv[0]);
+        return 1;
+    }
+
+    bench::report report(opts);
+
+    // producers in --threads option is the number of workers
+    for (auto &t : opts.threads)
+    {
+        report.run([&] { return run_fork_join(t.first); });
+        report.run([&] { return run_fan_out(t.first, opts.items); });
+    }
+
+    report.write();
+
+    return 0;
+}
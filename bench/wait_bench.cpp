@@ -0,0 +1,118 @@
+
+#include <atomic>
+#include <cassert>
+#include <memory>
+#include <thread>
+
+#include <time.h>
+
+using namespace std;
+
+#include "queue.h"
+
+#include "bench.h"
+
+/*
+ * Cpu time consumed by the calling thread.
+ */
+double thread_cpu_seconds()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_THREAD_CPUTIME_ID, &ts);
+    return ts.tv_sec + ts.tv_nsec / 1e9;
+}
+
+/*
+ * Writer writes one element every interval microseconds and reader blocks in read_wait().
+ * Reports wakeup latency, the metric is reader cpu usage in percent of the wall time.
+ */
+template<class Wait>
+void run_wait(bench::report &report, const bench::options &opts, const char *name, int interval_us, bool pinned)
+{
+    using Node  = bench::payload<8>;
+    using Queue = types::queue<Node, types::cache_aligned_layout, Wait>;
+
+    report.run([&]
+    {
+        std::vector<Node> nodes(opts.items);
+        std::unique_ptr<Queue> q(new Queue());
+        bench::latency_recorder lat;
+        lat.reserve(opts.items);
+        double reader_cpu = 0;
+
+        auto start = bench::now_ns();
+
+        std::thread reader([&]
+        {
+            if (pinned)
+                bench::pin_thread(opts.cpu(1));
+
+            auto cpu_start = thread_cpu_seconds();
+
+            Node *n = nullptr;
+            while (q->read_wait(n))
+                lat.add(bench::now_ns() - n->stamp);
+
+            reader_cpu = thread_cpu_seconds() - cpu_start;
+        });
+
+        if (pinned)
+            bench::pin_thread(opts.cpu(0));
+
+        for (auto &n : nodes)
+        {
+            std::this_thread::sleep_for(std::chrono::microseconds(interval_us));
+
+            n.stamp = bench::now_ns();
+            q->write(&n);
+        }
+        q->set_writer_finished();
+
+        reader.join();
+
+        auto finish = bench::now_ns();
+
+        bench::result r;
+        r.name      = name;
+        r.mode      = "read_wait";
+        r.payload   = sizeof(Node::data);
+        r.producers = 1;
+        r.consumers = 1;
+        r.pinned    = pinned;
+        r.items     = opts.items;
+        r.seconds   = (finish - start) / 1e9;
+        r.metric    = 100 * reader_cpu / r.seconds;
+        r.set_latency(lat);
+
+        return r;
+    });
+}
+
+int main(int argc, const char* argv[])
+{
+    bench::options opts;
+    opts.items = 2000;
+    if (!opts.parse(argc, argv))
+    {
+        bench::options::usage(argv[0]);
+        return 1;
+    }
+
+    const int interval_us = 100;
+
+    bench::report report(opts);
+
+    for (auto pinned : opts.pin)
+    {
+        run_wait<types::busy_spin_wait>(report, opts, "busy_spin_wait", interval_us, pinned);
+        run_wait<types::spin_yield_wait<>>(report, opts, "spin_yield_wait", interval_us, pinned);
+        run_wait<types::spin_park_wait<>>(report, opts, "spin_park_wait", interval_us, pinned);
+#ifdef __linux__
+        run_wait<types::eventfd_wait<>>(report, opts, "eventfd_wait", interval_us, pinned);
+#endif
+    }
+
+    report.write();
+
+    return 0;
+}
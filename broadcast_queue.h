@@ -0,0 +1,305 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Oleg Khryptul aka HaronK
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// NOTE: VAR_T and VAR macros are used for testing with
+// Relacy Race Detector library:
+// http://www.1024cores.net/home/relacy-race-detector/rrd-introduction
+// http://www.1024cores.net/home/relacy-race-detector
+
+#include "platform.h"
+
+#include <memory>
+
+#if !defined(VAR_T) || !defined(VAR)
+#define VAR_T(t) t
+#define VAR(v) v
+#define VAR_UNDEF
+#endif
+
+namespace types
+{
+
+/**
+ * Bounded lock free queue for 1 writer and N reader threads where every reader reads every element
+ * (Disruptor-style broadcast).
+ *
+ * Values are stored once in the array of Capacity elements shared by all readers. Writer owns the published
+ * sequence: the number of written elements. Each reader has its own cursor: the number of elements it has read.
+ * Reader reads elements between its cursor and the published sequence and doesn't affect other readers.
+ *
+ * Writer can't overwrite an element that the slowest reader has not read yet, so the minimum of the reader
+ * cursors is a gating sequence: write() returns false when the writer is Capacity elements ahead of it.
+ * Writer keeps a cached copy of the gating sequence and scans the cursors only when the queue looks full,
+ * and each reader keeps a cached copy of the published sequence, so the cost of a write doesn't depend on
+ * the number of readers most of the time.
+ *
+ * Values are copied to the readers. Use read_all() to process elements in place and advance the cursor once
+ * per batch. T should be default constructible and copy assignable.
+ *
+ * Readers are identified by indexes in [0, readers) range. Each index should be used by one thread at a time.
+ * All readers are attached from the beginning: a reader that doesn't read blocks the writer.
+ */
+template<class T, std::size_t Capacity>
+class broadcast_queue
+{
+    static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "Capacity should be a power of two");
+
+public:
+    using value_type = T;
+
+    explicit broadcast_queue(std::size_t readers);
+
+    broadcast_queue(const broadcast_queue&) = delete;
+    broadcast_queue& operator=(const broadcast_queue&) = delete;
+
+    /**
+     * Write data to the queue. Writer only method.
+     *
+     * @param data Value to write to the queue
+     * @return true if data was written otherwise false (the slowest reader is Capacity elements behind).
+     */
+    bool write(const value_type &data);
+    bool write(value_type &&data);
+
+    /**
+     * Read the next element. Reader only method.
+     *
+     * @param reader Index of the reader.
+     * @param data [OUT] Data to retrieve.
+     * @return true if data was retrieved otherwise false.
+     */
+    bool read(std::size_t reader, value_type &data);
+
+    /**
+     * Pass all published elements to the function and then release them with one atomic operation.
+     * Reader only method.
+     *
+     * @param reader Index of the reader.
+     * @param fn Function with void(const value_type&) signature
+     * @return number of processed elements.
+     */
+    template<class Function>
+    std::size_t read_all(std::size_t reader, Function fn);
+
+    void set_writer_finished()
+    {
+        writer_finished.store(true, memory_order_release);
+    }
+
+    bool is_writer_finished()
+    {
+        return writer_finished.load(memory_order_acquire);
+    }
+
+    std::size_t readers() const
+    {
+        return readers_count;
+    }
+
+    static constexpr std::size_t capacity()
+    {
+        return Capacity;
+    }
+
+private:
+    static const std::size_t mask = Capacity - 1;
+
+    struct alignas(TYPES_CACHE_LINE_SIZE) reader_state
+    {
+        atomic<std::size_t> cursor;
+        VAR_T(std::size_t) cached_published;
+    };
+
+    template<class U>
+    bool emplace(U &&data);
+
+    std::size_t available(reader_state &state);
+
+    std::size_t gating_sequence();
+
+    const std::size_t readers_count;
+    std::unique_ptr<reader_state[]> reader_states;
+
+    // writer's state
+    alignas(TYPES_CACHE_LINE_SIZE) atomic<std::size_t> published;
+    VAR_T(std::size_t) cached_gate;
+
+    // rarely changed state
+    alignas(TYPES_CACHE_LINE_SIZE) atomic<bool> writer_finished;
+
+    alignas(TYPES_CACHE_LINE_SIZE) VAR_T(value_type) buffer[Capacity];
+};
+
+template<class T, std::size_t Capacity>
+broadcast_queue<T, Capacity>::broadcast_queue(std::size_t readers)
+    : readers_count(readers), reader_states(new reader_state[readers])
+{
+    assert(readers > 0);
+
+    for (std::size_t i = 0; i < readers_count; ++i)
+    {
+        reader_states[i].cursor.store(0, memory_order_relaxed);
+        reader_states[i].VAR(cached_published) = 0;
+    }
+
+    published.store(0, memory_order_relaxed);
+    VAR(cached_gate) = 0;
+    writer_finished.store(false, memory_order_relaxed);
+}
+
+template<class T, std::size_t Capacity>
+bool broadcast_queue<T, Capacity>::write(const value_type &data)
+{
+    return emplace(data);
+}
+
+template<class T, std::size_t Capacity>
+bool broadcast_queue<T, Capacity>::write(value_type &&data)
+{
+    return emplace(std::move(data));
+}
+
+/*
+ * Write data to the queue.
+ * Algorithm:
+ * 1. Check if the slot is free using cached gating sequence.
+ * 2. If not then recalculate gating sequence from reader cursors using atomic::load() and check again.
+ * 3. Move data to the slot and publish it with atomic::store() of the new published sequence.
+ */
+template<class T, std::size_t Capacity>
+template<class U>
+bool broadcast_queue<T, Capacity>::emplace(U &&data)
+{
+    assert(!writer_finished.load(memory_order_relaxed));
+
+    std::size_t seq = published.load(memory_order_relaxed);
+    if (seq - VAR(cached_gate) == Capacity)
+    {
+        VAR(cached_gate) = gating_sequence();
+        if (seq - VAR(cached_gate) == Capacity)
+        {
+            return false;
+        }
+    }
+
+    VAR(buffer[seq & mask]) = std::forward<U>(data);
+    published.store(seq + 1, memory_order_release);
+
+    return true;
+}
+
+/*
+ * Read data from the queue.
+ * Algorithm:
+ * 1. Check if there is an unread element using cached published sequence.
+ * 2. If not then reload published sequence using atomic::load() and check again.
+ * 3. Copy data from the slot and release it with atomic::store() of the new cursor.
+ */
+template<class T, std::size_t Capacity>
+bool broadcast_queue<T, Capacity>::read(std::size_t reader, value_type &data)
+{
+    assert(reader < readers_count);
+
+    auto &state = reader_states[reader];
+    if (available(state) == 0)
+    {
+        return false;
+    }
+
+    std::size_t c = state.cursor.load(memory_order_relaxed);
+    data = VAR(buffer[c & mask]);
+    state.cursor.store(c + 1, memory_order_release);
+
+    return true;
+}
+
+template<class T, std::size_t Capacity>
+template<class Function>
+std::size_t broadcast_queue<T, Capacity>::read_all(std::size_t reader, Function fn)
+{
+    assert(reader < readers_count);
+
+    auto &state = reader_states[reader];
+    state.VAR(cached_published) = published.load(memory_order_acquire);
+
+    std::size_t c = state.cursor.load(memory_order_relaxed);
+    std::size_t n = state.VAR(cached_published) - c;
+    if (n == 0)
+    {
+        return 0;
+    }
+
+    for (std::size_t i = 0; i < n; ++i)
+    {
+        const value_type &data = VAR(buffer[(c + i) & mask]);
+        fn(data);
+    }
+    state.cursor.store(c + n, memory_order_release);
+
+    return n;
+}
+
+/*
+ * Number of elements the reader can read. Published sequence is reloaded only when cached copy says none.
+ */
+template<class T, std::size_t Capacity>
+std::size_t broadcast_queue<T, Capacity>::available(reader_state &state)
+{
+    std::size_t c = state.cursor.load(memory_order_relaxed);
+    if (c == state.VAR(cached_published))
+    {
+        state.VAR(cached_published) = published.load(memory_order_acquire);
+    }
+
+    return state.VAR(cached_published) - c;
+}
+
+/*
+ * Minimum of reader cursors. Acquire loads make reader's copies of the slots happen before the writer
+ * overwrites them.
+ */
+template<class T, std::size_t Capacity>
+std::size_t broadcast_queue<T, Capacity>::gating_sequence()
+{
+    std::size_t seq = published.load(memory_order_relaxed);
+    std::size_t gate = seq;
+    for (std::size_t i = 0; i < readers_count; ++i)
+    {
+        std::size_t c = reader_states[i].cursor.load(memory_order_acquire);
+        if (seq - c > seq - gate)
+        {
+            gate = c;
+        }
+    }
+
+    return gate;
+}
+
+} // namespace types
+
+#ifdef VAR_UNDEF
+#undef VAR_T
+#undef VAR
+#undef VAR_UNDEF
+#endif
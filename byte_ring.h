@@ -0,0 +1,322 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Oleg Khryptul aka HaronK
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// NOTE: VAR_T and VAR macros are used for testing with
+// Relacy Race Detector library:
+// http://www.1024cores.net/home/relacy-race-detector/rrd-introduction
+// http://www.1024cores.net/home/relacy-race-detector
+// Message bytes are raw memory so Relacy checks only the positions and cached positions.
+
+#include "platform.h"
+
+#include <cstdint>
+#include <cstring>
+
+#if !defined(VAR_T) || !defined(VAR)
+#define VAR_T(t) t
+#define VAR(v) v
+#define VAR_UNDEF
+#endif
+
+namespace types
+{
+
+/**
+ * Bounded lock free ring of variable length byte messages for 1 writer and 1 reader threads.
+ *
+ * Messages are written and read in place: writer gets contiguous space with reserve(), fills it and
+ * publishes it with commit(). Reader gets the oldest message with peek() and frees its space with release().
+ * So a message needs no allocation, no `next` pointer and no copy.
+ *
+ * Each message is a record with 8 byte length header followed by the message bytes. Records are aligned
+ * to 8 bytes and are never split by the end of the buffer: if the record doesn't fit to the end then
+ * writer fills the rest of the buffer with a padding record that reader skips (bip buffer).
+ * Because of that a message can't be larger than max_message_size() (about half of the capacity).
+ *
+ * Writer owns tail position and reader owns head position. Both are byte positions that only grow.
+ * Each side keeps a cached copy of the other side's position and reloads it only when the ring looks
+ * full (writer) or empty (reader), the same way ring_queue does.
+ *
+ * Example:
+ *   auto buf = ring.reserve(n);            // writer
+ *   if (buf) { fill(buf, n); ring.commit(); }
+ *
+ *   std::size_t size;                      // reader
+ *   if (auto msg = ring.peek(size)) { process(msg, size); ring.release(); }
+ */
+template<std::size_t Capacity>
+class byte_ring
+{
+    static_assert(Capacity >= 64 && (Capacity & (Capacity - 1)) == 0, "Capacity should be a power of two not less than 64");
+
+    using header_type = std::uint64_t;
+
+public:
+    static const std::size_t record_alignment = sizeof(header_type);
+
+    byte_ring();
+
+    byte_ring(const byte_ring&) = delete;
+    byte_ring& operator=(const byte_ring&) = delete;
+
+    /**
+     * Maximum size of a message that can be always written once the ring is empty.
+     */
+    static constexpr std::size_t max_message_size()
+    {
+        return Capacity / 2 - sizeof(header_type);
+    }
+
+    static constexpr std::size_t capacity()
+    {
+        return Capacity;
+    }
+
+    /**
+     * Reserve contiguous space for the message. Writer only method.
+     * Space is not visible to the reader until commit(). Reservation that is not committed is dropped
+     * by the next reserve() call.
+     *
+     * @param size Size of the message, not more than max_message_size().
+     * @return space aligned to 8 bytes or nullptr if the ring is full.
+     */
+    void *reserve(std::size_t size);
+
+    /**
+     * Publish reserved message. Writer only method.
+     *
+     * @param size Actual size of the message, not more than reserved one. Unused rest of the reservation is
+     *             returned to the ring.
+     */
+    void commit(std::size_t size);
+
+    void commit()
+    {
+        commit(VAR(reserved_size));
+    }
+
+    /**
+     * Copy the message to the ring. Writer only method.
+     *
+     * @return false if the ring is full.
+     */
+    bool write(const void *data, std::size_t size);
+
+    /**
+     * Get the oldest message. Reader only method.
+     * Message stays valid until release() and peek() returns the same message until then.
+     *
+     * @param size [OUT] Size of the message.
+     * @return message or nullptr if the ring is empty.
+     */
+    const void *peek(std::size_t &size);
+
+    /**
+     * Free the space of the message returned by the last peek(). Reader only method.
+     */
+    void release();
+
+    void set_writer_finished()
+    {
+        writer_finished.store(true, memory_order_release);
+    }
+
+    bool is_writer_finished()
+    {
+        return writer_finished.load(memory_order_acquire);
+    }
+
+private:
+    static const std::size_t mask = Capacity - 1;
+    static const header_type padding = ~header_type(0);
+
+    static std::size_t record_size(std::size_t size)
+    {
+        return (sizeof(header_type) + size + record_alignment - 1) & ~(record_alignment - 1);
+    }
+
+    void write_header(std::size_t pos, header_type value)
+    {
+        std::memcpy(buffer + (pos & mask), &value, sizeof(value));
+    }
+
+    header_type read_header(std::size_t pos) const
+    {
+        header_type value;
+        std::memcpy(&value, buffer + (pos & mask), sizeof(value));
+        return value;
+    }
+
+    // writer's state
+    alignas(TYPES_CACHE_LINE_SIZE) atomic<std::size_t> tail;
+    VAR_T(std::size_t) cached_head;
+    VAR_T(std::size_t) reserved_pos; // position of the reserved record after padding
+    VAR_T(std::size_t) reserved_size;
+
+    // reader's state
+    alignas(TYPES_CACHE_LINE_SIZE) atomic<std::size_t> head;
+    VAR_T(std::size_t) cached_tail;
+    VAR_T(std::size_t) peeked_size; // record size of the message returned by peek()
+
+    // rarely changed state
+    alignas(TYPES_CACHE_LINE_SIZE) atomic<bool> writer_finished;
+
+    alignas(TYPES_CACHE_LINE_SIZE) unsigned char buffer[Capacity];
+};
+
+template<std::size_t Capacity>
+byte_ring<Capacity>::byte_ring()
+{
+    tail.store(0, memory_order_relaxed);
+    VAR(cached_head)   = 0;
+    VAR(reserved_pos)  = 0;
+    VAR(reserved_size) = 0;
+    head.store(0, memory_order_relaxed);
+    VAR(cached_tail) = 0;
+    VAR(peeked_size) = 0;
+    writer_finished.store(false, memory_order_relaxed);
+}
+
+/*
+ * Reserve space for the record.
+ * Algorithm:
+ * 1. If the record doesn't fit to the end of the buffer then the rest of the buffer is needed for padding.
+ * 2. Check if there is enough free space for padding and record using cached head.
+ * 3. If not then reload head using atomic::load() and check again.
+ * 4. Write padding header. Neither padding nor record are visible to the reader until commit().
+ */
+template<std::size_t Capacity>
+void *byte_ring<Capacity>::reserve(std::size_t size)
+{
+    assert(!writer_finished.load(memory_order_relaxed));
+    assert(size <= max_message_size());
+
+    std::size_t t = tail.load(memory_order_relaxed);
+    std::size_t rec = record_size(size);
+    std::size_t to_end = Capacity - (t & mask);
+    std::size_t pad = rec > to_end ? to_end : 0;
+
+    if (Capacity - (t - VAR(cached_head)) < pad + rec)
+    {
+        VAR(cached_head) = head.load(memory_order_acquire);
+        if (Capacity - (t - VAR(cached_head)) < pad + rec)
+        {
+            return nullptr;
+        }
+    }
+
+    if (pad > 0)
+    {
+        write_header(t, padding);
+    }
+
+    VAR(reserved_pos)  = t + pad;
+    VAR(reserved_size) = size;
+
+    return buffer + (VAR(reserved_pos) & mask) + sizeof(header_type);
+}
+
+/*
+ * Write record header and publish padding and record with atomic::store() of the new tail.
+ */
+template<std::size_t Capacity>
+void byte_ring<Capacity>::commit(std::size_t size)
+{
+    assert(size <= VAR(reserved_size));
+
+    write_header(VAR(reserved_pos), header_type(size));
+    tail.store(VAR(reserved_pos) + record_size(size), memory_order_release);
+
+    VAR(reserved_size) = 0;
+}
+
+template<std::size_t Capacity>
+bool byte_ring<Capacity>::write(const void *data, std::size_t size)
+{
+    void *space = reserve(size);
+    if (space == nullptr)
+    {
+        return false;
+    }
+
+    std::memcpy(space, data, size);
+    commit(size);
+
+    return true;
+}
+
+/*
+ * Get the oldest message.
+ * Algorithm:
+ * 1. Check if there is a record using cached tail.
+ * 2. If not then reload tail using atomic::load() and check again.
+ * 3. If the record is padding then free it with atomic::store() of the new head and start again.
+ */
+template<std::size_t Capacity>
+const void *byte_ring<Capacity>::peek(std::size_t &size)
+{
+    std::size_t h = head.load(memory_order_relaxed);
+    for (;;)
+    {
+        if (h == VAR(cached_tail))
+        {
+            VAR(cached_tail) = tail.load(memory_order_acquire);
+            if (h == VAR(cached_tail))
+            {
+                return nullptr;
+            }
+        }
+
+        header_type len = read_header(h);
+        if (len != padding)
+        {
+            size = std::size_t(len);
+            VAR(peeked_size) = record_size(size);
+            return buffer + (h & mask) + sizeof(header_type);
+        }
+
+        h += Capacity - (h & mask);
+        head.store(h, memory_order_release);
+    }
+}
+
+/*
+ * Free the record with atomic::store() of the new head.
+ */
+template<std::size_t Capacity>
+void byte_ring<Capacity>::release()
+{
+    assert(VAR(peeked_size) != 0);
+
+    head.store(head.load(memory_order_relaxed) + VAR(peeked_size), memory_order_release);
+    VAR(peeked_size) = 0;
+}
+
+} // namespace types
+
+#ifdef VAR_UNDEF
+#undef VAR_T
+#undef VAR
+#undef VAR_UNDEF
+#endif
@@ -0,0 +1,244 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Oleg Khryptul aka HaronK
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef TYPES_COMBINING_GUARD_H
+#define TYPES_COMBINING_GUARD_H
+
+// NOTE: combining_guard uses std::atomic directly and is not checked with Relacy Race Detector library.
+
+#include "platform.h"
+#include "locks.h"
+
+#include <atomic>
+#include <new>
+#include <type_traits>
+#include <utility>
+
+namespace types
+{
+
+/**
+ * Flat combining guard: alternative to guard for heavily contended objects.
+ *
+ * Instead of taking a lock for its own operation each thread publishes the operation in its slot.
+ * Thread that takes the combiner flag runs pending operations of all threads in one pass while others
+ * wait for their operations to be done. So the object and its lock stay in the cache of one core
+ * and the cost of lock handoff is paid once per pass instead of once per operation.
+ *
+ * Threads are mapped to Slots slots by a thread local index. If the slot is busy (more threads than slots)
+ * the thread takes the combiner flag and runs its operation itself.
+ *
+ * Operations run in the combiner thread so they should not throw exceptions or depend on thread locals.
+ *
+ * Example:
+ *   combining_guard<writer<queue<Data>>> w(q);
+ *   w.with([&](writer<queue<Data>> &w) { w.write(data); });
+ */
+template<class T, std::size_t Slots = 64>
+class combining_guard
+{
+public:
+    template<class... Args>
+    combining_guard(Args&&... args) : obj(std::forward<Args>(args)...)
+    {
+        for (auto &s : slots)
+        {
+            s.op.store(nullptr, std::memory_order_relaxed);
+        }
+    }
+
+    combining_guard(const combining_guard&) = delete;
+    combining_guard& operator=(const combining_guard&) = delete;
+
+    /**
+     * Call the function with the enclosed object. Function is called by this or by the combiner thread.
+     *
+     * @param fn Function with R(T&) signature
+     * @return result of the function.
+     */
+    template<class Function>
+    auto with(Function fn) -> decltype(fn(std::declval<T&>()))
+    {
+        using result_type = decltype(fn(std::declval<T&>()));
+
+        task<Function, result_type> t(fn);
+        execute(t);
+        return t.take();
+    }
+
+private:
+    /*
+     * Type erased operation published in a slot. It lives on the stack of the publishing thread
+     * which waits until the combiner sets done flag.
+     */
+    struct operation
+    {
+        void (*run)(operation*, T&);
+        std::atomic<bool> done{false};
+    };
+
+    template<class Function, class R>
+    struct task : operation
+    {
+        explicit task(Function &fn) : fn(fn)
+        {
+            this->run = &task::call;
+        }
+
+        static void call(operation *op, T &obj)
+        {
+            auto t = static_cast<task*>(op);
+            new (&t->result) R(t->fn(obj));
+        }
+
+        R take()
+        {
+            auto &r = *reinterpret_cast<R*>(&result);
+            R value(std::move(r));
+            r.~R();
+            return value;
+        }
+
+        Function &fn;
+        typename std::aligned_storage<sizeof(R), alignof(R)>::type result;
+    };
+
+    template<class Function>
+    struct task<Function, void> : operation
+    {
+        explicit task(Function &fn) : fn(fn)
+        {
+            this->run = &task::call;
+        }
+
+        static void call(operation *op, T &obj)
+        {
+            static_cast<task*>(op)->fn(obj);
+        }
+
+        void take()
+        {
+        }
+
+        Function &fn;
+    };
+
+    struct alignas(TYPES_CACHE_LINE_SIZE) slot
+    {
+        std::atomic<operation*> op;
+    };
+
+    void execute(operation &op);
+    void combine();
+
+    static std::size_t slot_index();
+
+    static const int max_passes = 3;
+
+    slot slots[Slots];
+
+    // combiner's state
+    alignas(TYPES_CACHE_LINE_SIZE) std::atomic<bool> combining{false};
+    T obj;
+};
+
+/*
+ * Execute operation.
+ * Algorithm:
+ * 1. Publish the operation in the thread's slot using atomic::compare_exchange(null).
+ * 2. Wait until the operation is done or combiner flag is free.
+ * 3. If combiner flag is taken then run not published operation and combine pending ones.
+ *    Published operation is run by combine() as it was published before the flag was taken.
+ */
+template<class T, std::size_t Slots>
+void combining_guard<T, Slots>::execute(operation &op)
+{
+    auto &s = slots[slot_index()];
+
+    operation *expected = nullptr;
+    bool published = s.op.compare_exchange_strong(expected, &op, std::memory_order_release, std::memory_order_relaxed);
+
+    spin_backoff backoff;
+    for (;;)
+    {
+        if (published && op.done.load(std::memory_order_acquire))
+        {
+            return;
+        }
+
+        if (!combining.load(std::memory_order_relaxed) && !combining.exchange(true, std::memory_order_acquire))
+        {
+            if (!published)
+            {
+                op.run(&op, obj);
+            }
+            combine();
+            combining.store(false, std::memory_order_release);
+            return;
+        }
+
+        backoff.pause();
+    }
+}
+
+/*
+ * Slot is cleared before the done flag is set because the owner can destroy the operation
+ * and publish the next one right after that.
+ */
+template<class T, std::size_t Slots>
+void combining_guard<T, Slots>::combine()
+{
+    for (int pass = 0; pass < max_passes; ++pass)
+    {
+        std::size_t count = 0;
+        for (auto &s : slots)
+        {
+            auto op = s.op.load(std::memory_order_acquire);
+            if (op != nullptr)
+            {
+                op->run(op, obj);
+                s.op.store(nullptr, std::memory_order_relaxed);
+                op->done.store(true, std::memory_order_release);
+                count++;
+            }
+        }
+
+        if (count == 0)
+        {
+            break;
+        }
+    }
+}
+
+template<class T, std::size_t Slots>
+std::size_t combining_guard<T, Slots>::slot_index()
+{
+    static std::atomic<std::size_t> next_index{0};
+    static thread_local std::size_t index = next_index.fetch_add(1, std::memory_order_relaxed) % Slots;
+    return index;
+}
+
+} // namespace types
+
+#endif // TYPES_COMBINING_GUARD_H
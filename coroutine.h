@@ -0,0 +1,377 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Oleg Khryptul aka HaronK
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef TYPES_COROUTINE_H
+#define TYPES_COROUTINE_H
+
+// NOTE: this file requires C++20 coroutines. It uses std::atomic directly and is not checked with
+// Relacy Race Detector library.
+
+#include "platform.h"
+#include "wait.h"
+
+#include <atomic>
+#include <cassert>
+#include <condition_variable>
+#include <coroutine>
+#include <cstddef>
+#include <deque>
+#include <exception>
+#include <mutex>
+#include <utility>
+
+namespace types
+{
+
+class scheduler;
+
+/**
+ * Coroutine started with scheduler::spawn(). Its result is not returned and exceptions terminate the program.
+ * Coroutine doesn't start until it is spawned and its frame is destroyed when it finishes.
+ */
+class task
+{
+public:
+    struct promise_type
+    {
+        scheduler *owner = nullptr;
+
+        task get_return_object()
+        {
+            return task(std::coroutine_handle<promise_type>::from_promise(*this));
+        }
+
+        std::suspend_always initial_suspend() noexcept
+        {
+            return {};
+        }
+
+        struct final_awaiter
+        {
+            bool await_ready() noexcept { return false; }
+            void await_suspend(std::coroutine_handle<promise_type> h) noexcept;
+            void await_resume() noexcept {}
+        };
+
+        final_awaiter final_suspend() noexcept
+        {
+            return {};
+        }
+
+        void return_void()
+        {
+        }
+
+        void unhandled_exception()
+        {
+            std::terminate();
+        }
+    };
+
+    task(task &&other) noexcept : handle(std::exchange(other.handle, nullptr))
+    {
+    }
+
+    task& operator=(task&&) = delete;
+
+    ~task()
+    {
+        if (handle)
+        {
+            handle.destroy(); // never spawned
+        }
+    }
+
+private:
+    friend class scheduler;
+
+    explicit task(std::coroutine_handle<promise_type> h) : handle(h)
+    {
+    }
+
+    std::coroutine_handle<promise_type> handle;
+};
+
+/**
+ * Single threaded scheduler of coroutines.
+ *
+ * Coroutines run one by one in the thread that calls run(). Coroutine suspended on an empty queue
+ * (see coroutine_wait) is scheduled again by the writer thread so many logical consumers share one thread
+ * and the thread sleeps while none of them is ready.
+ *
+ * schedule() can be called from any thread, spawn() and run() only from one thread.
+ */
+class scheduler
+{
+public:
+    scheduler() = default;
+
+    scheduler(const scheduler&) = delete;
+    scheduler& operator=(const scheduler&) = delete;
+
+    /**
+     * Start the task on the next run() call.
+     */
+    void spawn(task t)
+    {
+        auto h = std::exchange(t.handle, nullptr);
+        h.promise().owner = this;
+        alive++;
+        schedule(h);
+    }
+
+    /**
+     * Resume suspended coroutine in the scheduler thread. Can be called from any thread.
+     *
+     * @param ready Function that is called in the scheduler thread with arg before the coroutine is resumed.
+     *              If it returns false then the coroutine is not resumed: the function should arrange
+     *              the coroutine to be scheduled again. Used to skip spurious wakeups.
+     */
+    void schedule(std::coroutine_handle<> h, bool (*ready)(void*) = nullptr, void *arg = nullptr)
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            ready_list.push_back(entry{h, ready, arg});
+        }
+        cv.notify_one();
+    }
+
+    /**
+     * Run coroutines until all spawned tasks are finished.
+     */
+    void run()
+    {
+        auto previous = std::exchange(running, this);
+
+        std::deque<entry> batch;
+        while (alive > 0)
+        {
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                cv.wait(lock, [&] { return !ready_list.empty(); });
+                batch.swap(ready_list);
+            }
+
+            for (auto &e : batch)
+            {
+                if (e.ready == nullptr || e.ready(e.arg))
+                {
+                    e.handle.resume();
+                }
+            }
+            batch.clear();
+        }
+
+        running = previous;
+    }
+
+    /**
+     * Give other ready coroutines a chance to run: co_await sched.yield().
+     */
+    auto yield()
+    {
+        struct awaiter
+        {
+            scheduler &owner;
+
+            bool await_ready() { return false; }
+            void await_suspend(std::coroutine_handle<> h) { owner.schedule(h); }
+            void await_resume() {}
+        };
+
+        return awaiter{*this};
+    }
+
+    /**
+     * Scheduler that runs in the current thread or nullptr.
+     */
+    static scheduler *current()
+    {
+        return running;
+    }
+
+private:
+    friend struct task::promise_type::final_awaiter;
+
+    struct entry
+    {
+        std::coroutine_handle<> handle;
+        bool (*ready)(void*);
+        void *arg;
+    };
+
+    std::mutex mutex;
+    std::condition_variable cv;
+    std::deque<entry> ready_list;
+    std::size_t alive = 0; // spawned tasks that are not finished, used only in the scheduler thread
+
+    static inline thread_local scheduler *running = nullptr;
+};
+
+inline void task::promise_type::final_awaiter::await_suspend(std::coroutine_handle<promise_type> h) noexcept
+{
+    auto owner = h.promise().owner;
+    h.destroy();
+    owner->alive--;
+}
+
+/**
+ * Wait policy for queues read by coroutines: co_await q.async_read() suspends the coroutine while the queue
+ * is empty and writer schedules it in its scheduler on the next write or when it is finished.
+ *
+ * The same way as spin_park_wait does, coroutine registers itself before the last check of the queue and
+ * writer checks registration after each write, so the notification costs one fence and one load when
+ * nobody is waiting. Writer can see a registration made after the reader has already read the element
+ * of this write, so the queue is checked before the coroutine is resumed and the coroutine registers again
+ * if it is still empty. Only one coroutine can wait for a queue at a time.
+ *
+ * read_for() and read_wait() can be still used outside of coroutines. They spin and then yield.
+ */
+template<unsigned Spins = 128>
+class coroutine_wait
+{
+    struct waiter_node
+    {
+        std::coroutine_handle<> handle;
+        scheduler *resume_on = nullptr;
+        bool (*wakeup)(void*) = nullptr;
+    };
+
+public:
+    /**
+     * Result of queue::async_read(). Resumes with the read element or nullptr if writer is finished
+     * and the queue is empty.
+     */
+    template<class Queue>
+    class read_awaiter : waiter_node
+    {
+    public:
+        using pointer = typename Queue::pointer;
+
+        read_awaiter(Queue &q, coroutine_wait &owner) : q(q), owner(owner)
+        {
+        }
+
+        bool await_ready()
+        {
+            return try_read();
+        }
+
+        bool await_suspend(std::coroutine_handle<> h)
+        {
+            this->handle    = h;
+            this->resume_on = scheduler::current();
+            this->wakeup    = &read_awaiter::on_wakeup;
+            assert(this->resume_on != nullptr && "async_read() should be awaited in a coroutine run by a scheduler");
+
+            return arm();
+        }
+
+        pointer await_resume()
+        {
+            assert(done);
+            return data;
+        }
+
+    private:
+        /*
+         * Register the coroutine and check the queue again. Data written after the registration is either
+         * seen by try_read() or the writer sees the registration. If both happened then the writer may have
+         * taken the registration already and will schedule the coroutine, otherwise the registration is
+         * taken back and the coroutine is not suspended.
+         *
+         * Returns true if the coroutine should stay suspended.
+         */
+        bool arm()
+        {
+            owner.waiting.store(this, std::memory_order_seq_cst);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+
+            if (!try_read())
+            {
+                return true;
+            }
+
+            return owner.waiting.exchange(nullptr, std::memory_order_acq_rel) != this;
+        }
+
+        /*
+         * Called by the scheduler before the coroutine is resumed.
+         */
+        static bool on_wakeup(void *arg)
+        {
+            auto self = static_cast<read_awaiter*>(static_cast<waiter_node*>(arg));
+            return self->done || self->try_read() || !self->arm();
+        }
+
+        /*
+         * Writer could write data and finish between read() and is_writer_finished() calls
+         * so queue is checked once more after the writer is finished.
+         */
+        bool try_read()
+        {
+            done = q.read(data) || (q.is_writer_finished() && (q.read(data), true));
+            return done;
+        }
+
+        Queue &q;
+        coroutine_wait &owner;
+        pointer data = nullptr;
+        bool done = false;
+    };
+
+    template<class Ready, class TimePoint>
+    bool wait_until(Ready ready, const TimePoint &deadline)
+    {
+        return spinner.wait_until(ready, deadline);
+    }
+
+    void notify(bool)
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        if (waiting.load(std::memory_order_relaxed) != nullptr)
+        {
+            auto w = waiting.exchange(nullptr, std::memory_order_acq_rel);
+            if (w != nullptr)
+            {
+                w->resume_on->schedule(w->handle, w->wakeup, w);
+            }
+        }
+    }
+
+    template<class Queue>
+    read_awaiter<Queue> async_read(Queue &q)
+    {
+        return read_awaiter<Queue>(q, *this);
+    }
+
+private:
+    std::atomic<waiter_node*> waiting{nullptr};
+    spin_yield_wait<Spins> spinner;
+};
+
+} // namespace types
+
+#endif // TYPES_COROUTINE_H
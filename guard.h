@@ -37,6 +37,18 @@ namespace types
 
 /**
  * Guard class that wraps each access to the enclosed object with mutex lock/unlock calls.
+ * Besides std::mutex any lock type from locks.h can be used as Mutex.
+ *
+ * Each call via operator-> locks the mutex separately. To do several operations under one lock
+ * use lock() which returns scoped accessor or with() which calls a function with the locked object:
+ *
+ *   {
+ *       auto r = g.lock();
+ *       if (!r->is_writer_finished())
+ *           r->read(data);
+ *   }
+ *
+ *   g.with([&](reader<queue<Data>> &r) { r.drain(process); });
  */
 template<class T, class Mutex = mutex>
 class guard
@@ -48,6 +60,9 @@ public:
     template<class... Args>
     guard(Args&&... args) : obj(std::forward<Args>(args)...) {}
 
+    /**
+     * Accessor that holds the lock until it is destroyed. Can be moved but not copied.
+     */
     class guard_ptr
     {
         guard *obj;
@@ -58,21 +73,59 @@ public:
             obj->mutex.lock($);
         }
 
+        guard_ptr(guard_ptr &&other) : obj(other.obj)
+        {
+            other.obj = nullptr;
+        }
+
+        guard_ptr(const guard_ptr&) = delete;
+        guard_ptr& operator=(const guard_ptr&) = delete;
+        guard_ptr& operator=(guard_ptr&&) = delete;
+
         ~guard_ptr()
         {
-            obj->mutex.unlock($);
+            if (obj != nullptr)
+            {
+                obj->mutex.unlock($);
+            }
         }
 
         T* operator->()
         {
             return &obj->obj;
         }
+
+        T& operator*()
+        {
+            return obj->obj;
+        }
     };
 
     guard_ptr operator->()
     {
         return guard_ptr(this);
     }
+
+    /**
+     * Lock the mutex and return accessor that keeps it locked.
+     */
+    guard_ptr lock()
+    {
+        return guard_ptr(this);
+    }
+
+    /**
+     * Call the function with the enclosed object under one lock.
+     *
+     * @param fn Function with R(T&) signature
+     * @return result of the function.
+     */
+    template<class Function>
+    auto with(Function fn) -> decltype(fn(std::declval<T&>()))
+    {
+        guard_ptr p(this);
+        return fn(*p);
+    }
 };
 
 } // namespace types
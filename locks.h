@@ -0,0 +1,396 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Oleg Khryptul aka HaronK
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef TYPES_LOCKS_H
+#define TYPES_LOCKS_H
+
+// NOTE: locks use std::atomic directly and are not checked with Relacy Race Detector library.
+
+#include "platform.h"
+
+#include <atomic>
+#include <thread>
+
+namespace types
+{
+
+/**
+ * Lock types for guard and other places with short critical sections.
+ * Each of them has lock(), unlock() and try_lock() methods so they can be also used with std::lock_guard
+ * and std::unique_lock.
+ *
+ * All of them spin with exponential backoff first. After the backoff limit is reached waiting thread
+ * yields its cpu (parks on a futex in adaptive_mutex) so lock holder can make progress when there are
+ * more threads than cpus.
+ */
+
+/**
+ * Exponential backoff for spin loops.
+ */
+class spin_backoff
+{
+public:
+    void pause()
+    {
+        if (spins <= max_spins)
+        {
+            for (unsigned i = 0; i < spins; ++i)
+            {
+                cpu_relax();
+            }
+            spins *= 2;
+        }
+        else
+        {
+            std::this_thread::yield();
+        }
+    }
+
+private:
+    static const unsigned max_spins = 64;
+
+    unsigned spins = 1;
+};
+
+/**
+ * Test and test-and-set spinlock.
+ * Waiting threads spin on a load so the cache line is shared while the lock is held and bounces
+ * only when it is released. Not fair.
+ */
+class ttas_spinlock
+{
+public:
+    ttas_spinlock() = default;
+    ttas_spinlock(const ttas_spinlock&) = delete;
+    ttas_spinlock& operator=(const ttas_spinlock&) = delete;
+
+    void lock()
+    {
+        spin_backoff backoff;
+        while (locked.exchange(true, std::memory_order_acquire))
+        {
+            while (locked.load(std::memory_order_relaxed))
+            {
+                backoff.pause();
+            }
+        }
+    }
+
+    bool try_lock()
+    {
+        return !locked.load(std::memory_order_relaxed) && !locked.exchange(true, std::memory_order_acquire);
+    }
+
+    void unlock()
+    {
+        locked.store(false, std::memory_order_release);
+    }
+
+private:
+    std::atomic<bool> locked{false};
+};
+
+/**
+ * Fair (FIFO) ticket lock.
+ * Each thread takes a ticket and waits until it is served. Waiting time is proportional to the number
+ * of threads ahead so each waiting round pauses proportionally to this distance.
+ */
+class ticket_lock
+{
+public:
+    ticket_lock() = default;
+    ticket_lock(const ticket_lock&) = delete;
+    ticket_lock& operator=(const ticket_lock&) = delete;
+
+    void lock()
+    {
+        auto ticket = next_ticket.fetch_add(1, std::memory_order_relaxed);
+
+        for (unsigned round = 0;; ++round)
+        {
+            auto serving = now_serving.load(std::memory_order_acquire);
+            if (serving == ticket)
+            {
+                return;
+            }
+
+            if (round < max_rounds)
+            {
+                for (std::uint32_t i = 0; i < (ticket - serving) * spins_per_waiter; ++i)
+                {
+                    cpu_relax();
+                }
+            }
+            else
+            {
+                std::this_thread::yield();
+            }
+        }
+    }
+
+    bool try_lock()
+    {
+        auto serving = now_serving.load(std::memory_order_acquire);
+        auto ticket  = serving;
+        return next_ticket.compare_exchange_strong(ticket, serving + 1, std::memory_order_acquire,
+                                                   std::memory_order_relaxed);
+    }
+
+    void unlock()
+    {
+        now_serving.store(now_serving.load(std::memory_order_relaxed) + 1, std::memory_order_release);
+    }
+
+private:
+    static const unsigned max_rounds       = 8;
+    static const unsigned spins_per_waiter = 16;
+
+    std::atomic<std::uint32_t> next_ticket{0};
+    std::atomic<std::uint32_t> now_serving{0};
+};
+
+/**
+ * MCS queue lock.
+ * Waiting threads form a queue and each of them spins on its own node so releasing the lock
+ * touches only the cache line of the next thread. Fair (FIFO).
+ *
+ * Nodes are taken from a thread local cache so the lock has std::mutex-like interface and a thread
+ * can hold several locks at once.
+ */
+class mcs_lock
+{
+public:
+    mcs_lock() = default;
+    mcs_lock(const mcs_lock&) = delete;
+    mcs_lock& operator=(const mcs_lock&) = delete;
+
+    void lock()
+    {
+        auto n = node_cache::get().acquire();
+
+        auto prev = tail.exchange(n, std::memory_order_acq_rel);
+        if (prev != nullptr)
+        {
+            n->locked.store(true, std::memory_order_relaxed);
+            prev->next.store(n, std::memory_order_release);
+
+            spin_backoff backoff;
+            while (n->locked.load(std::memory_order_acquire))
+            {
+                backoff.pause();
+            }
+        }
+
+        owner = n;
+    }
+
+    bool try_lock()
+    {
+        auto n = node_cache::get().acquire();
+
+        node *expected = nullptr;
+        if (!tail.compare_exchange_strong(expected, n, std::memory_order_acquire, std::memory_order_relaxed))
+        {
+            node_cache::get().release(n);
+            return false;
+        }
+
+        owner = n;
+        return true;
+    }
+
+    /*
+     * If there is no successor then tail is reset with atomic::compare_exchange().
+     * If it fails then successor has already taken the tail but hasn't linked itself yet so we wait for it.
+     */
+    void unlock()
+    {
+        auto n = owner;
+
+        auto next = n->next.load(std::memory_order_acquire);
+        if (next == nullptr)
+        {
+            auto expected = n;
+            if (tail.compare_exchange_strong(expected, nullptr, std::memory_order_release, std::memory_order_relaxed))
+            {
+                node_cache::get().release(n);
+                return;
+            }
+
+            spin_backoff backoff;
+            while ((next = n->next.load(std::memory_order_acquire)) == nullptr)
+            {
+                backoff.pause();
+            }
+        }
+
+        next->locked.store(false, std::memory_order_release);
+        node_cache::get().release(n);
+    }
+
+private:
+    struct alignas(TYPES_CACHE_LINE_SIZE) node
+    {
+        std::atomic<node*> next{nullptr};
+        std::atomic<bool> locked{false};
+        node *free_next = nullptr;
+    };
+
+    /*
+     * Free nodes of the thread. Nodes are deleted when the thread exits.
+     */
+    class node_cache
+    {
+    public:
+        static node_cache& get()
+        {
+            static thread_local node_cache cache;
+            return cache;
+        }
+
+        ~node_cache()
+        {
+            while (free != nullptr)
+            {
+                auto n = free;
+                free = n->free_next;
+                delete n;
+            }
+        }
+
+        node* acquire()
+        {
+            auto n = free;
+            if (n != nullptr)
+            {
+                free = n->free_next;
+            }
+            else
+            {
+                n = new node;
+            }
+            n->next.store(nullptr, std::memory_order_relaxed);
+            return n;
+        }
+
+        void release(node *n)
+        {
+            n->free_next = free;
+            free = n;
+        }
+
+    private:
+        node *free = nullptr;
+    };
+
+    std::atomic<node*> tail{nullptr};
+    node *owner = nullptr; // node of the thread holding the lock
+};
+
+/**
+ * Adaptive mutex: spins for a while and then parks the thread on a futex.
+ * Uncontended lock and unlock take one atomic operation each and unlock calls the kernel only
+ * when there are parked threads. On platforms without futex threads yield instead of parking.
+ *
+ * State: 0 - unlocked, 1 - locked, 2 - locked and there could be parked threads.
+ */
+class adaptive_mutex
+{
+public:
+    adaptive_mutex() = default;
+    adaptive_mutex(const adaptive_mutex&) = delete;
+    adaptive_mutex& operator=(const adaptive_mutex&) = delete;
+
+    void lock()
+    {
+        std::uint32_t expected = 0;
+        if (state.compare_exchange_strong(expected, 1, std::memory_order_acquire, std::memory_order_relaxed))
+        {
+            return;
+        }
+
+        for (unsigned i = 0; i < spins; ++i)
+        {
+            if (state.load(std::memory_order_relaxed) == 0)
+            {
+                expected = 0;
+                if (state.compare_exchange_weak(expected, 1, std::memory_order_acquire, std::memory_order_relaxed))
+                {
+                    return;
+                }
+            }
+            cpu_relax();
+        }
+
+        while (state.exchange(2, std::memory_order_acquire) != 0)
+        {
+            park();
+        }
+    }
+
+    bool try_lock()
+    {
+        std::uint32_t expected = 0;
+        return state.compare_exchange_strong(expected, 1, std::memory_order_acquire, std::memory_order_relaxed);
+    }
+
+    void unlock()
+    {
+        if (state.exchange(0, std::memory_order_release) == 2)
+        {
+            unpark();
+        }
+    }
+
+private:
+#ifdef __linux__
+    void park()
+    {
+        static_assert(sizeof(state) == sizeof(std::uint32_t), "futex requires 32 bit value");
+        futex_wait(&state, 2, nullptr);
+    }
+
+    void unpark()
+    {
+        futex_wake(&state, 1);
+    }
+#else
+    void park()
+    {
+        std::this_thread::yield();
+    }
+
+    void unpark()
+    {
+    }
+#endif
+
+    static const unsigned spins = 128;
+
+    std::atomic<std::uint32_t> state{0};
+};
+
+} // namespace types
+
+#endif // TYPES_LOCKS_H
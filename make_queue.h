@@ -0,0 +1,150 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Oleg Khryptul aka HaronK
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// NOTE: queue.h, ring_queue.h, mpsc_queue.h and mpmc_queue.h should be included before this file.
+
+#include <type_traits>
+#include <utility>
+
+namespace types
+{
+
+/**
+ * Capacity of make_queue which has no limit.
+ */
+static const std::size_t unbounded = 0;
+
+namespace detail
+{
+
+template<class T, class = void>
+struct has_next : std::false_type {};
+
+template<class T>
+struct has_next<T, decltype(void(std::declval<T&>().next))> : std::true_type {};
+
+template<class T, class = void>
+struct has_atomic_next : std::false_type {};
+
+template<class T>
+struct has_atomic_next<T, decltype(void(std::declval<T&>().next))>
+    : std::is_same<typename std::remove_cv<decltype(std::declval<T&>().next)>::type, atomic<T*>> {};
+
+/*
+ * Queue selected for each combination of writers, readers and capacity.
+ */
+template<class T, bool ManyProducers, bool ManyConsumers, bool Bounded, std::size_t Capacity, class Wait>
+struct queue_selector;
+
+// 1 writer, 1 reader, unbounded: intrusive queue, elements are linked via next pointer
+template<class T, std::size_t Capacity, class Wait>
+struct queue_selector<T, false, false, false, Capacity, Wait>
+{
+    static_assert(has_next<T>::value,
+                  "Unbounded queue links elements via next pointer, T should have `T *next` member");
+
+    using type = queue<T, cache_aligned_layout, Wait>;
+};
+
+// 1 writer, 1 reader, bounded: values in a ring without read-modify-write operations
+template<class T, std::size_t Capacity, class Wait>
+struct queue_selector<T, false, false, true, Capacity, Wait>
+{
+    using type = ring_queue<T, Capacity>;
+};
+
+// N writers, 1 reader, unbounded: intrusive queue with wait-free writers
+template<class T, std::size_t Capacity, class Wait>
+struct queue_selector<T, true, false, false, Capacity, Wait>
+{
+    static_assert(has_atomic_next<T>::value,
+                  "Unbounded queue for several writers links elements concurrently, "
+                  "T should have `atomic<T*> next` member");
+
+    using type = mpsc_queue<T>;
+};
+
+// bounded with several writers or readers: values in a ring with per-cell sequence numbers
+template<class T, bool ManyProducers, bool ManyConsumers, std::size_t Capacity, class Wait>
+struct queue_selector<T, ManyProducers, ManyConsumers, true, Capacity, Wait>
+{
+    using type = mpmc_queue<T, Capacity>;
+};
+
+// unbounded with several readers: no lock free implementation
+template<class T, bool ManyProducers, std::size_t Capacity, class Wait>
+struct queue_selector<T, ManyProducers, true, false, Capacity, Wait>
+{
+    static_assert(sizeof(T) == 0,
+                  "Unbounded queue for several readers is not available, set Capacity or use queue_mesh");
+
+    using type = void;
+};
+
+template<class T, std::size_t Producers, std::size_t Consumers, std::size_t Capacity, class Wait>
+struct make_queue_impl
+{
+    static_assert(Producers > 0 && Consumers > 0, "Queue should have at least 1 writer and 1 reader");
+    static_assert(std::is_same<Wait, busy_spin_wait>::value ||
+                  (Producers == 1 && Consumers == 1 && Capacity == unbounded),
+                  "Wait policy is supported only by unbounded queue for 1 writer and 1 reader");
+
+    using type = typename queue_selector<T, (Producers > 1), (Consumers > 1), (Capacity != unbounded),
+                                         Capacity, Wait>::type;
+};
+
+} // namespace detail
+
+/**
+ * Queue for the given number of writer and reader threads selected at compile time.
+ *
+ * Producers and Consumers are the numbers of threads that write to and read from the queue, any number above 1
+ * means several threads. Capacity is the maximum number of elements or unbounded.
+ *
+ *   writers  readers  capacity   queue
+ *   1        1        unbounded  queue<T, cache_aligned_layout, Wait>   (T has `T *next`)
+ *   1        1        bounded    ring_queue<T, Capacity>
+ *   N        1        unbounded  mpsc_queue<T>                          (T has `atomic<T*> next`)
+ *   N        1        bounded    mpmc_queue<T, Capacity>
+ *   any      M        bounded    mpmc_queue<T, Capacity>
+ *   any      M        unbounded  not available
+ *
+ * Unbounded queues are intrusive: T is the element type linked via its next member and pointer is T*.
+ * Bounded queues store values: use a pointer type as T to pass pointers.
+ * Bounded capacity should be a power of two. Wait policy is supported by queue only, the other queues
+ * have no blocking read.
+ *
+ * All selected queues have write() and read() and work with writer and reader wrappers. Selected queue can
+ * be shared by the given number of threads without guard. LockFreeQueue is never selected: it has no
+ * atomic operations and can be used from one thread only.
+ *
+ * Example:
+ *   make_queue<Data, 1, 1> q;                  // queue<Data>
+ *   make_queue<int, 4, 1, 1024> m;             // mpmc_queue<int, 1024>
+ */
+template<class T, std::size_t Producers, std::size_t Consumers, std::size_t Capacity = unbounded,
+         class Wait = busy_spin_wait>
+using make_queue = typename detail::make_queue_impl<T, Producers, Consumers, Capacity, Wait>::type;
+
+} // namespace types
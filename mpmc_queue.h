@@ -0,0 +1,238 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Oleg Khryptul aka HaronK
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// NOTE: VAR_T and VAR macros are used for testing with
+// Relacy Race Detector library:
+// http://www.1024cores.net/home/relacy-race-detector/rrd-introduction
+// http://www.1024cores.net/home/relacy-race-detector
+
+#include "platform.h"
+
+#if !defined(VAR_T) || !defined(VAR)
+#define VAR_T(t) t
+#define VAR(v) v
+#define VAR_UNDEF
+#endif
+
+namespace types
+{
+
+/**
+ * Bounded lock free queue for multiple writer and multiple reader threads.
+ *
+ * Based on Dmitry Vyukov's bounded MPMC queue:
+ * http://www.1024cores.net/home/lock-free-algorithms/queues/bounded-mpmc-queue
+ *
+ * Each cell of the array has a sequence number which tells whether the cell is free for the writer
+ * with the same position or filled for the reader with the same position. Writers and readers claim
+ * positions with atomic::compare_exchange() on separate counters so they touch each other only
+ * through the cells.
+ *
+ * Values are moved in and out of the array. T should be default constructible and move assignable.
+ *
+ * Interface is the same as in ring_queue so writer and reader wrappers can be used with this class
+ * and shared between threads without guard.
+ * write() returns false when the queue is full.
+ */
+template<class T, std::size_t Capacity>
+class mpmc_queue
+{
+    static_assert(Capacity >= 2 && (Capacity & (Capacity - 1)) == 0, "Capacity should be a power of two");
+
+public:
+    using value_type = T;
+    using pointer    = T; // type passed to write() and read()
+
+    mpmc_queue();
+
+    /**
+     * Write data to the queue. Can be called by any number of writers.
+     *
+     * @param data Value to write to the queue
+     * @return true if data was written otherwise false (queue is full).
+     */
+    bool write(const value_type &data);
+    bool write(value_type &&data);
+
+    /**
+     * Read data from queue. Can be called by any number of readers.
+     *
+     * @param data [OUT] Data to retrieve.
+     * @return true if data was retrieved otherwise false.
+     */
+    bool read(value_type &data);
+
+    void set_writer_finished()
+    {
+        writer_finished.store(true, memory_order_release);
+    }
+
+    bool is_writer_finished()
+    {
+        return writer_finished.load(memory_order_acquire);
+    }
+
+    static constexpr std::size_t capacity()
+    {
+        return Capacity;
+    }
+
+private:
+    static const std::size_t mask = Capacity - 1;
+
+    struct cell
+    {
+        atomic<std::size_t> sequence;
+        VAR_T(value_type) data;
+    };
+
+    template<class U>
+    bool emplace(U &&data);
+
+    alignas(TYPES_CACHE_LINE_SIZE) cell buffer[Capacity];
+
+    // writers' state
+    alignas(TYPES_CACHE_LINE_SIZE) atomic<std::size_t> enqueue_pos;
+
+    // readers' state
+    alignas(TYPES_CACHE_LINE_SIZE) atomic<std::size_t> dequeue_pos;
+
+    // rarely changed state
+    alignas(TYPES_CACHE_LINE_SIZE) atomic<bool> writer_finished;
+};
+
+template<class T, std::size_t Capacity>
+mpmc_queue<T, Capacity>::mpmc_queue()
+{
+    for (std::size_t i = 0; i < Capacity; ++i)
+    {
+        buffer[i].sequence.store(i, memory_order_relaxed);
+    }
+
+    enqueue_pos.store(0, memory_order_relaxed);
+    dequeue_pos.store(0, memory_order_relaxed);
+    writer_finished.store(false, memory_order_relaxed);
+}
+
+template<class T, std::size_t Capacity>
+bool mpmc_queue<T, Capacity>::write(const value_type &data)
+{
+    return emplace(data);
+}
+
+template<class T, std::size_t Capacity>
+bool mpmc_queue<T, Capacity>::write(value_type &&data)
+{
+    return emplace(std::move(data));
+}
+
+/*
+ * Write data to the queue.
+ * Algorithm:
+ * 1. Load writers' position and sequence of its cell.
+ * 2. If sequence is equal to the position then the cell is free. Claim the position using
+ *    atomic::compare_exchange(). On failure repeat with the updated position.
+ * 3. If sequence is less than the position then the cell is not read yet (queue is full).
+ * 4. Otherwise another writer has claimed the position. Reload position and repeat.
+ * 5. Move data to the cell and publish it by setting sequence to position + 1.
+ */
+template<class T, std::size_t Capacity>
+template<class U>
+bool mpmc_queue<T, Capacity>::emplace(U &&data)
+{
+    cell *c;
+    std::size_t pos = enqueue_pos.load(memory_order_relaxed);
+    for (;;)
+    {
+        c = &buffer[pos & mask];
+        std::size_t seq = c->sequence.load(memory_order_acquire);
+        auto diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos);
+        if (diff == 0)
+        {
+            if (enqueue_pos.compare_exchange_weak(pos, pos + 1, memory_order_relaxed))
+            {
+                break;
+            }
+        }
+        else if (diff < 0)
+        {
+            return false;
+        }
+        else
+        {
+            pos = enqueue_pos.load(memory_order_relaxed);
+        }
+    }
+
+    c->VAR(data) = std::forward<U>(data);
+    c->sequence.store(pos + 1, memory_order_release);
+
+    return true;
+}
+
+/*
+ * Read data from the queue.
+ * Algorithm is the same as for write() but readers wait for the sequence equal to position + 1
+ * and release the cell for the next round of writers by setting its sequence to position + Capacity.
+ */
+template<class T, std::size_t Capacity>
+bool mpmc_queue<T, Capacity>::read(value_type &data)
+{
+    cell *c;
+    std::size_t pos = dequeue_pos.load(memory_order_relaxed);
+    for (;;)
+    {
+        c = &buffer[pos & mask];
+        std::size_t seq = c->sequence.load(memory_order_acquire);
+        auto diff = static_cast<std::ptrdiff_t>(seq) - static_cast<std::ptrdiff_t>(pos + 1);
+        if (diff == 0)
+        {
+            if (dequeue_pos.compare_exchange_weak(pos, pos + 1, memory_order_relaxed))
+            {
+                break;
+            }
+        }
+        else if (diff < 0)
+        {
+            return false;
+        }
+        else
+        {
+            pos = dequeue_pos.load(memory_order_relaxed);
+        }
+    }
+
+    data = std::move(c->VAR(data));
+    c->sequence.store(pos + Capacity, memory_order_release);
+
+    return true;
+}
+
+} // namespace types
+
+#ifdef VAR_UNDEF
+#undef VAR_T
+#undef VAR
+#undef VAR_UNDEF
+#endif
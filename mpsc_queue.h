@@ -0,0 +1,315 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Oleg Khryptul aka HaronK
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// NOTE: atomic and memory_order are used without std:: prefix for testing with
+// Relacy Race Detector library:
+// http://www.1024cores.net/home/relacy-race-detector/rrd-introduction
+
+#include "platform.h"
+
+namespace types
+{
+
+/**
+ * Unbounded lock free queue for multiple writer and 1 reader threads.
+ *
+ * Based on Dmitry Vyukov's intrusive MPSC node-based queue:
+ * http://www.1024cores.net/home/lock-free-algorithms/queues/intrusive-mpsc-node-based-queue
+ *
+ * Writers append an element with one atomic::exchange() on the tail and then link it to the previous
+ * element, so write() is wait-free. Instead of a stub node the tail points to the link (next pointer of
+ * the last element or reader's top) that should receive the next element, so T doesn't have to be
+ * default constructible.
+ *
+ * As in queue.h elements are linked via next pointer, but here writers link them concurrently with the
+ * reader so T should have `atomic<T*> next` member. Elements with atomic next can be used with queue.h too.
+ *
+ * Between the exchange and the link store of a writer the reader can't see the element and the ones after
+ * it, in this case read() returns false until the writer finishes.
+ *
+ * Interface is the same as in queue.h so writer and reader wrappers can be used with this class and
+ * writer wrapper can be shared between threads without guard.
+ * Remaining elements are deleted by the destructor.
+ */
+template<class T>
+class mpsc_queue
+{
+public:
+    using value_type = T;
+    using pointer    = T*;
+
+    mpsc_queue();
+    ~mpsc_queue();
+
+    mpsc_queue(const mpsc_queue&) = delete;
+    mpsc_queue& operator=(const mpsc_queue&) = delete;
+
+    /**
+     * Write data to the queue. Can be called by any number of writers.
+     *
+     * @param data Value to write to the queue
+     * @return true if the queue was empty before this element (reader may be waiting for it).
+     */
+    bool write(pointer data);
+
+    /**
+     * Write chain of elements linked via next pointer to the queue. Can be called by any number of writers.
+     * Whole chain is appended with the same atomic operations as a single element and is not interleaved
+     * with elements of other writers.
+     *
+     * @param first First element of the chain.
+     * @param last Last element of the chain. Its next pointer is reset to null.
+     * @return true if the queue was empty before this chain.
+     */
+    bool write_batch(pointer first, pointer last);
+
+    /**
+     * Read data from queue. Reader only method.
+     *
+     * @param data [OUT] Data to retrieve.
+     * @return true if data was retrieved otherwise false.
+     */
+    bool read(pointer &data);
+
+    /**
+     * Take all linked elements from the queue. Reader only method.
+     * Returned elements are linked via next pointer and belong to the reader.
+     *
+     * @return first element of the segment or nullptr if queue is empty.
+     */
+    pointer read_all();
+
+    /**
+     * Read all elements and pass each of them to fn(pointer). Reader only method.
+     *
+     * @return number of processed elements.
+     */
+    template<class Function>
+    std::size_t drain(Function fn);
+
+    /**
+     * All writers are finished. Should be called once after the last write.
+     */
+    void set_writer_finished()
+    {
+        writer_finished.store(true, memory_order_release);
+    }
+
+    bool is_writer_finished()
+    {
+        return writer_finished.load(memory_order_acquire);
+    }
+
+private:
+    using link = atomic<pointer>;
+
+    bool append(pointer first, pointer last);
+    bool take_last(pointer last);
+
+    // writers' state
+    alignas(TYPES_CACHE_LINE_SIZE) atomic<link*> writer_tail;
+
+    // reader's state
+    alignas(TYPES_CACHE_LINE_SIZE) link reader_top;
+
+    // rarely changed state
+    alignas(TYPES_CACHE_LINE_SIZE) atomic<bool> writer_finished;
+};
+
+template<class T>
+mpsc_queue<T>::mpsc_queue()
+{
+    reader_top.store(nullptr, memory_order_relaxed);
+    writer_tail.store(&reader_top, memory_order_relaxed);
+    writer_finished.store(false, memory_order_relaxed);
+}
+
+template<class T>
+mpsc_queue<T>::~mpsc_queue()
+{
+    auto elem = reader_top.load(memory_order_acquire);
+    while (elem != nullptr)
+    {
+        auto next = elem->next.load(memory_order_acquire);
+        delete elem;
+        elem = next;
+    }
+}
+
+template<class T>
+bool mpsc_queue<T>::write(pointer data)
+{
+    assert(data != nullptr);
+
+    return append(data, data);
+}
+
+template<class T>
+bool mpsc_queue<T>::write_batch(pointer first, pointer last)
+{
+    assert(first != nullptr);
+    assert(last != nullptr);
+
+    return append(first, last);
+}
+
+/*
+ * Append chain of elements.
+ * Algorithm:
+ * 1. Reset next pointer of the last element.
+ * 2. Replace the tail with the link of the last element using atomic::exchange().
+ *    Exchange orders writers: the previous link is owned by this writer only.
+ * 3. Store the first element to the previous link using atomic::store().
+ *    After this reader can see the chain.
+ */
+template<class T>
+bool mpsc_queue<T>::append(pointer first, pointer last)
+{
+    last->next.store(nullptr, memory_order_relaxed);
+
+    link *prev = writer_tail.exchange(&last->next, memory_order_acq_rel);
+    prev->store(first, memory_order_release);
+
+    return prev == &reader_top;
+}
+
+/*
+ * Read data from the queue.
+ * Algorithm:
+ * 1. Retrieve reader top using atomic::load(). If it is null then the queue is empty.
+ * 2. If top element is linked to the next one then it becomes reader top and the element is returned.
+ * 3. Otherwise the element can be the last one, see take_last().
+ */
+template<class T>
+bool mpsc_queue<T>::read(pointer &data)
+{
+    pointer top = reader_top.load(memory_order_acquire);
+    if (top == nullptr)
+    {
+        return false;
+    }
+
+    pointer next = top->next.load(memory_order_acquire);
+    if (next != nullptr)
+    {
+        reader_top.store(next, memory_order_relaxed);
+    }
+    else if (!take_last(top))
+    {
+        return false;
+    }
+
+    data = top;
+    return true;
+}
+
+/*
+ * Take elements up to the last linked one the same way as read() does.
+ * Chain is cut before the last element if a writer is linking an element after it.
+ */
+template<class T>
+typename mpsc_queue<T>::pointer mpsc_queue<T>::read_all()
+{
+    pointer first = reader_top.load(memory_order_acquire);
+    if (first == nullptr)
+    {
+        return nullptr;
+    }
+
+    pointer prev = nullptr;
+    pointer last = first;
+    for (pointer next = last->next.load(memory_order_acquire); next != nullptr;
+         next = last->next.load(memory_order_acquire))
+    {
+        prev = last;
+        last = next;
+    }
+
+    if (take_last(last))
+    {
+        return first;
+    }
+
+    if (prev == nullptr)
+    {
+        return nullptr;
+    }
+
+    prev->next.store(nullptr, memory_order_relaxed);
+    return first;
+}
+
+template<class T>
+template<class Function>
+std::size_t mpsc_queue<T>::drain(Function fn)
+{
+    std::size_t count = 0;
+
+    pointer elem = read_all();
+    while (elem != nullptr)
+    {
+        pointer next = elem->next.load(memory_order_relaxed);
+        fn(elem);
+        elem = next;
+        count++;
+    }
+
+    return count;
+}
+
+/*
+ * Take the element which had no next one when reader checked it. Reader only method.
+ * Algorithm:
+ * 1. Set reader top to null.
+ * 2. Move the tail from the element's link back to reader top using atomic::compare_exchange().
+ *    On success the queue is empty and writers append new elements to reader top.
+ * 3. Otherwise a writer has appended its element after this one. If it has linked it already then
+ *    it becomes reader top and the element's next pointer is reset.
+ * 4. Otherwise the writer is in progress: reader top is restored and the element stays in the queue.
+ * Reader top is changed here only while the tail doesn't point to it, so writers don't touch it.
+ */
+template<class T>
+bool mpsc_queue<T>::take_last(pointer last)
+{
+    reader_top.store(nullptr, memory_order_relaxed);
+
+    link *expected = &last->next;
+    if (writer_tail.compare_exchange_strong(expected, &reader_top, memory_order_acq_rel))
+    {
+        return true;
+    }
+
+    pointer next = last->next.load(memory_order_acquire);
+    if (next == nullptr)
+    {
+        reader_top.store(last, memory_order_relaxed);
+        return false;
+    }
+
+    reader_top.store(next, memory_order_relaxed);
+    last->next.store(nullptr, memory_order_relaxed);
+    return true;
+}
+
+} // namespace types
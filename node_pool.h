@@ -0,0 +1,283 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Oleg Khryptul aka HaronK
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// NOTE: this class uses atomic and memory_order_* names from the including translation unit the same way
+// queue.h does so it can be used with Relacy Race Detector library.
+
+#include "platform.h"
+
+#include <new>
+#include <type_traits>
+#include <utility>
+#include <vector>
+
+namespace types
+{
+
+/**
+ * Pool of nodes for queue elements.
+ *
+ * Pool is owned by one allocating (writer) thread. Freed nodes are returned to the pool from any thread
+ * without locks and the owner picks them up only when its own free list is empty, so in a steady state
+ * messages are passed without any malloc/free calls.
+ *
+ * Owner thread has a private free list. Other threads push freed nodes to the shared return stack
+ * with atomic::compare_exchange(). Owner takes the whole stack with one atomic::exchange(null) so there is
+ * no ABA problem. return_batch class can be used by a reader to return nodes with one
+ * atomic operation per batch instead of one per node.
+ *
+ * Memory is allocated in slabs of slab_size nodes and is released only when the pool is destroyed.
+ * All nodes should be deallocated before that. Note that queue destructor deletes remaining elements
+ * so they should be returned to the pool with queue::clear() before the queue is destroyed.
+ *
+ * Example:
+ *   node_pool<Data> pool(1024);             // preallocate 1024 nodes
+ *   q.write(pool.allocate(value));          // writer
+ *   q.drain([&](Data *d) { ...; pool.deallocate(d); }); // reader
+ */
+template<class T>
+class node_pool
+{
+    union slot
+    {
+        slot *next;
+        typename std::aligned_storage<sizeof(T), alignof(T)>::type storage;
+    };
+
+public:
+    using value_type = T;
+    using pointer    = T*;
+
+    /**
+     * Pool statistics. Collected by the owner thread.
+     */
+    struct stats
+    {
+        std::size_t hits   = 0; // allocations served from free nodes
+        std::size_t misses = 0; // allocations that required a new slab
+        std::size_t slabs  = 0; // allocated slabs
+        std::size_t nodes  = 0; // nodes in all slabs
+    };
+
+    /**
+     * Batch of nodes that are returned to the pool with one atomic operation. Should be used by one thread.
+     * Remaining nodes are returned on destruction.
+     */
+    class return_batch
+    {
+    public:
+        explicit return_batch(node_pool &pool, std::size_t size = 32) : pool(pool), size(size) {}
+
+        ~return_batch()
+        {
+            flush();
+        }
+
+        void deallocate(pointer data);
+
+        void flush();
+
+    private:
+        node_pool &pool;
+        std::size_t size;
+        std::size_t count = 0;
+        slot *first = nullptr;
+        slot *last  = nullptr;
+    };
+
+    /**
+     * @param preallocate Number of nodes to allocate at startup.
+     * @param slab_size Number of nodes allocated at once when the pool is empty.
+     */
+    explicit node_pool(std::size_t preallocate = 0, std::size_t slab_size = 64);
+    ~node_pool();
+
+    node_pool(const node_pool&) = delete;
+    node_pool& operator=(const node_pool&) = delete;
+
+    /**
+     * Construct new element. Owner only method.
+     */
+    template<class... Args>
+    pointer allocate(Args&&... args);
+
+    /**
+     * Destroy element and return its node to the pool. Can be called from any thread.
+     */
+    void deallocate(pointer data);
+
+    /**
+     * Owner only method.
+     */
+    const stats& get_stats() const
+    {
+        return pool_stats;
+    }
+
+private:
+    static slot* to_slot(pointer data)
+    {
+        return reinterpret_cast<slot*>(data);
+    }
+
+    void add_slab(std::size_t size);
+    void push_returned(slot *first, slot *last);
+
+    // owner's state
+    slot *free_list = nullptr;
+    std::size_t slab_size;
+    std::vector<slot*> slabs;
+    stats pool_stats;
+
+    // nodes returned by other threads
+    alignas(TYPES_CACHE_LINE_SIZE) atomic<slot*> returned;
+};
+
+template<class T>
+node_pool<T>::node_pool(std::size_t preallocate, std::size_t slab_size) : slab_size(slab_size > 0 ? slab_size : 1)
+{
+    returned.store(nullptr, memory_order_relaxed);
+
+    if (preallocate > 0)
+    {
+        add_slab(preallocate);
+    }
+}
+
+template<class T>
+node_pool<T>::~node_pool()
+{
+    for (auto slab : slabs)
+    {
+        delete[] slab;
+    }
+}
+
+/*
+ * Allocate node.
+ * Algorithm:
+ * 1. Take node from the owner's free list.
+ * 2. If it is empty then take the whole return stack using atomic::exchange(null).
+ * 3. If it is empty too then allocate new slab.
+ */
+template<class T>
+template<class... Args>
+typename node_pool<T>::pointer node_pool<T>::allocate(Args&&... args)
+{
+    if (free_list == nullptr)
+    {
+        free_list = returned.exchange(nullptr, memory_order_acquire);
+        if (free_list == nullptr)
+        {
+            pool_stats.misses++;
+            add_slab(slab_size);
+        }
+        else
+        {
+            pool_stats.hits++;
+        }
+    }
+    else
+    {
+        pool_stats.hits++;
+    }
+
+    slot *s = free_list;
+    free_list = s->next;
+
+    return new (&s->storage) T(std::forward<Args>(args)...);
+}
+
+template<class T>
+void node_pool<T>::deallocate(pointer data)
+{
+    assert(data != nullptr);
+
+    data->~T();
+
+    slot *s = to_slot(data);
+    push_returned(s, s);
+}
+
+template<class T>
+void node_pool<T>::add_slab(std::size_t size)
+{
+    slot *slab = new slot[size];
+    slabs.push_back(slab);
+
+    for (std::size_t i = 0; i + 1 < size; ++i)
+    {
+        slab[i].next = &slab[i + 1];
+    }
+    slab[size - 1].next = free_list;
+    free_list = slab;
+
+    pool_stats.slabs++;
+    pool_stats.nodes += size;
+}
+
+template<class T>
+void node_pool<T>::push_returned(slot *first, slot *last)
+{
+    slot *top = returned.load(memory_order_relaxed);
+    do
+    {
+        last->next = top;
+    }
+    while (!returned.compare_exchange_weak(top, first, memory_order_release, memory_order_relaxed));
+}
+
+template<class T>
+void node_pool<T>::return_batch::deallocate(pointer data)
+{
+    assert(data != nullptr);
+
+    data->~T();
+
+    auto s = node_pool::to_slot(data);
+    s->next = first;
+    first = s;
+    if (last == nullptr)
+    {
+        last = s;
+    }
+
+    if (++count >= size)
+    {
+        flush();
+    }
+}
+
+template<class T>
+void node_pool<T>::return_batch::flush()
+{
+    if (first != nullptr)
+    {
+        pool.push_returned(first, last);
+        first = last = nullptr;
+        count = 0;
+    }
+}
+
+} // namespace types
@@ -0,0 +1,119 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Oleg Khryptul aka HaronK
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef TYPES_PLATFORM_H
+#define TYPES_PLATFORM_H
+
+#include <cstddef>
+#include <cstdint>
+#include <new> // defines __cpp_lib_hardware_interference_size
+
+#ifdef __linux__
+#include <linux/futex.h>
+#include <sys/syscall.h>
+#include <ctime>
+#include <unistd.h>
+#endif
+
+#ifdef _MSC_VER
+#include <intrin.h>
+#endif
+
+/**
+ * Size of the cache line used to keep data written by different threads apart.
+ * Can be overridden with -DTYPES_CACHE_LINE_SIZE=<size>.
+ *
+ * GCC warns about any use of std::hardware_destructive_interference_size in headers because its value
+ * depends on -mtune, so the fallback values are used there.
+ */
+#ifndef TYPES_CACHE_LINE_SIZE
+#if defined(__cpp_lib_hardware_interference_size) && (!defined(__GNUC__) || defined(__clang__))
+#define TYPES_CACHE_LINE_SIZE std::hardware_destructive_interference_size
+#elif defined(__powerpc64__) || (defined(__aarch64__) && defined(__APPLE__))
+#define TYPES_CACHE_LINE_SIZE 128
+#else
+#define TYPES_CACHE_LINE_SIZE 64
+#endif
+#endif
+
+namespace types
+{
+
+/**
+ * Layout policies for the data shared between threads.
+ *
+ * cache_aligned_layout puts the state of each side to its own cache line so writer and reader
+ * don't invalidate each other's cache lines when they update their own state.
+ * compact_layout keeps all the state together to save memory.
+ */
+struct cache_aligned_layout
+{
+    static const std::size_t alignment = TYPES_CACHE_LINE_SIZE;
+};
+
+struct compact_layout
+{
+    static const std::size_t alignment = 1;
+};
+
+/**
+ * Hint to the cpu that the thread is spinning in a wait loop.
+ */
+inline void cpu_relax()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    __builtin_ia32_pause();
+#elif defined(__aarch64__) || defined(__arm__)
+    __asm__ __volatile__("yield");
+#elif defined(_MSC_VER)
+    _mm_pause();
+#endif
+}
+
+#ifdef __linux__
+
+/**
+ * Block while 32 bit value at the address is equal to the expected one.
+ * Can return spuriously.
+ *
+ * @param timeout Relative timeout or nullptr to wait forever.
+ */
+inline void futex_wait(const void *addr, std::uint32_t expected, const struct timespec *timeout)
+{
+    syscall(SYS_futex, addr, FUTEX_WAIT_PRIVATE, expected, timeout, nullptr, 0);
+}
+
+/**
+ * Wake up to count threads blocked in futex_wait() on the address.
+ */
+inline void futex_wake(const void *addr, int count)
+{
+    syscall(SYS_futex, addr, FUTEX_WAKE_PRIVATE, count, nullptr, nullptr, 0);
+}
+
+#endif
+
+} // namespace types
+
+#endif // TYPES_PLATFORM_H
@@ -27,6 +27,12 @@
 // http://www.1024cores.net/home/relacy-race-detector/rrd-introduction
 // http://www.1024cores.net/home/relacy-race-detector
 
+#include "platform.h"
+#include "wait.h"
+#include "stats.h"
+
+#include <utility>
+
 #if !defined(VAR_T) || !defined(VAR)
 #define VAR_T(t) t
 #define VAR(v) v
@@ -52,15 +58,98 @@ namespace types
  * This class can be also used in multiple writer and/or reader configuration.
  * To do this one should use guard, writer and reader template classes. See test/queue_multi_rw_test.cpp
  * file for example.
+ *
+ * Layout policy defines how writer's and reader's state is placed in memory. By default each side
+ * has its own cache line (see platform.h).
+ *
+ * Wait policy defines how read_for() and read_wait() wait for data: busy spin, spin then yield,
+ * spin then park or eventfd for event loops (see wait.h). With coroutine_wait (see coroutine.h)
+ * coroutines can also await data with async_read().
+ *
+ * Flush policy defines how long writer keeps written elements in its private pending segment before
+ * passing them to the queue: after N elements, after T microseconds or until explicit flush() call.
+ * Keeping elements private lets writer pass them with one atomic operation but delays them for reader.
+ * By default each element is passed immediately.
+ *
+ * Capacity policy limits the number of written but not read elements for try_write() and write_for():
+ * when the queue is full they reject the element, wait for the reader, drop the element or drop the oldest
+ * element that writer still owns. Writer and reader count their elements on their own cache lines and writer
+ * loads reader's counter only when the queue looks full. Pending elements are counted too, so a full queue
+ * passes them to the reader before rejecting or waiting. By default the queue is unbounded and nothing is counted.
+ *
+ * Stats policy defines which counters are collected (see stats.h). Writer's and reader's counters
+ * are kept on the cache line of the corresponding side. By default nothing is collected.
  */
-template<class T>
+template<class T, class Layout = cache_aligned_layout, class Wait = busy_spin_wait, class Stats = no_stats>
 class queue
 {
 public:
     using value_type = T;
     using pointer    = T*;
 
-    queue();
+    /**
+     * Defines when writer's pending elements are passed to the queue.
+     */
+    struct flush_policy
+    {
+        flush_policy(std::size_t max_items = 1, std::chrono::microseconds max_delay = std::chrono::microseconds(0))
+            : max_items(max_items), max_delay(max_delay)
+        {
+        }
+
+        static flush_policy immediate()                                 { return flush_policy(); }
+        static flush_policy after_items(std::size_t n)                  { return flush_policy(n); }
+        static flush_policy after_delay(std::chrono::microseconds delay) { return flush_policy(SIZE_MAX, delay); }
+        static flush_policy on_idle()                                   { return flush_policy(SIZE_MAX); }
+
+        std::size_t max_items;               // flush when pending segment has this number of elements
+        std::chrono::microseconds max_delay; // flush when the oldest pending element waits this long, 0 - never
+    };
+
+    /**
+     * What try_write() does when the queue is full.
+     * Dropped elements are passed to the disposer given to try_write(), the queue never deletes them itself.
+     * try_write() without a disposer can be used only with the reject policy.
+     */
+    enum class overflow_policy
+    {
+        reject,      // element is not written and stays with the caller
+        drop_newest, // element is disposed
+        drop_oldest  // the oldest element that is not taken by the reader yet is disposed and element is written
+    };
+
+    /**
+     * Result of try_write().
+     */
+    enum class write_result
+    {
+        written,  // element is written, possibly after the oldest one was dropped
+        rejected, // element is not written and stays with the caller
+        dropped   // element is not written and was passed to the disposer
+    };
+
+    /**
+     * Maximum number of written but not read elements.
+     */
+    struct capacity_policy
+    {
+        explicit capacity_policy(std::size_t max_items = 0, overflow_policy overflow = overflow_policy::reject)
+            : max_items(max_items), overflow(overflow)
+        {
+        }
+
+        static capacity_policy unbounded() { return capacity_policy(); }
+        static capacity_policy bounded(std::size_t max_items, overflow_policy overflow = overflow_policy::reject)
+        {
+            return capacity_policy(max_items, overflow);
+        }
+
+        std::size_t max_items;    // 0 - unbounded
+        overflow_policy overflow; // used by try_write()
+    };
+
+    explicit queue(const flush_policy &policy = flush_policy(), const capacity_policy &capacity = capacity_policy());
+    explicit queue(const capacity_policy &capacity) : queue(flush_policy(), capacity) {}
     ~queue();
 
     /**
@@ -72,6 +161,104 @@ public:
      */
     bool write(pointer data);
 
+    /**
+     * Write data to the queue if it is not full. Writer only method.
+     * Queue should have the reject overflow policy, drop policies need a disposer. Unbounded queue is never full.
+     *
+     * @param data Value to write to the queue
+     * @return written or rejected (element stays with the caller).
+     */
+    write_result try_write(pointer data)
+    {
+        assert(capacity_config.overflow == overflow_policy::reject && "drop policies need a disposer");
+        return write_or_overflow(data, overflow_policy::reject, [](pointer) {});
+    }
+
+    /**
+     * Write data to the queue if it is not full. Writer only method.
+     * When the queue is full the element is rejected or dropped according to the overflow policy.
+     * Dropped elements, the new one or the oldest one, are passed to the function.
+     *
+     * @param data Value to write to the queue
+     * @param dispose Function with void(pointer) signature
+     * @return written, rejected (element stays with the caller) or dropped (element is passed to dispose).
+     */
+    template<class Function>
+    write_result try_write(pointer data, Function dispose)
+    {
+        return write_or_overflow(data, capacity_config.overflow, dispose);
+    }
+
+    /**
+     * Write data to the queue waiting until reader makes room for it. Writer only method.
+     *
+     * @param data Value to write to the queue
+     * @param timeout Maximum time to wait.
+     * @return true if data was written otherwise false (timeout, element stays with the caller).
+     */
+    template<class Rep, class Period>
+    bool write_for(pointer data, const std::chrono::duration<Rep, Period> &timeout);
+
+    /**
+     * Write chain of elements linked via next pointer to the queue. Writer only method.
+     * Whole chain is passed with the same atomic operations as a single element.
+     *
+     * @param first First element of the chain
+     * @param last Last element of the chain. Its next pointer is reset.
+     * @return true if data was send to the reader otherwise false
+     */
+    bool write_batch(pointer first, pointer last);
+
+    /**
+     * Pass pending elements to the queue. Writer only method.
+     * Should be called when writer becomes idle unless flush policy passes elements immediately.
+     *
+     * @return true if data was send to the reader otherwise false
+     */
+    bool flush();
+
+    /**
+     * Pass pending elements to the queue if flush policy says they are due. Writer only method.
+     * Writer can call it periodically while it has nothing to write to bound the delay of the elements.
+     *
+     * @return true if data was send to the reader otherwise false
+     */
+    bool flush_if_due();
+
+    /**
+     * Change flush policy. Writer only method. Already pending elements are checked on the next write.
+     */
+    void set_flush_policy(const flush_policy &policy)
+    {
+        flush_config = policy;
+    }
+
+    const flush_policy &get_flush_policy() const
+    {
+        return flush_config;
+    }
+
+    const capacity_policy &get_capacity_policy() const
+    {
+        return capacity_config;
+    }
+
+    /**
+     * Number of written but not read elements. Writer only method. Returns 0 for unbounded queue.
+     */
+    std::size_t depth()
+    {
+        return written_count - read_count.load(memory_order_acquire);
+    }
+
+    /**
+     * Wait policy object, e.g. to get the descriptor of eventfd_wait.
+     */
+    Wait &get_wait_policy()
+    {
+        return waiter;
+    }
+
     /**
      * Read data from queue. Reader only method.
      *
@@ -79,59 +266,281 @@ public:
      * @return true if data was retrieved otherwise false.
      */
     bool read(pointer &data);
-    
+
+    /**
+     * Take the whole available segment from the queue. Reader only method.
+     * Returned elements are linked via next pointer and belong to the reader.
+     *
+     * @return first element of the segment or nullptr if queue is empty.
+     */
+    pointer read_all();
+
+    /**
+     * Take the whole available segment from the queue and pass each element to the function. Reader only method.
+     * Next pointer is read before the call so function can delete the element.
+     *
+     * @param fn Function with void(pointer) signature
+     * @return number of processed elements.
+     */
+    template<class Function>
+    std::size_t drain(Function fn);
+
+    /**
+     * Pass all remaining elements, including pending ones, to the function and leave the queue empty.
+     * Should be called only when neither writer nor reader works with the queue, e.g. before destruction
+     * of a queue whose elements are not allocated with new (see node_pool.h).
+     *
+     * @param fn Function with void(pointer) signature
+     * @return number of processed elements.
+     */
+    template<class Function>
+    std::size_t clear(Function fn);
+
+    /**
+     * Read data from queue waiting for it according to the wait policy. Reader only method.
+     *
+     * @param data [OUT] Data to retrieve.
+     * @param timeout Maximum time to wait.
+     * @return true if data was retrieved otherwise false (timeout or writer is finished and queue is empty).
+     */
+    template<class Rep, class Period>
+    bool read_for(pointer &data, const std::chrono::duration<Rep, Period> &timeout);
+
+    /**
+     * Read data from queue waiting for it until writer is finished. Reader only method.
+     *
+     * @param data [OUT] Data to retrieve.
+     * @return true if data was retrieved otherwise false (writer is finished and queue is empty).
+     */
+    bool read_wait(pointer &data);
+
+    /**
+     * Read data from the queue in a coroutine. Reader only method.
+     * co_await q.async_read() suspends the coroutine while the queue is empty and returns nullptr when
+     * writer is finished and the queue is empty. Available with wait policies that support coroutines
+     * (see coroutine.h).
+     */
+    template<class W = Wait>
+    auto async_read() -> decltype(std::declval<W&>().async_read(*this))
+    {
+        return waiter.async_read(*this);
+    }
+
     void set_writer_finished()
     {
-        writer_finished = true;
+        flush();
+        writer_finished.store(true, memory_order_release);
+        waiter.notify(true);
     }
 
     bool is_writer_finished()
     {
-        return writer_finished;
+        return writer_finished.load(memory_order_acquire);
+    }
+
+    /**
+     * Current values of the counters. Can be called from any thread.
+     * Counters are updated independently so the values are not consistent with each other.
+     */
+    queue_stats snapshot() const
+    {
+        return Stats::snapshot(writer_stats, reader_stats);
     }
 
 private:
-    atomic<pointer> writer_top;
+    // writer's state
+    alignas(Layout::alignment) alignas(atomic<pointer>) atomic<pointer> writer_top;
     VAR_T(pointer) writer_bottom;
+    VAR_T(pointer) pending_top; // elements that are not passed to the queue yet
+    VAR_T(pointer) pending_bottom;
+    std::size_t pending_count;
+    std::chrono::steady_clock::time_point pending_since;
+    flush_policy flush_config;
+    std::size_t written_count; // written and not dropped elements, counted only if the queue is bounded
+    std::size_t cached_read_count;
+    typename Stats::writer_side writer_stats;
 
-    bool writer_finished;
+    // reader's state
+    alignas(Layout::alignment) alignas(atomic<pointer>) atomic<pointer> reader_top;
+    atomic<std::size_t> read_count; // counted only if the queue is bounded
+    typename Stats::reader_side reader_stats;
 
-    atomic<pointer> reader_top;
+    // rarely changed state
+    alignas(Layout::alignment) alignas(atomic<bool>) atomic<bool> writer_finished;
+    const capacity_policy capacity_config;
+    Wait waiter;
+
+    template<class TimePoint>
+    bool read_until(pointer &data, const TimePoint &deadline);
+
+    bool publish(pointer first, pointer last, std::size_t count);
+
+    void restore_writer_queue(pointer w_top);
+
+    bool is_bounded() const
+    {
+        return capacity_config.max_items != 0;
+    }
+
+    bool is_full();
+
+    template<class Function>
+    write_result write_or_overflow(pointer data, overflow_policy overflow, Function dispose);
+
+    template<class Function>
+    bool drop_oldest(Function dispose);
+
+    void count_read(std::size_t n)
+    {
+        read_count.store(read_count.load(memory_order_relaxed) + n, memory_order_release);
+    }
+
+    /*
+     * Count the segment taken by read_all() or drain().
+     */
+    void count_taken(bool taken, std::size_t count)
+    {
+        if (is_bounded() && taken)
+        {
+            count_read(count);
+        }
+
+        if (taken)
+        {
+            reader_stats.on_read(count);
+        }
+        else
+        {
+            reader_stats.on_empty_read();
+        }
+    }
+
+    static std::uint64_t chain_length(pointer first);
+
+    pointer take_writer_queue();
+
+    pointer take_all();
+
+    /*
+     * Value of reader top while reader takes writer's queue. Writer treats it as not empty reader's queue.
+     */
+    pointer reading_mark()
+    {
+        return reinterpret_cast<pointer>(&reader_top);
+    }
 };
 
-template<class T>
-queue<T>::queue() : reader_top(nullptr)
+template<class T, class Layout, class Wait, class Stats>
+queue<T, Layout, Wait, Stats>::queue(const flush_policy &policy, const capacity_policy &capacity)
+    : pending_count(0), flush_config(policy), written_count(0), cached_read_count(0), reader_top(nullptr),
+      capacity_config(capacity)
 {
-    VAR(writer_top)    = nullptr;
-    VAR(writer_bottom) = nullptr;
-    writer_finished    = false;
+    read_count.store(0, memory_order_relaxed);
+    VAR(writer_top)     = nullptr;
+    VAR(writer_bottom)  = nullptr;
+    VAR(pending_top)    = nullptr;
+    VAR(pending_bottom) = nullptr;
+    writer_finished.store(false, memory_order_relaxed);
     VAR(reader_top)    = nullptr;
 }
 
-template<class T>
-queue<T>::~queue()
+template<class T, class Layout, class Wait, class Stats>
+queue<T, Layout, Wait, Stats>::~queue()
 {
-    // clean reader's queue
-    auto elem = reader_top.load(memory_order_acquire);
-    while (elem != nullptr)
+    clear([](pointer elem) { delete elem; });
+}
+
+template<class T, class Layout, class Wait, class Stats>
+bool queue<T, Layout, Wait, Stats>::write(pointer data)
+{
+    return write_batch(data, data);
+}
+
+/*
+ * Elements are collected in the pending segment until flush policy says they are due.
+ * With the default policy nothing is pending and elements are passed to the queue directly.
+ */
+template<class T, class Layout, class Wait, class Stats>
+bool queue<T, Layout, Wait, Stats>::write_batch(pointer first, pointer last)
+{
+    assert(!writer_finished.load(memory_order_relaxed));
+    assert(first != nullptr);
+    assert(last != nullptr);
+
+    last->VAR(next) = nullptr;
+
+    // chain is walked at most once and only if its length is used
+    std::size_t count = 1;
+    if (first != last && (is_bounded() || Stats::enabled || flush_config.max_items > 1 || VAR(pending_top) != nullptr))
     {
-        auto next = elem->VAR(next);
-        delete elem;
-        elem = next;
+        count = chain_length(first);
     }
 
-    // clean writer's queue
-    elem = writer_top.load(memory_order_acquire);
-    while (elem != nullptr)
+    if (is_bounded())
     {
-        auto next = elem->VAR(next);
-        delete elem;
-        elem = next;
+        written_count += count;
     }
+
+    if (VAR(pending_top) == nullptr)
+    {
+        if (flush_config.max_items <= 1)
+        {
+            return publish(first, last, count);
+        }
+
+        VAR(pending_top) = first;
+        pending_count    = 0;
+        if (flush_config.max_delay.count() > 0)
+        {
+            pending_since = std::chrono::steady_clock::now();
+        }
+    }
+    else
+    {
+        VAR(pending_bottom)->VAR(next) = first;
+    }
+    VAR(pending_bottom) = last;
+    pending_count += count;
+
+    return flush_if_due();
+}
+
+template<class T, class Layout, class Wait, class Stats>
+bool queue<T, Layout, Wait, Stats>::flush()
+{
+    if (VAR(pending_top) == nullptr)
+    {
+        return false;
+    }
+
+    pointer first     = VAR(pending_top);
+    std::size_t count = pending_count;
+    VAR(pending_top)  = nullptr;
+    pending_count     = 0;
+
+    return publish(first, VAR(pending_bottom), count);
+}
+
+template<class T, class Layout, class Wait, class Stats>
+bool queue<T, Layout, Wait, Stats>::flush_if_due()
+{
+    if (VAR(pending_top) == nullptr)
+    {
+        return false;
+    }
+
+    if (pending_count >= flush_config.max_items ||
+        (flush_config.max_delay.count() > 0 &&
+         std::chrono::steady_clock::now() - pending_since >= flush_config.max_delay))
+    {
+        return flush();
+    }
+
+    return false;
 }
 
 /*
- * Write data to the queue.
+ * Pass chain of count elements to the queue.
  * Algorithm:
  * 1. Retrieve writer top using atomic::exchange(null).
  *    This prevents reader from trying to take ownership of writers subqueue.
@@ -139,61 +548,220 @@ queue<T>::~queue()
  * 3. Otherwise add data to the end.
  * 4. Retrieve reader top using atomic::load(null).
  *    Using load instead of exchange prevents blocking of reader's subqueue.
- * 5. If it is null then set it to the writer top.
+ * 5. If it is null then set it to the writer top using atomic::compare_exchange(null).
+ *    Reader could mark its top after step 4 to take writer's queue (see read()).
  * 6. Otherwise restore writer's top.
  */
-template<class T>
-bool queue<T>::write(pointer data)
+template<class T, class Layout, class Wait, class Stats>
+bool queue<T, Layout, Wait, Stats>::publish(pointer first, pointer last, std::size_t count)
 {
-    assert(writer_finished == false);
-    assert(data != nullptr);
-
-    data->VAR(next) = nullptr;
-
     VAR_T(pointer) w_top = writer_top.exchange(nullptr, memory_order_acq_rel);
 
+    if (Stats::enabled)
+    {
+        writer_stats.on_write(count, VAR(w_top) == nullptr);
+        writer_stats.on_depth(reader_stats);
+    }
+
     if (VAR(w_top) == nullptr)
     {
-        VAR(w_top) = data; // start new writer queue
+        VAR(w_top) = first; // start new writer queue
     }
     else
     {
-        VAR(writer_bottom)->VAR(next) = data; // append new element to the end of the writer's queue
+        VAR(writer_bottom)->VAR(next) = first; // append new elements to the end of the writer's queue
     }
-    VAR(writer_bottom) = data; // update pointer to the end of writer's queue
+    VAR(writer_bottom) = last; // update pointer to the end of writer's queue
 
-    VAR_T(pointer) r_top = reader_top.load(memory_order_acquire);
-    if (VAR(r_top) == nullptr) // reader don't have anything to read
+    pointer r_top = reader_top.load(memory_order_acquire);
+    if (r_top == nullptr && // reader don't have anything to read
+        reader_top.compare_exchange_strong(r_top, VAR(w_top), memory_order_acq_rel)) // give reader writer's queue
     {
-        reader_top.store(VAR(w_top), memory_order_release); // give reader writer's queue
+        writer_stats.on_handoff(reader_stats);
+        waiter.notify(true);
         return true;
     }
 
-    writer_top.store(VAR(w_top), memory_order_release); // restore writer's top
-
+    restore_writer_queue(VAR(w_top));
     return false;
 }
 
+/*
+ * Give writer's queue taken with atomic::exchange(null) back and notify the reader.
+ */
+template<class T, class Layout, class Wait, class Stats>
+void queue<T, Layout, Wait, Stats>::restore_writer_queue(pointer w_top)
+{
+    if (is_handoff_wait<Wait>::value)
+    {
+        // Reader could take writer's top while writer was holding its queue and see nothing (see read()).
+        // Exchange synchronizes with reader's exchange in this case so reader top is seen as empty or marked
+        // and the reader is notified as if the queue was handed off.
+        writer_top.exchange(w_top, memory_order_acq_rel);
+
+        pointer r_top = reader_top.load(memory_order_acquire);
+        waiter.notify(r_top == nullptr || r_top == reading_mark());
+        return;
+    }
+
+    writer_top.store(w_top, memory_order_release);
+
+    waiter.notify(false);
+}
+
+template<class T, class Layout, class Wait, class Stats>
+template<class Function>
+typename queue<T, Layout, Wait, Stats>::write_result
+queue<T, Layout, Wait, Stats>::write_or_overflow(pointer data, overflow_policy overflow, Function dispose)
+{
+    assert(data != nullptr);
+
+    if (is_bounded() && is_full())
+    {
+        switch (overflow)
+        {
+        case overflow_policy::reject:
+            flush();
+            return write_result::rejected;
+
+        case overflow_policy::drop_oldest:
+            if (drop_oldest(dispose))
+            {
+                break;
+            }
+            // reader has all elements, drop the new one
+            // fall through
+
+        case overflow_policy::drop_newest:
+            flush();
+            writer_stats.on_drop(false, false);
+            dispose(data);
+            return write_result::dropped;
+        }
+    }
+
+    write(data);
+    return write_result::written;
+}
+
+/*
+ * Writer spins and then yields while the queue is full. Reader doesn't notify writer about free room.
+ * Pending elements are flushed first, otherwise reader could never make room for them.
+ */
+template<class T, class Layout, class Wait, class Stats>
+template<class Rep, class Period>
+bool queue<T, Layout, Wait, Stats>::write_for(pointer data, const std::chrono::duration<Rep, Period> &timeout)
+{
+    assert(data != nullptr);
+
+    if (is_bounded() && is_full())
+    {
+        flush();
+
+        auto deadline = std::chrono::steady_clock::now() + timeout;
+        for (unsigned i = 1; is_full(); ++i)
+        {
+            if (i % 64 == 0)
+            {
+                if (std::chrono::steady_clock::now() >= deadline)
+                {
+                    return false;
+                }
+                std::this_thread::yield();
+            }
+            else
+            {
+                cpu_relax();
+            }
+        }
+    }
+
+    write(data);
+    return true;
+}
+
+/*
+ * Check the number of written but not read elements using cached reader's counter.
+ * If it reached the capacity then reload reader's counter using atomic::load() and check again.
+ */
+template<class T, class Layout, class Wait, class Stats>
+bool queue<T, Layout, Wait, Stats>::is_full()
+{
+    if (written_count - cached_read_count < capacity_config.max_items)
+    {
+        return false;
+    }
+
+    cached_read_count = read_count.load(memory_order_acquire);
+    return written_count - cached_read_count >= capacity_config.max_items;
+}
+
+/*
+ * Dispose the oldest element that writer owns.
+ * Algorithm:
+ * 1. Take writer's queue using atomic::exchange(null) as publish() does.
+ * 2. If it is not empty then dispose its first element and restore the rest.
+ * 3. Otherwise dispose the first pending element.
+ * Elements that are already given to the reader can't be dropped.
+ */
+template<class T, class Layout, class Wait, class Stats>
+template<class Function>
+bool queue<T, Layout, Wait, Stats>::drop_oldest(Function dispose)
+{
+    pointer oldest = writer_top.exchange(nullptr, memory_order_acq_rel);
+    if (oldest != nullptr)
+    {
+        pointer rest = oldest->VAR(next);
+        if (rest != nullptr)
+        {
+            restore_writer_queue(rest);
+        }
+        writer_stats.on_drop(true, true);
+    }
+    else if (VAR(pending_top) != nullptr)
+    {
+        oldest = VAR(pending_top);
+        VAR(pending_top) = oldest->VAR(next);
+        pending_count--;
+        writer_stats.on_drop(false, false); // pending elements are not counted in writes yet
+    }
+    else
+    {
+        return false;
+    }
+
+    written_count--;
+    dispose(oldest);
+
+    return true;
+}
+
 /*
  * Read data from the queue.
  * Algorithm:
  * 1. Retrieve reader top using atomic::load().
  *    Using load instead of exchange prevets writer queue from overwriting readers one while reader is working with it.
  * 2. If it is null then:
- * 2.1. Retrieve writer top using atomic::exchange(null).
+ * 2.1. Set reader top to the reading mark using atomic::compare_exchange(null).
+ *      If it fails then writer gave reader its queue after step 1 and it is used.
+ *      Otherwise writer can't give reader its queue until the mark is removed so the queue that was given
+ *      earlier can't be read after the newer elements taken at step 2.2.
+ * 2.2. Retrieve writer top using atomic::exchange(null).
  *      Using exchange garantees that only writer or reader is owning writer's queue at each moment of time.
- * 2.2. If it is not null then assign it to the reader top otherwise exit.
- * 3. Shift reader's top to the next and return original top data.
+ * 2.3. If it is null then remove the mark and exit.
+ * 3. Shift reader's top to the next.
+ * 4. Return original top data.
  */
-template<class T>
-bool queue<T>::read(pointer &data)
+template<class T, class Layout, class Wait, class Stats>
+bool queue<T, Layout, Wait, Stats>::read(pointer &data)
 {
     VAR_T(pointer) r_top = reader_top.load(memory_order_acquire);
     if (VAR(r_top) == nullptr)
     {
-        VAR(r_top) = writer_top.exchange(nullptr, memory_order_acq_rel);
+        VAR(r_top) = take_writer_queue();
         if (VAR(r_top) == nullptr)
         {
+            reader_stats.on_empty_read();
             return false;
         }
     }
@@ -201,10 +769,189 @@ bool queue<T>::read(pointer &data)
     reader_top.store(VAR(r_top)->VAR(next), memory_order_release);
 
     data = VAR(r_top);
+    reader_stats.on_read(1);
+    if (is_bounded())
+    {
+        count_read(1);
+    }
 
     return true;
 }
 
+/*
+ * Read all data from the queue.
+ * Algorithm:
+ * 1. Retrieve reader top using atomic::load().
+ * 2. If it is not null then set reader top to null and return it.
+ *    After this writer can give reader its queue.
+ * 3. Otherwise take writer's queue the same way as read() does and return it.
+ *    Reader top is set to null so writer can give reader its next queue.
+ */
+template<class T, class Layout, class Wait, class Stats>
+typename queue<T, Layout, Wait, Stats>::pointer queue<T, Layout, Wait, Stats>::take_all()
+{
+    VAR_T(pointer) r_top = reader_top.load(memory_order_acquire);
+    if (VAR(r_top) == nullptr)
+    {
+        VAR(r_top) = take_writer_queue();
+    }
+
+    if (VAR(r_top) != nullptr)
+    {
+        reader_top.store(nullptr, memory_order_release);
+    }
+
+    return VAR(r_top);
+}
+
+/*
+ * Segment is walked only if its length is used.
+ */
+template<class T, class Layout, class Wait, class Stats>
+typename queue<T, Layout, Wait, Stats>::pointer queue<T, Layout, Wait, Stats>::read_all()
+{
+    pointer r_top = take_all();
+
+    std::size_t count = 0;
+    if (r_top != nullptr && (is_bounded() || Stats::enabled))
+    {
+        count = chain_length(r_top);
+    }
+    count_taken(r_top != nullptr, count);
+
+    return r_top;
+}
+
+/*
+ * Elements are counted while they are passed to the function, so the segment is walked once.
+ */
+template<class T, class Layout, class Wait, class Stats>
+template<class Function>
+std::size_t queue<T, Layout, Wait, Stats>::drain(Function fn)
+{
+    std::size_t count = 0;
+
+    pointer elem = take_all();
+    bool taken   = elem != nullptr;
+    while (elem != nullptr)
+    {
+        pointer next = elem->VAR(next);
+        fn(elem);
+        elem = next;
+        count++;
+    }
+    count_taken(taken, count);
+
+    return count;
+}
+
+/*
+ * Clean reader's queue, writer's queue and writer's pending elements in this order.
+ */
+template<class T, class Layout, class Wait, class Stats>
+template<class Function>
+std::size_t queue<T, Layout, Wait, Stats>::clear(Function fn)
+{
+    pointer segments[] = {
+        reader_top.exchange(nullptr, memory_order_acquire),
+        writer_top.exchange(nullptr, memory_order_acquire),
+        VAR(pending_top)
+    };
+    VAR(pending_top) = nullptr;
+    pending_count    = 0;
+
+    std::size_t count = 0;
+    for (auto elem : segments)
+    {
+        while (elem != nullptr)
+        {
+            pointer next = elem->VAR(next);
+            fn(elem);
+            elem = next;
+            count++;
+        }
+    }
+
+    if (is_bounded())
+    {
+        count_read(count);
+    }
+
+    return count;
+}
+
+/*
+ * Take writer's queue when reader's one is empty. Reader only method.
+ * Returns queue given by writer or taken from writer's top. In both cases reader top is not null
+ * until the caller updates it. Returns null and leaves reader top null if there is nothing to read.
+ */
+template<class T, class Layout, class Wait, class Stats>
+typename queue<T, Layout, Wait, Stats>::pointer queue<T, Layout, Wait, Stats>::take_writer_queue()
+{
+    pointer r_top = nullptr;
+    if (!reader_top.compare_exchange_strong(r_top, reading_mark(), memory_order_acq_rel))
+    {
+        return r_top; // writer gave its queue
+    }
+
+    r_top = writer_top.exchange(nullptr, memory_order_acq_rel);
+    if (r_top == nullptr)
+    {
+        reader_top.store(nullptr, memory_order_release);
+    }
+    else
+    {
+        reader_stats.on_take(writer_stats);
+    }
+
+    return r_top;
+}
+
+template<class T, class Layout, class Wait, class Stats>
+template<class Rep, class Period>
+bool queue<T, Layout, Wait, Stats>::read_for(pointer &data, const std::chrono::duration<Rep, Period> &timeout)
+{
+    return read_until(data, std::chrono::steady_clock::now() + timeout);
+}
+
+template<class T, class Layout, class Wait, class Stats>
+bool queue<T, Layout, Wait, Stats>::read_wait(pointer &data)
+{
+    return read_until(data, std::chrono::steady_clock::time_point::max());
+}
+
+/*
+ * Writer could write data and finish between the last read() and is_writer_finished() calls
+ * so queue is checked once more after the writer is finished.
+ */
+template<class T, class Layout, class Wait, class Stats>
+template<class TimePoint>
+bool queue<T, Layout, Wait, Stats>::read_until(pointer &data, const TimePoint &deadline)
+{
+    bool result = false;
+    waiter.wait_until([&]
+    {
+        result = read(data);
+        return result || is_writer_finished();
+    }, deadline);
+
+    return result || read(data);
+}
+
+/*
+ * Number of elements in the chain. Used for pending elements, bounded queues and statistics.
+ */
+template<class T, class Layout, class Wait, class Stats>
+std::uint64_t queue<T, Layout, Wait, Stats>::chain_length(pointer first)
+{
+    std::uint64_t n = 0;
+    for (pointer elem = first; elem != nullptr; elem = elem->VAR(next))
+    {
+        n++;
+    }
+    return n;
+}
+
 } // namespace types
 
 #ifdef VAR_UNDEF
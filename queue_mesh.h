@@ -0,0 +1,293 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Oleg Khryptul aka HaronK
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// NOTE: queue.h should be included before this file.
+// Lane counters and consumer locks use std::atomic directly and are not checked with Relacy Race Detector library.
+
+#include "platform.h"
+#include "locks.h"
+
+#include <atomic>
+#include <cassert>
+#include <memory>
+
+namespace types
+{
+
+/**
+ * Queue for N writer and M reader threads built from N*M queues for 1 writer and 1 reader.
+ *
+ * Each producer/consumer pair has its own lane so writers and readers don't contend with each other.
+ * Producer writes to the lanes of all consumers in round-robin order or to the lane of a given consumer.
+ * Consumer polls its inbound lanes in round-robin order or starting from the deepest one.
+ * Order is kept only for the elements of one lane.
+ *
+ * With stealing enabled a consumer that found all its lanes empty reads from the lanes of other consumers.
+ * To keep each lane with one reader at a time every consumer has a lock: owner always takes it, thief
+ * only tries to take it. Without stealing the lock is not used.
+ *
+ * Producers and consumers are identified by indexes in [0, producers) and [0, consumers) ranges.
+ * Each index should be used by one thread at a time.
+ */
+template<class T, class Layout = cache_aligned_layout, class Wait = busy_spin_wait>
+class queue_mesh
+{
+public:
+    using value_type = T;
+    using pointer    = T*;
+    using lane_type  = queue<T, Layout, Wait>;
+
+    enum class polling
+    {
+        round_robin, // next lane after the last read one
+        by_depth     // lane with most elements
+    };
+
+    queue_mesh(std::size_t producers, std::size_t consumers, polling mode = polling::round_robin, bool stealing = false);
+
+    queue_mesh(const queue_mesh&) = delete;
+    queue_mesh& operator=(const queue_mesh&) = delete;
+
+    /**
+     * Write data to the lane of the next consumer. Producer only method.
+     *
+     * @return true if data was send to the reader of the lane otherwise false (see queue::write()).
+     */
+    bool write(std::size_t producer, pointer data);
+
+    /**
+     * Write data to the lane of the consumer. Producer only method.
+     */
+    bool write_to(std::size_t producer, std::size_t consumer, pointer data);
+
+    /**
+     * Read data from the consumer's lanes or steal it from other consumers' lanes if stealing is enabled.
+     * Consumer only method.
+     *
+     * @param data [OUT] Data to retrieve.
+     * @return true if data was retrieved otherwise false.
+     */
+    bool read(std::size_t consumer, pointer &data);
+
+    /**
+     * Producer is finished. It should not write to the mesh after that.
+     */
+    void set_writer_finished(std::size_t producer);
+
+    /**
+     * Check if all producers are finished.
+     */
+    bool is_writer_finished() const
+    {
+        return active_producers.load(std::memory_order_acquire) == 0;
+    }
+
+    std::size_t producers() const
+    {
+        return producers_count;
+    }
+
+    std::size_t consumers() const
+    {
+        return consumers_count;
+    }
+
+private:
+    struct lane
+    {
+        lane_type q;
+        alignas(TYPES_CACHE_LINE_SIZE) std::atomic<std::uint64_t> writes{0}; // producer's counter
+        alignas(TYPES_CACHE_LINE_SIZE) std::uint64_t reads = 0;              // consumer's counter
+    };
+
+    struct alignas(TYPES_CACHE_LINE_SIZE) producer_state
+    {
+        std::size_t next = 0; // next consumer to write to
+    };
+
+    struct alignas(TYPES_CACHE_LINE_SIZE) consumer_state
+    {
+        ttas_spinlock lock;
+        std::size_t next = 0; // next producer to read from
+    };
+
+    lane& get_lane(std::size_t producer, std::size_t consumer)
+    {
+        return lanes[consumer * producers_count + producer];
+    }
+
+    bool poll(std::size_t consumer, pointer &data);
+    bool read_lane(std::size_t producer, std::size_t consumer, pointer &data);
+
+    const std::size_t producers_count;
+    const std::size_t consumers_count;
+    const polling mode;
+    const bool stealing;
+
+    std::unique_ptr<lane[]> lanes;
+    std::unique_ptr<producer_state[]> producer_states;
+    std::unique_ptr<consumer_state[]> consumer_states;
+
+    alignas(TYPES_CACHE_LINE_SIZE) std::atomic<std::size_t> active_producers;
+};
+
+template<class T, class Layout, class Wait>
+queue_mesh<T, Layout, Wait>::queue_mesh(std::size_t producers, std::size_t consumers, polling mode, bool stealing)
+    : producers_count(producers), consumers_count(consumers), mode(mode), stealing(stealing),
+      lanes(new lane[producers * consumers]), producer_states(new producer_state[producers]),
+      consumer_states(new consumer_state[consumers]), active_producers(producers)
+{
+    assert(producers > 0);
+    assert(consumers > 0);
+}
+
+template<class T, class Layout, class Wait>
+bool queue_mesh<T, Layout, Wait>::write(std::size_t producer, pointer data)
+{
+    auto &state = producer_states[producer];
+
+    auto consumer = state.next;
+    state.next = consumer + 1 < consumers_count ? consumer + 1 : 0;
+
+    return write_to(producer, consumer, data);
+}
+
+template<class T, class Layout, class Wait>
+bool queue_mesh<T, Layout, Wait>::write_to(std::size_t producer, std::size_t consumer, pointer data)
+{
+    assert(producer < producers_count);
+    assert(consumer < consumers_count);
+
+    auto &l = get_lane(producer, consumer);
+    l.writes.store(l.writes.load(std::memory_order_relaxed) + 1, std::memory_order_relaxed);
+    return l.q.write(data);
+}
+
+template<class T, class Layout, class Wait>
+bool queue_mesh<T, Layout, Wait>::read(std::size_t consumer, pointer &data)
+{
+    assert(consumer < consumers_count);
+
+    if (!stealing)
+    {
+        return poll(consumer, data);
+    }
+
+    auto &state = consumer_states[consumer];
+    state.lock.lock();
+    auto result = poll(consumer, data);
+    state.lock.unlock();
+
+    if (result)
+    {
+        return true;
+    }
+
+    for (std::size_t i = 1; i < consumers_count; ++i)
+    {
+        auto victim = (consumer + i) % consumers_count;
+        auto &victim_state = consumer_states[victim];
+        if (victim_state.lock.try_lock())
+        {
+            result = poll(victim, data);
+            victim_state.lock.unlock();
+
+            if (result)
+            {
+                return true;
+            }
+        }
+    }
+
+    return false;
+}
+
+template<class T, class Layout, class Wait>
+void queue_mesh<T, Layout, Wait>::set_writer_finished(std::size_t producer)
+{
+    for (std::size_t c = 0; c < consumers_count; ++c)
+    {
+        get_lane(producer, c).q.set_writer_finished();
+    }
+    active_producers.fetch_sub(1, std::memory_order_acq_rel);
+}
+
+/*
+ * Read data from the consumer's lanes. Caller is the only reader of these lanes.
+ * In by_depth mode the deepest lane is read first, depth is calculated from the lane counters and
+ * can be stale so the other lanes are polled if it is empty.
+ */
+template<class T, class Layout, class Wait>
+bool queue_mesh<T, Layout, Wait>::poll(std::size_t consumer, pointer &data)
+{
+    auto &state = consumer_states[consumer];
+
+    if (mode == polling::by_depth)
+    {
+        std::size_t deepest = 0;
+        std::uint64_t max_depth = 0;
+        for (std::size_t p = 0; p < producers_count; ++p)
+        {
+            auto &l = get_lane(p, consumer);
+            auto depth = l.writes.load(std::memory_order_relaxed) - l.reads;
+            if (depth > max_depth)
+            {
+                max_depth = depth;
+                deepest   = p;
+            }
+        }
+
+        if (max_depth > 0 && read_lane(deepest, consumer, data))
+        {
+            return true;
+        }
+    }
+
+    for (std::size_t i = 0; i < producers_count; ++i)
+    {
+        auto p = state.next + i < producers_count ? state.next + i : state.next + i - producers_count;
+        if (read_lane(p, consumer, data))
+        {
+            state.next = p + 1 < producers_count ? p + 1 : 0;
+            return true;
+        }
+    }
+
+    return false;
+}
+
+template<class T, class Layout, class Wait>
+bool queue_mesh<T, Layout, Wait>::read_lane(std::size_t producer, std::size_t consumer, pointer &data)
+{
+    auto &l = get_lane(producer, consumer);
+    if (!l.q.read(data))
+    {
+        return false;
+    }
+
+    l.reads++;
+    return true;
+}
+
+} // namespace types
@@ -41,6 +41,17 @@ public:
         return impl->read(data);
     }
 
+    typename T::pointer read_all()
+    {
+        return impl->read_all();
+    }
+
+    template<class Function>
+    std::size_t drain(Function fn)
+    {
+        return impl->drain(fn);
+    }
+
     bool is_writer_finished()
     {
         return impl->is_writer_finished();
@@ -0,0 +1,668 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Oleg Khryptul aka HaronK
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef TYPES_RECLAIM_H
+#define TYPES_RECLAIM_H
+
+// NOTE: reclamation domains use std::atomic directly and are not checked with Relacy Race Detector library.
+
+#include "platform.h"
+
+#include <algorithm>
+#include <atomic>
+#include <cassert>
+#include <mutex>
+#include <vector>
+
+namespace types
+{
+
+/**
+ * Safe memory reclamation for lock free structures with several readers.
+ *
+ * Element removed from a shared structure can't be deleted immediately because other threads may still
+ * be reading it. Instead it is retired and deleted later when no reader can hold it:
+ *  - hazard_reclaim: readers publish pointers they are reading in hazard slots and retired elements are
+ *    deleted if no slot holds them. Number of retired but not deleted elements is bounded even if a reader
+ *    stalls. Each protected load costs a store and a full fence.
+ *  - epoch_reclaim: readers announce the global epoch while they are pinned and retired elements are deleted
+ *    two epochs later. Protected loads are plain loads, but a stalled pinned reader blocks reclamation.
+ *
+ * Both domains have the same interface so a structure can take the domain type as a policy:
+ *
+ *     auto handle = domain.attach();            // once per thread
+ *     {
+ *         auto guard = handle.pin();
+ *         node *n = guard.protect(0, top);      // n can be read while the guard holds slot 0
+ *         ...
+ *     }
+ *     handle.retire(old);                       // deleted when no reader can hold it
+ *
+ * Each thread uses its own thread_handle. Handle keeps the retired elements of the thread and reclaims them
+ * when their number reaches a threshold. Elements left when handle is destroyed are passed to the domain
+ * and adopted by the next reclaiming thread or deleted by the domain's destructor.
+ * Per-thread records are allocated on the first attach() and reused by the following ones.
+ */
+
+namespace detail
+{
+
+struct retired_ptr
+{
+    void *ptr;
+    void (*deleter)(void*);
+    std::uint64_t epoch; // used by epoch_reclaim only
+};
+
+template<class T>
+void delete_object(void *ptr)
+{
+    delete static_cast<T*>(ptr);
+}
+
+/*
+ * Lock free list of per-thread records. Records are never removed, so readers of the list don't need
+ * protection. Record should have `std::atomic<bool> in_use` and `Record *next` members.
+ */
+template<class Record>
+class record_registry
+{
+public:
+    record_registry() : head(nullptr), count(0), has_orphans(false) {}
+
+    ~record_registry()
+    {
+        for (auto &r : orphans)
+        {
+            r.deleter(r.ptr);
+        }
+
+        auto rec = head.load(std::memory_order_acquire);
+        while (rec != nullptr)
+        {
+            auto next = rec->next;
+            delete rec;
+            rec = next;
+        }
+    }
+
+    Record *acquire()
+    {
+        for (auto rec = head.load(std::memory_order_acquire); rec != nullptr; rec = rec->next)
+        {
+            bool expected = false;
+            if (!rec->in_use.load(std::memory_order_relaxed) &&
+                rec->in_use.compare_exchange_strong(expected, true, std::memory_order_acquire))
+            {
+                return rec;
+            }
+        }
+
+        auto rec = new Record();
+        rec->next = head.load(std::memory_order_relaxed);
+        while (!head.compare_exchange_weak(rec->next, rec, std::memory_order_release, std::memory_order_relaxed))
+        {
+        }
+        count.fetch_add(1, std::memory_order_relaxed);
+
+        return rec;
+    }
+
+    void release(Record *rec)
+    {
+        rec->in_use.store(false, std::memory_order_release);
+    }
+
+    template<class Function>
+    void for_each(Function fn) const
+    {
+        for (auto rec = head.load(std::memory_order_acquire); rec != nullptr; rec = rec->next)
+        {
+            fn(*rec);
+        }
+    }
+
+    std::size_t size() const
+    {
+        return count.load(std::memory_order_relaxed);
+    }
+
+    /*
+     * Keep retired elements of a detached thread.
+     */
+    void add_orphans(std::vector<retired_ptr> &list)
+    {
+        if (list.empty())
+        {
+            return;
+        }
+
+        std::lock_guard<std::mutex> lock(orphans_lock);
+        orphans.insert(orphans.end(), list.begin(), list.end());
+        has_orphans.store(true, std::memory_order_release);
+        list.clear();
+    }
+
+    /*
+     * Move retired elements of detached threads to the list. Doesn't wait if another thread adopts them.
+     */
+    void adopt_orphans(std::vector<retired_ptr> &list)
+    {
+        if (!has_orphans.load(std::memory_order_acquire))
+        {
+            return;
+        }
+
+        std::unique_lock<std::mutex> lock(orphans_lock, std::try_to_lock);
+        if (lock.owns_lock())
+        {
+            list.insert(list.end(), orphans.begin(), orphans.end());
+            orphans.clear();
+            has_orphans.store(false, std::memory_order_relaxed);
+        }
+    }
+
+private:
+    std::atomic<Record*> head;
+    std::atomic<std::size_t> count;
+
+    std::mutex orphans_lock;
+    std::vector<retired_ptr> orphans;
+    std::atomic<bool> has_orphans;
+};
+
+} // namespace detail
+
+/**
+ * Hazard pointers (Maged Michael). Each thread has Slots hazard slots.
+ *
+ * protect() stores the loaded pointer to the slot, makes it visible with a full fence and checks that
+ * the source still holds it. Reclaiming thread collects all slots after a full fence and deletes retired
+ * elements which are not in them.
+ *
+ * Retired elements are reclaimed when their number reaches max(scan_threshold, 2 * number of slots of
+ * all threads), so after each scan at least half of them are deleted and each thread keeps no more than
+ * this number of retired elements.
+ */
+template<std::size_t Slots = 2>
+class hazard_reclaim
+{
+    struct alignas(TYPES_CACHE_LINE_SIZE) record
+    {
+        record() : in_use(true), next(nullptr)
+        {
+            for (auto &h : hazards)
+            {
+                h.store(nullptr, std::memory_order_relaxed);
+            }
+        }
+
+        std::atomic<bool> in_use;
+        record *next;
+        std::atomic<void*> hazards[Slots];
+    };
+
+public:
+    static const std::size_t slots = Slots;
+
+    explicit hazard_reclaim(std::size_t scan_threshold = 64) : scan_threshold(scan_threshold) {}
+
+    hazard_reclaim(const hazard_reclaim&) = delete;
+    hazard_reclaim& operator=(const hazard_reclaim&) = delete;
+
+    /**
+     * Protected section of a reader. Slots are cleared when the guard is destroyed.
+     */
+    class read_guard
+    {
+    public:
+        read_guard(read_guard &&other) : rec(other.rec)
+        {
+            other.rec = nullptr;
+        }
+
+        ~read_guard()
+        {
+            if (rec != nullptr)
+            {
+                for (std::size_t i = 0; i < Slots; ++i)
+                {
+                    clear(i);
+                }
+            }
+        }
+
+        read_guard(const read_guard&) = delete;
+        read_guard& operator=(const read_guard&) = delete;
+
+        /**
+         * Load pointer from the source and protect it with the slot. Previous pointer of the slot is
+         * not protected anymore.
+         *
+         * @return loaded pointer. It is not deleted until the slot is cleared or reused.
+         */
+        template<class T>
+        T *protect(std::size_t slot, const std::atomic<T*> &src)
+        {
+            assert(slot < Slots);
+
+            auto &hazard = rec->hazards[slot];
+            T *ptr = src.load(std::memory_order_relaxed);
+            for (;;)
+            {
+                hazard.store(ptr, std::memory_order_relaxed);
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+
+                T *current = src.load(std::memory_order_acquire);
+                if (current == ptr)
+                {
+                    return ptr;
+                }
+                ptr = current;
+            }
+        }
+
+        void clear(std::size_t slot)
+        {
+            assert(slot < Slots);
+            rec->hazards[slot].store(nullptr, std::memory_order_release);
+        }
+
+    private:
+        friend class hazard_reclaim;
+
+        explicit read_guard(record *rec) : rec(rec) {}
+
+        record *rec;
+    };
+
+    /**
+     * Per-thread state: hazard slots and retired elements. Should be used by one thread at a time.
+     */
+    class thread_handle
+    {
+    public:
+        thread_handle(thread_handle &&other)
+            : domain(other.domain), rec(other.rec), retired(std::move(other.retired))
+        {
+            other.rec = nullptr;
+        }
+
+        ~thread_handle()
+        {
+            if (rec != nullptr)
+            {
+                reclaim();
+                domain->registry.add_orphans(retired);
+                domain->registry.release(rec);
+            }
+        }
+
+        thread_handle(const thread_handle&) = delete;
+        thread_handle& operator=(const thread_handle&) = delete;
+
+        read_guard pin()
+        {
+            return read_guard(rec);
+        }
+
+        /**
+         * Delete the element with `delete` when no reader protects it.
+         */
+        template<class T>
+        void retire(T *ptr)
+        {
+            retire(ptr, &detail::delete_object<T>);
+        }
+
+        void retire(void *ptr, void (*deleter)(void*))
+        {
+            retired.push_back(detail::retired_ptr{ptr, deleter, 0});
+            if (retired.size() >= threshold())
+            {
+                reclaim();
+            }
+        }
+
+        /**
+         * Delete retired elements which are not protected by any thread.
+         *
+         * @return number of deleted elements.
+         */
+        std::size_t reclaim();
+
+        std::size_t retired_count() const
+        {
+            return retired.size();
+        }
+
+    private:
+        friend class hazard_reclaim;
+
+        thread_handle(hazard_reclaim &domain, record *rec) : domain(&domain), rec(rec) {}
+
+        std::size_t threshold() const
+        {
+            return std::max(domain->scan_threshold, 2 * Slots * domain->registry.size());
+        }
+
+        hazard_reclaim *domain;
+        record *rec;
+        std::vector<detail::retired_ptr> retired;
+        std::vector<void*> protected_ptrs;
+    };
+
+    /**
+     * Register calling thread. Handle should be destroyed before the domain.
+     */
+    thread_handle attach()
+    {
+        return thread_handle(*this, registry.acquire());
+    }
+
+private:
+    const std::size_t scan_threshold;
+    detail::record_registry<record> registry;
+};
+
+template<std::size_t Slots>
+std::size_t hazard_reclaim<Slots>::thread_handle::reclaim()
+{
+    domain->registry.adopt_orphans(retired);
+
+    // slots stored before retired elements were unlinked are visible after the fence
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    protected_ptrs.clear();
+    domain->registry.for_each([this](record &r)
+    {
+        for (auto &h : r.hazards)
+        {
+            auto ptr = h.load(std::memory_order_acquire);
+            if (ptr != nullptr)
+            {
+                protected_ptrs.push_back(ptr);
+            }
+        }
+    });
+    std::sort(protected_ptrs.begin(), protected_ptrs.end());
+
+    auto keep = std::partition(retired.begin(), retired.end(), [this](const detail::retired_ptr &r)
+    {
+        return std::binary_search(protected_ptrs.begin(), protected_ptrs.end(), r.ptr);
+    });
+
+    // deleters run after the list is updated so they can retire other elements
+    std::vector<detail::retired_ptr> unused(keep, retired.end());
+    retired.erase(keep, retired.end());
+
+    for (auto &r : unused)
+    {
+        r.deleter(r.ptr);
+    }
+
+    return unused.size();
+}
+
+/**
+ * Epoch based reclamation (Keir Fraser).
+ *
+ * Pinned thread announces the global epoch it has seen. Global epoch is advanced when all pinned threads
+ * have announced the current one. Retired elements are stamped with the global epoch and deleted when the
+ * global epoch is two epochs ahead, so all threads that could see them are unpinned by then.
+ *
+ * Reclaiming thread tries to advance the epoch when its retired elements reach advance_threshold.
+ * If a thread stays pinned the epoch can't advance and retired elements are kept, so pinned sections
+ * should be short.
+ */
+class epoch_reclaim
+{
+    struct alignas(TYPES_CACHE_LINE_SIZE) record
+    {
+        record() : in_use(true), next(nullptr), state(0) {}
+
+        std::atomic<bool> in_use;
+        record *next;
+        std::atomic<std::uint64_t> state; // epoch * 2 + 1 if pinned otherwise 0
+    };
+
+public:
+    explicit epoch_reclaim(std::size_t advance_threshold = 64) : advance_threshold(advance_threshold), global_epoch(0) {}
+
+    epoch_reclaim(const epoch_reclaim&) = delete;
+    epoch_reclaim& operator=(const epoch_reclaim&) = delete;
+
+    class thread_handle;
+
+    /**
+     * Pinned section of a reader. Thread is unpinned when the last guard is destroyed.
+     */
+    class read_guard
+    {
+    public:
+        read_guard(read_guard &&other) : handle(other.handle)
+        {
+            other.handle = nullptr;
+        }
+
+        ~read_guard();
+
+        read_guard(const read_guard&) = delete;
+        read_guard& operator=(const read_guard&) = delete;
+
+        /**
+         * Load pointer from the source. Slot is ignored, all pointers loaded while pinned are protected.
+         */
+        template<class T>
+        T *protect(std::size_t, const std::atomic<T*> &src)
+        {
+            return src.load(std::memory_order_acquire);
+        }
+
+        void clear(std::size_t)
+        {
+        }
+
+    private:
+        friend class thread_handle;
+
+        explicit read_guard(thread_handle *handle) : handle(handle) {}
+
+        thread_handle *handle;
+    };
+
+    /**
+     * Per-thread state: announced epoch and retired elements. Should be used by one thread at a time.
+     */
+    class thread_handle
+    {
+    public:
+        thread_handle(thread_handle &&other)
+            : domain(other.domain), rec(other.rec), pin_depth(other.pin_depth), retired(std::move(other.retired))
+        {
+            assert(other.pin_depth == 0);
+            other.rec = nullptr;
+        }
+
+        ~thread_handle()
+        {
+            if (rec != nullptr)
+            {
+                assert(pin_depth == 0);
+                reclaim();
+                domain->registry.add_orphans(retired);
+                domain->registry.release(rec);
+            }
+        }
+
+        thread_handle(const thread_handle&) = delete;
+        thread_handle& operator=(const thread_handle&) = delete;
+
+        /**
+         * Pin the thread. Guards can be nested, thread is unpinned by the last one.
+         */
+        read_guard pin()
+        {
+            if (pin_depth++ == 0)
+            {
+                auto epoch = domain->global_epoch.load(std::memory_order_seq_cst);
+                rec->state.store(epoch * 2 + 1, std::memory_order_relaxed);
+
+                // announced epoch is visible to reclaiming threads before pointers are loaded
+                std::atomic_thread_fence(std::memory_order_seq_cst);
+            }
+            return read_guard(this);
+        }
+
+        /**
+         * Delete the element with `delete` when no pinned thread can hold it.
+         */
+        template<class T>
+        void retire(T *ptr)
+        {
+            retire(ptr, &detail::delete_object<T>);
+        }
+
+        void retire(void *ptr, void (*deleter)(void*))
+        {
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+            auto epoch = domain->global_epoch.load(std::memory_order_seq_cst);
+
+            retired.push_back(detail::retired_ptr{ptr, deleter, epoch});
+            if (retired.size() >= domain->advance_threshold)
+            {
+                reclaim();
+            }
+        }
+
+        /**
+         * Try to advance the global epoch and delete retired elements of expired epochs.
+         *
+         * @return number of deleted elements.
+         */
+        std::size_t reclaim();
+
+        std::size_t retired_count() const
+        {
+            return retired.size();
+        }
+
+    private:
+        friend class epoch_reclaim;
+        friend class read_guard;
+
+        thread_handle(epoch_reclaim &domain, record *rec) : domain(&domain), rec(rec), pin_depth(0) {}
+
+        void unpin()
+        {
+            assert(pin_depth > 0);
+            if (--pin_depth == 0)
+            {
+                rec->state.store(0, std::memory_order_release);
+            }
+        }
+
+        epoch_reclaim *domain;
+        record *rec;
+        std::size_t pin_depth;
+        std::vector<detail::retired_ptr> retired;
+    };
+
+    /**
+     * Register calling thread. Handle should be destroyed before the domain.
+     */
+    thread_handle attach()
+    {
+        return thread_handle(*this, registry.acquire());
+    }
+
+    std::uint64_t epoch() const
+    {
+        return global_epoch.load(std::memory_order_acquire);
+    }
+
+private:
+    bool try_advance();
+
+    const std::size_t advance_threshold;
+    detail::record_registry<record> registry;
+
+    alignas(TYPES_CACHE_LINE_SIZE) std::atomic<std::uint64_t> global_epoch;
+};
+
+inline epoch_reclaim::read_guard::~read_guard()
+{
+    if (handle != nullptr)
+    {
+        handle->unpin();
+    }
+}
+
+/*
+ * Advance the global epoch if all pinned threads have announced the current one.
+ */
+inline bool epoch_reclaim::try_advance()
+{
+    auto epoch = global_epoch.load(std::memory_order_seq_cst);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+
+    bool all_seen = true;
+    registry.for_each([&](record &r)
+    {
+        auto state = r.state.load(std::memory_order_acquire);
+        if ((state & 1) != 0 && (state >> 1) != epoch)
+        {
+            all_seen = false;
+        }
+    });
+
+    return all_seen && global_epoch.compare_exchange_strong(epoch, epoch + 1, std::memory_order_seq_cst);
+}
+
+inline std::size_t epoch_reclaim::thread_handle::reclaim()
+{
+    domain->registry.adopt_orphans(retired);
+    domain->try_advance();
+
+    auto epoch = domain->global_epoch.load(std::memory_order_seq_cst);
+
+    auto keep = std::partition(retired.begin(), retired.end(), [epoch](const detail::retired_ptr &r)
+    {
+        return epoch < r.epoch + 2;
+    });
+
+    std::vector<detail::retired_ptr> expired(keep, retired.end());
+    retired.erase(keep, retired.end());
+
+    for (auto &r : expired)
+    {
+        r.deleter(r.ptr);
+    }
+
+    return expired.size();
+}
+
+} // namespace types
+
+#endif // TYPES_RECLAIM_H
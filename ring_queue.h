@@ -0,0 +1,201 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Oleg Khryptul aka HaronK
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// NOTE: VAR_T and VAR macros are used for testing with
+// Relacy Race Detector library:
+// http://www.1024cores.net/home/relacy-race-detector/rrd-introduction
+// http://www.1024cores.net/home/relacy-race-detector
+
+#include "platform.h"
+
+#if !defined(VAR_T) || !defined(VAR)
+#define VAR_T(t) t
+#define VAR(v) v
+#define VAR_UNDEF
+#endif
+
+namespace types
+{
+
+/**
+ * Bounded lock free queue for 1 writer and 1 reader threads.
+ *
+ * Values are stored inline in the array of Capacity elements so no allocation or `next` pointer is needed.
+ * Writer owns tail index and reader owns head index. Each side keeps a cached copy of the other side's index
+ * and reloads it only when the queue looks full (writer) or empty (reader).
+ *
+ * Values are moved in and out of the array. T should be default constructible and move assignable.
+ * Moved out values stay in the array until they are overwritten or the queue is destroyed.
+ *
+ * Interface is the same as in queue so writer and reader wrappers can be used with this class.
+ * The only difference is that write() returns false when the queue is full.
+ * To pass pointers as in queue use pointer type as T, e.g. ring_queue<Data*, 1024>.
+ */
+template<class T, std::size_t Capacity>
+class ring_queue
+{
+    static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "Capacity should be a power of two");
+
+public:
+    using value_type = T;
+    using pointer    = T; // type passed to write() and read()
+
+    ring_queue();
+
+    /**
+     * Write data to the queue. Writer only method.
+     *
+     * @param data Value to write to the queue
+     * @return true if data was written otherwise false (queue is full).
+     */
+    bool write(const value_type &data);
+    bool write(value_type &&data);
+
+    /**
+     * Read data from queue. Reader only method.
+     *
+     * @param data [OUT] Data to retrieve.
+     * @return true if data was retrieved otherwise false.
+     */
+    bool read(value_type &data);
+
+    void set_writer_finished()
+    {
+        writer_finished.store(true, memory_order_release);
+    }
+
+    bool is_writer_finished()
+    {
+        return writer_finished.load(memory_order_acquire);
+    }
+
+    static constexpr std::size_t capacity()
+    {
+        return Capacity;
+    }
+
+private:
+    static const std::size_t mask = Capacity - 1;
+
+    template<class U>
+    bool emplace(U &&data);
+
+    // writer's state
+    alignas(TYPES_CACHE_LINE_SIZE) atomic<std::size_t> tail;
+    VAR_T(std::size_t) cached_head;
+
+    // reader's state
+    alignas(TYPES_CACHE_LINE_SIZE) atomic<std::size_t> head;
+    VAR_T(std::size_t) cached_tail;
+
+    // rarely changed state
+    alignas(TYPES_CACHE_LINE_SIZE) atomic<bool> writer_finished;
+
+    alignas(TYPES_CACHE_LINE_SIZE) VAR_T(value_type) buffer[Capacity];
+};
+
+template<class T, std::size_t Capacity>
+ring_queue<T, Capacity>::ring_queue()
+{
+    tail.store(0, memory_order_relaxed);
+    VAR(cached_head) = 0;
+    head.store(0, memory_order_relaxed);
+    VAR(cached_tail) = 0;
+    writer_finished.store(false, memory_order_relaxed);
+}
+
+template<class T, std::size_t Capacity>
+bool ring_queue<T, Capacity>::write(const value_type &data)
+{
+    return emplace(data);
+}
+
+template<class T, std::size_t Capacity>
+bool ring_queue<T, Capacity>::write(value_type &&data)
+{
+    return emplace(std::move(data));
+}
+
+/*
+ * Write data to the queue.
+ * Algorithm:
+ * 1. Check if there is a free slot using cached head.
+ * 2. If not then reload head using atomic::load() and check again.
+ * 3. Move data to the slot and publish it with atomic::store() of the new tail.
+ */
+template<class T, std::size_t Capacity>
+template<class U>
+bool ring_queue<T, Capacity>::emplace(U &&data)
+{
+    assert(!writer_finished.load(memory_order_relaxed));
+
+    std::size_t t = tail.load(memory_order_relaxed);
+    if (t - VAR(cached_head) == Capacity)
+    {
+        VAR(cached_head) = head.load(memory_order_acquire);
+        if (t - VAR(cached_head) == Capacity)
+        {
+            return false;
+        }
+    }
+
+    VAR(buffer[t & mask]) = std::forward<U>(data);
+    tail.store(t + 1, memory_order_release);
+
+    return true;
+}
+
+/*
+ * Read data from the queue.
+ * Algorithm:
+ * 1. Check if there is a filled slot using cached tail.
+ * 2. If not then reload tail using atomic::load() and check again.
+ * 3. Move data from the slot and release it with atomic::store() of the new head.
+ */
+template<class T, std::size_t Capacity>
+bool ring_queue<T, Capacity>::read(value_type &data)
+{
+    std::size_t h = head.load(memory_order_relaxed);
+    if (h == VAR(cached_tail))
+    {
+        VAR(cached_tail) = tail.load(memory_order_acquire);
+        if (h == VAR(cached_tail))
+        {
+            return false;
+        }
+    }
+
+    data = std::move(VAR(buffer[h & mask]));
+    head.store(h + 1, memory_order_release);
+
+    return true;
+}
+
+} // namespace types
+
+#ifdef VAR_UNDEF
+#undef VAR_T
+#undef VAR
+#undef VAR_UNDEF
+#endif
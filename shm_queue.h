@@ -0,0 +1,694 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Oleg Khryptul aka HaronK
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef TYPES_SHM_QUEUE_H
+#define TYPES_SHM_QUEUE_H
+
+// NOTE: shared memory can't be modelled by Relacy Race Detector library so this file uses std::atomic directly.
+// Writer/reader handoff is the same as in queue.h which is checked with Relacy.
+// Only POSIX systems are supported.
+
+#include "platform.h"
+#include "wait.h"
+
+#include <atomic>
+#include <cassert>
+#include <cerrno>
+#include <cstdint>
+#include <cstdio>
+#include <new>
+#include <type_traits>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+namespace types
+{
+
+/**
+ * Memory region shared between processes.
+ *
+ * Region is created with shm_open() under a name that other processes can open or without a name
+ * (memfd_create() on Linux). Unnamed region is passed to other processes as a file descriptor:
+ * it is inherited by fork() or can be sent over a unix socket and mapped with from_fd().
+ * Each mapping can be at a different address.
+ *
+ * Errors are not thrown: failed region is not open and error() returns errno of the failed call.
+ */
+class shm_region
+{
+public:
+    shm_region() = default;
+
+    shm_region(shm_region &&other) noexcept
+        : memory(other.memory), length(other.length), handle(other.handle), last_error(other.last_error)
+    {
+        other.memory = nullptr;
+        other.length = 0;
+        other.handle = -1;
+    }
+
+    shm_region& operator=(shm_region &&other) noexcept
+    {
+        if (this != &other)
+        {
+            close();
+            memory = other.memory;
+            length = other.length;
+            handle = other.handle;
+            last_error = other.last_error;
+            other.memory = nullptr;
+            other.length = 0;
+            other.handle = -1;
+        }
+        return *this;
+    }
+
+    ~shm_region()
+    {
+        close();
+    }
+
+    /**
+     * Create named region of the given size. Existing region with the same name is replaced.
+     * Name should start with '/'. Region exists until unlink() is called even if nobody maps it.
+     */
+    static shm_region create(const char *name, std::size_t size)
+    {
+        shm_region region;
+        region.map(shm_open(name, O_CREAT | O_RDWR | O_TRUNC, 0600), size, true);
+        return region;
+    }
+
+    /**
+     * Open region created by other process with create().
+     */
+    static shm_region open(const char *name)
+    {
+        shm_region region;
+        region.map(shm_open(name, O_RDWR, 0), 0, false);
+        return region;
+    }
+
+    /**
+     * Create unnamed region of the given size. It is released when the last mapping and descriptor are closed.
+     */
+    static shm_region anonymous(std::size_t size)
+    {
+        shm_region region;
+#if defined(__linux__) && defined(MFD_CLOEXEC)
+        region.map(memfd_create("types_shm", 0), size, true);
+#else
+        // shm_open() with a unique name that is unlinked right away
+        char name[64];
+        static std::atomic<unsigned> counter(0);
+        snprintf(name, sizeof(name), "/types_shm_%d_%u", int(getpid()), counter.fetch_add(1));
+        region.map(shm_open(name, O_CREAT | O_EXCL | O_RDWR, 0600), size, true);
+        shm_unlink(name);
+#endif
+        return region;
+    }
+
+    /**
+     * Map region by its file descriptor. Descriptor is duplicated so the caller keeps its own one.
+     */
+    static shm_region from_fd(int fd)
+    {
+        shm_region region;
+        region.map(fd >= 0 ? dup(fd) : -1, 0, false);
+        return region;
+    }
+
+    /**
+     * Remove region name. Already opened regions stay valid.
+     */
+    static bool unlink(const char *name)
+    {
+        return shm_unlink(name) == 0;
+    }
+
+    bool is_open() const
+    {
+        return memory != nullptr;
+    }
+
+    void *data() const
+    {
+        return memory;
+    }
+
+    std::size_t size() const
+    {
+        return length;
+    }
+
+    int fd() const
+    {
+        return handle;
+    }
+
+    int error() const
+    {
+        return last_error;
+    }
+
+    void close()
+    {
+        if (memory != nullptr)
+        {
+            munmap(memory, length);
+            memory = nullptr;
+            length = 0;
+        }
+        if (handle >= 0)
+        {
+            ::close(handle);
+            handle = -1;
+        }
+    }
+
+private:
+    void map(int fd, std::size_t size, bool resize)
+    {
+        handle = fd;
+        if (handle < 0)
+        {
+            last_error = errno;
+            return;
+        }
+
+        if (resize)
+        {
+            if (ftruncate(handle, off_t(size)) != 0)
+            {
+                fail();
+                return;
+            }
+        }
+        else
+        {
+            struct stat st;
+            if (fstat(handle, &st) != 0)
+            {
+                fail();
+                return;
+            }
+            size = std::size_t(st.st_size);
+        }
+
+        void *addr = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, handle, 0);
+        if (addr == MAP_FAILED)
+        {
+            fail();
+            return;
+        }
+
+        memory = addr;
+        length = size;
+    }
+
+    void fail()
+    {
+        last_error = errno;
+        ::close(handle);
+        handle = -1;
+    }
+
+    void *memory = nullptr;
+    std::size_t length = 0;
+    int handle = -1;
+    int last_error = 0;
+};
+
+/**
+ * Lock free queue for 1 writer and 1 reader that can be in different processes.
+ *
+ * Queue and its nodes are placed in a memory region shared by the processes (see shm_region).
+ * Since the region can be mapped at different addresses, nodes are linked by indexes instead of pointers.
+ * Otherwise writer and reader work the same way as in queue.h: writer passes its segment to the reader
+ * when reader has nothing to read and writer's finished flag is kept in the region too.
+ *
+ * The number of nodes is fixed when the queue is created. Writer takes a free node with allocate(),
+ * constructs the message right in the shared memory and passes it with write(). Reader gets pointer to
+ * the message with read() and returns the node to the writer with release(), so messages are never copied.
+ * Returned nodes are pushed to a lock free stack that writer takes as a whole when its free list is empty.
+ *
+ * Elements should be trivially copyable since they are shared by processes that have no common heap.
+ *
+ * Wait object is local to each process so only wait policies that don't need the writer's notification
+ * (busy_spin_wait and spin_yield_wait) can be used across processes.
+ *
+ * Example:
+ *   auto region = shm_region::create("/orders", shm_queue<Order>::region_size(1024));
+ *   shm_queue<Order> q(region.data(), region.size(), shm_queue<Order>::create_mode); // in one process
+ *   shm_queue<Order> q(region.data(), region.size(), shm_queue<Order>::attach_mode); // in the other one
+ */
+template<class T, class Layout = cache_aligned_layout, class Wait = spin_yield_wait<>>
+class shm_queue
+{
+    static_assert(std::is_trivially_copyable<T>::value, "shm_queue elements should be trivially copyable");
+    static_assert(ATOMIC_INT_LOCK_FREE == 2 && ATOMIC_BOOL_LOCK_FREE == 2,
+                  "shm_queue needs address free atomics that are always lock free");
+    static_assert(is_process_agnostic_wait<Wait>::value,
+                  "shm_queue wait policy should not rely on writer's notification (busy_spin_wait or spin_yield_wait)");
+
+    using index_type = std::uint32_t;
+
+    static const index_type nil = 0xFFFFFFFF;
+    // Value of reader top while reader takes writer's queue (see queue::reading_mark()).
+    static const index_type reading_mark = 0xFFFFFFFE;
+
+    static const index_type magic_value = 0x314D5154; // "TQM1"
+
+    struct node
+    {
+        T value;
+        index_type next;
+    };
+
+    /*
+     * Queue state placed at the beginning of the region. Nodes follow it.
+     */
+    struct header
+    {
+        std::atomic<index_type> magic;
+        std::uint64_t header_size;
+        std::uint64_t node_size;
+        index_type capacity;
+
+        // writer's state
+        alignas(Layout::alignment) std::atomic<index_type> writer_top;
+        index_type writer_bottom;
+        index_type free_list;
+
+        // reader's state
+        alignas(Layout::alignment) std::atomic<index_type> reader_top;
+
+        // nodes returned by reader
+        alignas(Layout::alignment) std::atomic<index_type> returned;
+
+        // rarely changed state
+        alignas(Layout::alignment) std::atomic<bool> writer_finished;
+    };
+
+public:
+    using value_type = T;
+    using pointer    = T*;
+
+    enum mode
+    {
+        create_mode, // initialize new queue in the region
+        attach_mode  // use queue initialized by other process
+    };
+
+    /**
+     * Size of the region needed for the given number of nodes.
+     */
+    static std::size_t region_size(std::uint32_t capacity)
+    {
+        return nodes_offset() + std::size_t(capacity) * sizeof(node);
+    }
+
+    /**
+     * @param memory Beginning of the shared region. Should be aligned to the cache line (mmap() result is).
+     * @param size Size of the region. In create mode it defines the capacity of the queue.
+     * @param open_mode Initialize new queue or use existing one. Attaching fails if the region has no queue
+     *                  or the queue was created with different element type or layout (see is_valid()).
+     */
+    shm_queue(void *memory, std::size_t size, mode open_mode);
+
+    shm_queue(const shm_queue&) = delete;
+    shm_queue& operator=(const shm_queue&) = delete;
+
+    /**
+     * Return false if the queue can't be used: region is too small or doesn't contain compatible queue.
+     */
+    bool is_valid() const
+    {
+        return state != nullptr;
+    }
+
+    std::uint32_t capacity() const
+    {
+        return state->capacity;
+    }
+
+    /**
+     * Take a free node. Writer only method.
+     * Element is not initialized. It should be passed to write() after it is filled.
+     *
+     * @return element in the shared memory or nullptr if all nodes are in use.
+     */
+    pointer allocate();
+
+    /**
+     * Write element taken by allocate() to the queue. Writer only method.
+     *
+     * @return true if data was send to the reader otherwise false
+     */
+    bool write(pointer data);
+
+    /**
+     * Copy value to a free node and write it to the queue. Writer only method.
+     *
+     * @return false if all nodes are in use.
+     */
+    bool push(const T &value);
+
+    /**
+     * Read data from the queue. Reader only method.
+     * Element stays in the shared memory until it is passed to release().
+     *
+     * @param data [OUT] Data to retrieve.
+     * @return true if data was retrieved otherwise false.
+     */
+    bool read(pointer &data);
+
+    /**
+     * Return node of the read element to the writer. Reader only method.
+     */
+    void release(pointer data);
+
+    /**
+     * Read element, copy it to the value and release its node. Reader only method.
+     *
+     * @return true if data was retrieved otherwise false.
+     */
+    bool pop(T &value);
+
+    /**
+     * Read data from queue waiting for it according to the wait policy. Reader only method.
+     *
+     * @return true if data was retrieved otherwise false (timeout or writer is finished and queue is empty).
+     */
+    template<class Rep, class Period>
+    bool read_for(pointer &data, const std::chrono::duration<Rep, Period> &timeout)
+    {
+        return read_until(data, std::chrono::steady_clock::now() + timeout);
+    }
+
+    /**
+     * Read data from queue waiting for it until writer is finished. Reader only method.
+     *
+     * @return true if data was retrieved otherwise false (writer is finished and queue is empty).
+     */
+    bool read_wait(pointer &data)
+    {
+        return read_until(data, std::chrono::steady_clock::time_point::max());
+    }
+
+    void set_writer_finished()
+    {
+        state->writer_finished.store(true, std::memory_order_release);
+        waiter.notify(true);
+    }
+
+    bool is_writer_finished() const
+    {
+        return state->writer_finished.load(std::memory_order_acquire);
+    }
+
+private:
+    static constexpr std::size_t nodes_offset()
+    {
+        return (sizeof(header) + alignof(node) - 1) / alignof(node) * alignof(node);
+    }
+
+    node &at(index_type index)
+    {
+        return reinterpret_cast<node*>(nodes)[index];
+    }
+
+    index_type index_of(pointer data)
+    {
+        auto offset = std::size_t(reinterpret_cast<char*>(data) - nodes);
+        assert(offset < std::size_t(state->capacity) * sizeof(node));
+        return index_type(offset / sizeof(node));
+    }
+
+    index_type take_writer_queue();
+
+    template<class TimePoint>
+    bool read_until(pointer &data, const TimePoint &deadline);
+
+    header *state = nullptr;
+    char *nodes = nullptr;
+    Wait waiter;
+};
+
+/*
+ * Creator initializes the header and the free list and sets magic value last,
+ * so a process that attaches with a valid magic value sees initialized queue.
+ */
+template<class T, class Layout, class Wait>
+shm_queue<T, Layout, Wait>::shm_queue(void *memory, std::size_t size, mode open_mode)
+{
+    assert(reinterpret_cast<std::uintptr_t>(memory) % alignof(header) == 0);
+
+    if (memory == nullptr || size < region_size(1))
+    {
+        return;
+    }
+
+    auto hdr = static_cast<header*>(memory);
+    if (open_mode == create_mode)
+    {
+        auto count = (size - nodes_offset()) / sizeof(node);
+        if (count >= reading_mark)
+        {
+            count = reading_mark - 1;
+        }
+
+        hdr = new (memory) header();
+        hdr->header_size = sizeof(header);
+        hdr->node_size   = sizeof(node);
+        hdr->capacity    = index_type(count);
+
+        hdr->writer_top.store(nil, std::memory_order_relaxed);
+        hdr->writer_bottom = nil;
+        hdr->reader_top.store(nil, std::memory_order_relaxed);
+        hdr->returned.store(nil, std::memory_order_relaxed);
+        hdr->writer_finished.store(false, std::memory_order_relaxed);
+
+        nodes = static_cast<char*>(memory) + nodes_offset();
+        for (index_type i = 0; i < hdr->capacity; ++i)
+        {
+            reinterpret_cast<node*>(nodes)[i].next = i + 1 < hdr->capacity ? i + 1 : nil;
+        }
+        hdr->free_list = 0;
+
+        hdr->magic.store(magic_value, std::memory_order_release);
+    }
+    else
+    {
+        if (hdr->magic.load(std::memory_order_acquire) != magic_value ||
+            hdr->header_size != sizeof(header) || hdr->node_size != sizeof(node) ||
+            region_size(hdr->capacity) > size)
+        {
+            return;
+        }
+
+        nodes = static_cast<char*>(memory) + nodes_offset();
+    }
+
+    state = hdr;
+}
+
+/*
+ * Take node from the writer's free list.
+ * If it is empty then take the whole stack of returned nodes using atomic::exchange(nil)
+ * the same way node_pool does.
+ */
+template<class T, class Layout, class Wait>
+typename shm_queue<T, Layout, Wait>::pointer shm_queue<T, Layout, Wait>::allocate()
+{
+    if (state->free_list == nil)
+    {
+        state->free_list = state->returned.exchange(nil, std::memory_order_acquire);
+        if (state->free_list == nil)
+        {
+            return nullptr;
+        }
+    }
+
+    node &n = at(state->free_list);
+    state->free_list = n.next;
+
+    return &n.value;
+}
+
+/*
+ * Pass element to the queue. Algorithm is the same as queue::publish() uses with indexes instead of pointers.
+ */
+template<class T, class Layout, class Wait>
+bool shm_queue<T, Layout, Wait>::write(pointer data)
+{
+    assert(!state->writer_finished.load(std::memory_order_relaxed));
+    assert(data != nullptr);
+
+    index_type elem = index_of(data);
+    at(elem).next = nil;
+
+    index_type w_top = state->writer_top.exchange(nil, std::memory_order_acq_rel);
+    if (w_top == nil)
+    {
+        w_top = elem; // start new writer queue
+    }
+    else
+    {
+        at(state->writer_bottom).next = elem; // append new element to the end of the writer's queue
+    }
+    state->writer_bottom = elem;
+
+    index_type r_top = state->reader_top.load(std::memory_order_acquire);
+    if (r_top == nil && // reader don't have anything to read
+        state->reader_top.compare_exchange_strong(r_top, w_top, std::memory_order_acq_rel)) // give reader writer's queue
+    {
+        waiter.notify(true);
+        return true;
+    }
+
+    state->writer_top.store(w_top, std::memory_order_release); // restore writer's top
+
+    waiter.notify(false);
+    return false;
+}
+
+template<class T, class Layout, class Wait>
+bool shm_queue<T, Layout, Wait>::push(const T &value)
+{
+    pointer data = allocate();
+    if (data == nullptr)
+    {
+        return false;
+    }
+
+    *data = value;
+    write(data);
+
+    return true;
+}
+
+/*
+ * Read data from the queue. Algorithm is the same as queue::read() uses.
+ */
+template<class T, class Layout, class Wait>
+bool shm_queue<T, Layout, Wait>::read(pointer &data)
+{
+    index_type r_top = state->reader_top.load(std::memory_order_acquire);
+    if (r_top == nil)
+    {
+        r_top = take_writer_queue();
+        if (r_top == nil)
+        {
+            return false;
+        }
+    }
+
+    state->reader_top.store(at(r_top).next, std::memory_order_release);
+
+    data = &at(r_top).value;
+
+    return true;
+}
+
+/*
+ * Push node to the stack of returned nodes. Reader is the only pusher and writer takes the whole stack
+ * so there is no ABA problem.
+ */
+template<class T, class Layout, class Wait>
+void shm_queue<T, Layout, Wait>::release(pointer data)
+{
+    assert(data != nullptr);
+
+    index_type elem = index_of(data);
+    node &n = at(elem);
+
+    index_type top = state->returned.load(std::memory_order_relaxed);
+    do
+    {
+        n.next = top;
+    }
+    while (!state->returned.compare_exchange_weak(top, elem, std::memory_order_release, std::memory_order_relaxed));
+}
+
+template<class T, class Layout, class Wait>
+bool shm_queue<T, Layout, Wait>::pop(T &value)
+{
+    pointer data = nullptr;
+    if (!read(data))
+    {
+        return false;
+    }
+
+    value = *data;
+    release(data);
+
+    return true;
+}
+
+/*
+ * Take writer's queue when reader's one is empty (see queue::take_writer_queue()).
+ */
+template<class T, class Layout, class Wait>
+typename shm_queue<T, Layout, Wait>::index_type shm_queue<T, Layout, Wait>::take_writer_queue()
+{
+    index_type r_top = nil;
+    if (!state->reader_top.compare_exchange_strong(r_top, reading_mark, std::memory_order_acq_rel))
+    {
+        return r_top; // writer gave its queue
+    }
+
+    r_top = state->writer_top.exchange(nil, std::memory_order_acq_rel);
+    if (r_top == nil)
+    {
+        state->reader_top.store(nil, std::memory_order_release);
+    }
+
+    return r_top;
+}
+
+/*
+ * Writer could write data and finish between the last read() and is_writer_finished() calls
+ * so queue is checked once more after the writer is finished.
+ */
+template<class T, class Layout, class Wait>
+template<class TimePoint>
+bool shm_queue<T, Layout, Wait>::read_until(pointer &data, const TimePoint &deadline)
+{
+    bool result = false;
+    waiter.wait_until([&]
+    {
+        result = read(data);
+        return result || is_writer_finished();
+    }, deadline);
+
+    return result || read(data);
+}
+
+} // namespace types
+
+#endif // TYPES_SHM_QUEUE_H
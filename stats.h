@@ -0,0 +1,250 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Oleg Khryptul aka HaronK
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef TYPES_STATS_H
+#define TYPES_STATS_H
+
+// NOTE: statistics policies use std::atomic directly. They are not part of the lock free algorithms
+// and are not checked with Relacy Race Detector library.
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+
+namespace types
+{
+
+/**
+ * Snapshot of the queue counters.
+ */
+struct queue_stats
+{
+    std::uint64_t writes            = 0; // written elements
+    std::uint64_t reads             = 0; // read elements
+    std::uint64_t empty_reads       = 0; // reads that found the queue empty
+    std::uint64_t handoffs          = 0; // writer's segments passed to the reader (write() returned true)
+    std::uint64_t handoff_items     = 0; // elements passed to the reader with all handoffs
+    std::uint64_t max_handoff_items = 0; // largest segment passed to the reader
+    std::uint64_t max_depth         = 0; // largest number of written but not read elements seen on writes and takes
+    std::uint64_t drops             = 0; // elements dropped by try_write() because the queue was full
+
+    double average_handoff_items() const
+    {
+        return handoffs > 0 ? static_cast<double>(handoff_items) / handoffs : 0;
+    }
+};
+
+/**
+ * Statistics policies for queues.
+ *
+ * Each policy has writer_side and reader_side counter types. Queue keeps them next to the state of
+ * the corresponding side and only this side updates them, so counting adds no cross-core traffic.
+ * The only exception is the queue depth: writer loads reader's read counter on each write and reader
+ * loads writer's write counters when it takes writer's segment.
+ */
+
+/**
+ * Statistics are not collected. All the hooks are empty and are optimized out.
+ */
+struct no_stats
+{
+    static const bool enabled = false;
+
+    struct reader_side
+    {
+        void on_read(std::uint64_t) {}
+        void on_empty_read() {}
+
+        template<class Writer>
+        void on_take(const Writer&) {}
+    };
+
+    struct writer_side
+    {
+        void on_write(std::uint64_t, bool) {}
+        void on_drop(bool, bool) {}
+        void on_depth(const reader_side&) {}
+        void on_handoff(const reader_side&) {}
+    };
+
+    static queue_stats snapshot(const writer_side&, const reader_side&)
+    {
+        return queue_stats();
+    }
+};
+
+/**
+ * Counters are updated with relaxed loads and stores without read-modify-write operations
+ * because each of them has only one writing thread. snapshot() can be called from any thread.
+ */
+struct counting_stats
+{
+    static const bool enabled = true;
+
+    class counter
+    {
+    public:
+        void add(std::uint64_t n)
+        {
+            value.store(value.load(std::memory_order_relaxed) + n, std::memory_order_relaxed);
+        }
+
+        void set_max(std::uint64_t n)
+        {
+            if (n > value.load(std::memory_order_relaxed))
+            {
+                value.store(n, std::memory_order_relaxed);
+            }
+        }
+
+        std::uint64_t get() const
+        {
+            return value.load(std::memory_order_relaxed);
+        }
+
+    private:
+        std::atomic<std::uint64_t> value{0};
+    };
+
+    /**
+     * Number of written but not read elements. Counters are loaded by different threads without
+     * synchronization so written can be seen behind read.
+     */
+    static std::uint64_t depth(std::uint64_t written, std::uint64_t read)
+    {
+        return written > read ? written - read : 0;
+    }
+
+    struct reader_side
+    {
+        counter reads;
+        counter empty_reads;
+        counter max_depth; // depth seen by the reader when it takes writer's segment
+
+        /**
+         * @param count Number of elements passed to the reader's caller.
+         */
+        void on_read(std::uint64_t count)
+        {
+            reads.add(count);
+        }
+
+        void on_empty_read()
+        {
+            empty_reads.add(1);
+        }
+
+        /**
+         * Reader took writer's segment.
+         */
+        template<class Writer>
+        void on_take(const Writer &writer)
+        {
+            max_depth.set_max(depth(writer.written(), reads.get()));
+        }
+    };
+
+    struct writer_side
+    {
+        counter writes;
+        counter handoffs;
+        counter handoff_items;
+        counter max_handoff_items;
+        counter max_depth;
+        counter drops;
+        counter written_drops;
+
+        std::uint64_t segment_size = 0; // elements in the writer's segment
+
+        /**
+         * @param count Number of written elements.
+         * @param new_segment true if the elements started new writer's segment.
+         */
+        void on_write(std::uint64_t count, bool new_segment)
+        {
+            writes.add(count);
+            segment_size = new_segment ? count : segment_size + count;
+        }
+
+        /**
+         * @param written true if the element was counted in writes before (dropped from the writer's queue).
+         * @param from_segment true if the element was dropped from the writer's segment.
+         */
+        void on_drop(bool written, bool from_segment)
+        {
+            drops.add(1);
+            if (written)
+            {
+                written_drops.add(1);
+            }
+            if (from_segment)
+            {
+                segment_size--;
+            }
+        }
+
+        /**
+         * Elements were passed to the queue.
+         */
+        void on_depth(const reader_side &reader)
+        {
+            max_depth.set_max(depth(written(), reader.reads.get()));
+        }
+
+        void on_handoff(const reader_side&)
+        {
+            handoffs.add(1);
+            handoff_items.add(segment_size);
+            max_handoff_items.set_max(segment_size);
+            segment_size = 0;
+        }
+
+        /**
+         * Written and not dropped elements. Drops are loaded first so they never exceed the writes.
+         */
+        std::uint64_t written() const
+        {
+            auto dropped = written_drops.get();
+            return writes.get() - dropped;
+        }
+    };
+
+    static queue_stats snapshot(const writer_side &writer, const reader_side &reader)
+    {
+        queue_stats stats;
+        stats.writes            = writer.writes.get();
+        stats.reads             = reader.reads.get();
+        stats.empty_reads       = reader.empty_reads.get();
+        stats.handoffs          = writer.handoffs.get();
+        stats.handoff_items     = writer.handoff_items.get();
+        stats.max_handoff_items = writer.max_handoff_items.get();
+        stats.max_depth         = std::max(writer.max_depth.get(), reader.max_depth.get());
+        stats.drops             = writer.drops.get();
+        return stats;
+    }
+};
+
+} // namespace types
+
+#endif // TYPES_STATS_H
@@ -0,0 +1,183 @@
+#include <iostream>
+#include <fstream>
+#include <thread>
+#include <atomic>
+#include <cassert>
+#include <cstdio>
+#include <string>
+#include <vector>
+
+#include <unistd.h>
+
+using namespace std;
+
+#include "queue.h"
+#include "node_pool.h"
+#include "async_logger.h"
+
+std::vector<std::string> read_lines(const std::string &path)
+{
+    std::vector<std::string> lines;
+    std::ifstream f(path);
+    std::string line;
+    while (std::getline(f, line))
+    {
+        lines.push_back(line);
+    }
+    return lines;
+}
+
+/*
+ * Message of each argument type is formatted by the logger thread.
+ */
+void format_test(const std::string &path)
+{
+    std::cout << "    format\n";
+
+    std::remove(path.c_str());
+    {
+        types::async_logger logger(path.c_str());
+        assert(logger.error() == 0);
+
+        auto log = logger.attach();
+        std::string name = "name";
+        char buf[] = "buffer";
+        const char *null_text = nullptr;
+
+        log.log("no arguments");
+        log.log("int {} long {} unsigned {} size {}", -1, -2L, 3u, std::size_t(4));
+        log.log("double {} char {} bool {} {}", 0.5, 'c', true, false);
+        log.log("literal {} string {} buffer {} null {}", "text", name, buf, null_text);
+        log.log("missing {} {}", 1);
+        log.log("extra {}", 1, 2);
+        log.log("{}{}", 1, 2);
+        log.log("long {}", std::string(200, 'x'));
+    }
+
+    auto lines = read_lines(path);
+    assert(lines.size() == 8);
+
+    const char *expected[] =
+    {
+        "no arguments",
+        "int -1 long -2 unsigned 3 size 4",
+        "double 0.5 char c bool true false",
+        "literal text string name buffer buffer null (null)",
+        "missing 1 {}",
+        "extra 1",
+        "12",
+        nullptr
+    };
+
+    for (std::size_t i = 0; i < lines.size(); ++i)
+    {
+        auto space = lines[i].find(' ');
+        assert(space != std::string::npos);
+        auto text = lines[i].substr(space + 1);
+
+        if (expected[i] != nullptr)
+        {
+            assert(text == expected[i]);
+        }
+        else
+        {
+            // strings are truncated to the record's text buffer
+            assert(text == "long " + std::string(types::log_record::text_capacity, 'x'));
+        }
+    }
+
+    std::remove(path.c_str());
+}
+
+/*
+ * Each thread logs increasing numbers. All messages are written and messages of one thread keep the order.
+ */
+void multi_thread_test(const std::string &path, int threads_count, int data_count, std::size_t lane_capacity)
+{
+    std::cout << "    " << threads_count << " threads, lane capacity " << lane_capacity << "\n";
+
+    std::remove(path.c_str());
+
+    std::atomic<std::size_t> dropped(0);
+    {
+        types::async_logger::options opts;
+        opts.buffer_size   = 4096;
+        opts.lane_capacity = lane_capacity;
+        opts.idle_sleep    = std::chrono::microseconds(100);
+
+        types::async_logger logger(path.c_str(), opts);
+
+        std::vector<std::thread> threads;
+        for (auto t = 0; t < threads_count; ++t)
+        {
+            threads.emplace_back([&, t]
+            {
+                auto log = logger.attach();
+                for (auto i = 0; i < data_count; ++i)
+                {
+                    log.log("thread {} message {}", t, i);
+                }
+                dropped.fetch_add(log.dropped());
+            });
+        }
+
+        for (auto &t : threads)
+        {
+            t.join();
+        }
+    }
+
+    auto lines = read_lines(path);
+    assert(lines.size() + dropped.load() == static_cast<std::size_t>(threads_count) * data_count);
+    assert(lane_capacity != 0 || dropped.load() == 0);
+
+    std::vector<int> last(threads_count, -1);
+    for (auto &line : lines)
+    {
+        int t = -1, i = -1;
+        auto space = line.find(' ');
+        assert(std::sscanf(line.c_str() + space, " thread %d message %d", &t, &i) == 2);
+        assert(0 <= t && t < threads_count);
+        assert(i > last[t]);
+        assert(lane_capacity != 0 || i == last[t] + 1);
+        last[t] = i;
+    }
+
+    std::remove(path.c_str());
+}
+
+int main(int argc, const char* argv[])
+{
+    std::cout << "Start...\n";
+
+    int attempts_count = 1, threads_count = 4, data_count = 20000;
+
+    if (argc == 4)
+    {
+        attempts_count = std::stoi(argv[1]);
+        threads_count  = std::stoi(argv[2]);
+        data_count     = std::stoi(argv[3]);
+    }
+    else if (argc != 1)
+    {
+        std::cout << "Usage: ./async_logger_test [<attempts_count:1> <threads_count:4> <data_count:20000>]\n";
+        return 0;
+    }
+
+    std::string path = "async_logger_test." + std::to_string(::getpid()) + ".log";
+
+    for (auto i = 0; i < attempts_count; ++i)
+    {
+        std::cout << "=======================================================\n";
+        std::cout << "  Attempt " << i << "/" << attempts_count << "\n";
+
+        format_test(path);
+        multi_thread_test(path, 1, data_count, 0);
+        multi_thread_test(path, threads_count, data_count, 0);
+        multi_thread_test(path, threads_count, data_count, 64);
+    }
+
+    std::cout << "Finish.\n";
+
+    return 0;
+}
@@ -0,0 +1,149 @@
+#include <iostream>
+#include <thread>
+#include <atomic>
+#include <cassert>
+#include <memory>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+#include "broadcast_queue.h"
+
+/*
+ * Every reader gets every element and the slowest reader gates the writer.
+ */
+void single_thread_test()
+{
+    std::cout << "  Single thread...\n";
+
+    std::unique_ptr<types::broadcast_queue<std::string, 4>> q(new types::broadcast_queue<std::string, 4>(2));
+
+    for (auto i = 0; i < 4; ++i)
+    {
+        assert(q->write(std::to_string(i)));
+    }
+    assert(!q->write("full"));
+
+    std::string s;
+    assert(q->read(0, s) && s == "0");
+    assert(q->read(0, s) && s == "1");
+    assert(!q->write("full")); // reader 1 has not read anything
+
+    assert(q->read(1, s) && s == "0");
+    assert(q->write("4"));
+    assert(!q->write("full"));
+
+    int expected = 1;
+    auto n = q->read_all(1, [&](const std::string &v) { assert(v == std::to_string(expected++)); });
+    assert(n == 4 && expected == 5);
+    assert(!q->read(1, s));
+
+    assert(q->write("5"));
+    assert(!q->write("full")); // reader 0 is at 2
+
+    expected = 2;
+    while (q->read(0, s))
+    {
+        assert(s == std::to_string(expected++));
+    }
+    assert(expected == 6);
+}
+
+template<std::size_t Capacity>
+void multi_thread_test(int readers, int data_count)
+{
+    std::cout << "  " << readers << " readers, capacity " << Capacity << "...\n";
+
+    std::unique_ptr<types::broadcast_queue<int, Capacity>> q(new types::broadcast_queue<int, Capacity>(readers));
+
+    std::vector<std::thread> threads;
+    threads.emplace_back([&]
+    {
+        for (auto i = 0; i < data_count; ++i)
+        {
+            while (!q->write(i))
+            {
+                std::this_thread::yield();
+            }
+        }
+        q->set_writer_finished();
+    });
+
+    for (auto r = 0; r < readers; ++r)
+    {
+        threads.emplace_back([&, r]
+        {
+            int expected = 0;
+            auto check = [&](int v) { assert(v == expected); expected++; };
+
+            for (;;)
+            {
+                // odd readers process batches in place
+                std::size_t n = 0;
+                int v = 0;
+                if (r % 2 == 0)
+                {
+                    if (q->read(r, v))
+                    {
+                        check(v);
+                        n = 1;
+                    }
+                }
+                else
+                {
+                    n = q->read_all(r, check);
+                }
+
+                if (n == 0)
+                {
+                    if (q->is_writer_finished() && q->read_all(r, check) == 0)
+                    {
+                        break;
+                    }
+                    std::this_thread::yield();
+                }
+            }
+
+            assert(expected == data_count);
+        });
+    }
+
+    for (auto &t : threads)
+    {
+        t.join();
+    }
+}
+
+int main(int argc, const char* argv[])
+{
+    std::cout << "Start...\n";
+
+    int attempts_count = 1, data_count = 1000000;
+
+    if (argc == 3)
+    {
+        attempts_count = std::stoi(argv[1]);
+        data_count     = std::stoi(argv[2]);
+    }
+    else if (argc != 1)
+    {
+        std::cout << "Usage: ./broadcast_queue_test [<attempts_count:1> <data_count:1000000>]\n";
+        return 0;
+    }
+
+    for (auto i = 0; i < attempts_count; ++i)
+    {
+        std::cout << "=======================================================\n";
+        std::cout << "  Attempt " << i << "/" << attempts_count << "\n";
+
+        single_thread_test();
+        multi_thread_test<1024>(1, data_count);
+        multi_thread_test<1024>(4, data_count);
+        multi_thread_test<4>(3, data_count / 10);
+    }
+
+    std::cout << "Finish.\n";
+
+    return 0;
+}
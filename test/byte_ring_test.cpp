@@ -0,0 +1,181 @@
+#include <iostream>
+#include <thread>
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <cstring>
+#include <memory>
+#include <random>
+#include <string>
+
+using namespace std;
+
+#include "byte_ring.h"
+
+using Ring = types::byte_ring<65536>;
+
+/*
+ * Message bytes are derived from its sequence number so reader can check them.
+ */
+void fill(unsigned char *data, std::size_t size, std::uint32_t seq)
+{
+    for (std::size_t i = 0; i < size; ++i)
+    {
+        data[i] = static_cast<unsigned char>(seq + i);
+    }
+}
+
+bool check(const unsigned char *data, std::size_t size, std::uint32_t seq)
+{
+    for (std::size_t i = 0; i < size; ++i)
+    {
+        if (data[i] != static_cast<unsigned char>(seq + i))
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+/*
+ * Records wrap around the end of the buffer with padding, reservations can be shrunk and dropped.
+ */
+void single_thread_test()
+{
+    std::cout << "  Single thread...\n";
+
+    std::unique_ptr<types::byte_ring<64>> ring(new types::byte_ring<64>());
+    std::size_t size = 0;
+    assert(ring->peek(size) == nullptr);
+
+    // 24 + 24 bytes fill the first 48 bytes
+    assert(ring->write("0123456789abcdef", 16));
+    assert(ring->write("fedcba9876543210", 16));
+    assert(ring->reserve(16) == nullptr);
+
+    auto msg = static_cast<const char*>(ring->peek(size));
+    assert(msg != nullptr && size == 16 && std::memcmp(msg, "0123456789abcdef", 16) == 0);
+    assert(ring->peek(size) == msg);
+    ring->release();
+
+    // record doesn't fit to the last 16 bytes so it goes to the beginning after padding
+    auto space = static_cast<char*>(ring->reserve(12));
+    assert(space != nullptr);
+    assert(reinterpret_cast<std::uintptr_t>(space) % Ring::record_alignment == 0);
+    std::memcpy(space, "hello", 5);
+    ring->commit(5);
+
+    // dropped reservation
+    assert(ring->reserve(0) != nullptr);
+
+    msg = static_cast<const char*>(ring->peek(size));
+    assert(msg != nullptr && size == 16 && std::memcmp(msg, "fedcba9876543210", 16) == 0);
+    ring->release();
+
+    msg = static_cast<const char*>(ring->peek(size));
+    assert(msg != nullptr && size == 5 && std::memcmp(msg, "hello", 5) == 0);
+    ring->release();
+
+    assert(ring->peek(size) == nullptr);
+
+    // the largest message fits once the ring is empty
+    assert(ring->reserve(ring->max_message_size()) != nullptr);
+    ring->commit();
+    assert(ring->peek(size) != nullptr && size == ring->max_message_size());
+    ring->release();
+}
+
+void writer_thread(Ring *ring, int n, std::size_t max_size)
+{
+    std::mt19937 gen(n);
+    std::uniform_int_distribution<std::size_t> dis(0, max_size);
+
+    for (auto i = 0; i < n; ++i)
+    {
+        std::size_t size = dis(gen);
+
+        void *space;
+        while ((space = ring->reserve(size)) == nullptr)
+        {
+            std::this_thread::yield();
+        }
+        fill(static_cast<unsigned char*>(space), size, std::uint32_t(i));
+        ring->commit();
+    }
+
+    ring->set_writer_finished();
+}
+
+void reader_thread(Ring *ring, int n, std::size_t max_size)
+{
+    std::mt19937 gen(n);
+    std::uniform_int_distribution<std::size_t> dis(0, max_size);
+
+    int expected = 0;
+    for (;;)
+    {
+        std::size_t size = 0;
+        auto msg = ring->peek(size);
+        if (msg == nullptr)
+        {
+            if (ring->is_writer_finished() && ring->peek(size) == nullptr)
+            {
+                break;
+            }
+            continue;
+        }
+
+        assert(size == dis(gen));
+        assert(check(static_cast<const unsigned char*>(msg), size, std::uint32_t(expected)));
+        expected++;
+
+        ring->release();
+    }
+
+    assert(expected == n);
+}
+
+void multi_thread_test(int data_count, std::size_t max_size)
+{
+    std::cout << "  Messages up to " << max_size << " bytes...\n";
+
+    std::unique_ptr<Ring> ring(new Ring());
+
+    std::thread wt(writer_thread, ring.get(), data_count, max_size);
+    std::thread rt(reader_thread, ring.get(), data_count, max_size);
+
+    wt.join();
+    rt.join();
+}
+
+int main(int argc, const char* argv[])
+{
+    std::cout << "Start...\n";
+
+    int attempts_count = 1, data_count = 100000;
+
+    if (argc == 3)
+    {
+        attempts_count = std::stoi(argv[1]);
+        data_count     = std::stoi(argv[2]);
+    }
+    else if (argc != 1)
+    {
+        std::cout << "Usage: ./byte_ring_test [<attempts_count:1> <data_count:100000>]\n";
+        return 0;
+    }
+
+    for (auto i = 0; i < attempts_count; ++i)
+    {
+        std::cout << "=======================================================\n";
+        std::cout << "  Attempt " << i << "/" << attempts_count << "\n";
+
+        single_thread_test();
+        multi_thread_test(data_count, 64);
+        multi_thread_test(data_count, 1024);
+    }
+
+    std::cout << "Finish.\n";
+
+    return 0;
+}
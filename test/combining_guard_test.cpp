@@ -0,0 +1,147 @@
+
+#include <iostream>
+#include <thread>
+#include <atomic>
+#include <cassert>
+#include <memory>
+#include <mutex>
+#include <string>
+#include <vector>
+
+using namespace std;
+
+#include "combining_guard.h"
+#include "queue.h"
+#include "writer.h"
+
+struct Data
+{
+    Data(int d) : next(nullptr), data(d) {}
+
+    Data *next;
+    int data;
+};
+
+struct Counter
+{
+    std::uint64_t value = 0;
+};
+
+/*
+ * Threads increment not atomic counter. Values returned to each thread grow.
+ * Slots count is less than threads count so some threads run their operations themselves.
+ */
+template<std::size_t Slots>
+void counter_test(int threads_count, int n)
+{
+    std::cout << "    Counter: " << threads_count << " threads, " << Slots << " slots\n";
+
+    types::combining_guard<Counter, Slots> counter;
+    std::vector<std::thread> threads;
+    for (auto t = 0; t < threads_count; ++t)
+    {
+        threads.emplace_back([&, t]
+        {
+            std::vector<std::uint64_t> values;
+            for (auto i = 0; i < n; ++i)
+            {
+                values.push_back(counter.with([](Counter &c) { return c.value++; }));
+            }
+
+            for (std::size_t i = 1; i < values.size(); ++i)
+            {
+                assert(values[i] > values[i - 1]);
+            }
+        });
+    }
+
+    for (auto &t : threads)
+        t.join();
+
+    auto total = counter.with([](Counter &c) { return c.value; });
+    assert(total == static_cast<std::uint64_t>(threads_count) * n);
+
+    // functions returning void and not trivial types
+    counter.with([](Counter &c) { c.value = 0; });
+    auto s = counter.with([](Counter &c) { return std::to_string(c.value); });
+    assert(s == "0");
+}
+
+/*
+ * Writers write to one queue through combining_guard, each writer's values come in order.
+ */
+void queue_test(int writers_count, int n)
+{
+    std::cout << "    combining_guard<writer<queue>>: " << writers_count << " writers\n";
+
+    using Queue  = types::queue<Data>;
+    using Writer = types::writer<Queue>;
+
+    auto q = std::make_shared<Queue>();
+    types::combining_guard<Writer> w(q);
+
+    std::vector<std::thread> threads;
+    for (auto t = 0; t < writers_count; ++t)
+    {
+        threads.emplace_back([&w, t, n]
+        {
+            for (auto i = 0; i < n; ++i)
+            {
+                auto d = new Data(t * n + i);
+                w.with([d](Writer &w) { w.write(d); });
+            }
+        });
+    }
+
+    std::vector<int> last(writers_count, -1);
+    std::uint64_t count = 0, total = static_cast<std::uint64_t>(writers_count) * n;
+    while (count < total)
+    {
+        auto read = q->drain([&](Data *d)
+        {
+            auto t = d->data / n;
+            assert(d->data > last[t]);
+            last[t] = d->data;
+            delete d;
+        });
+        if (read == 0)
+            std::this_thread::yield();
+        count += read;
+    }
+
+    for (auto &t : threads)
+        t.join();
+}
+
+int main(int argc, const char* argv[])
+{
+    std::cout << "Start...\n";
+
+    int attempts_count = 1, threads_count = 8, data_count = 20000;
+
+    if (argc == 4)
+    {
+        attempts_count = std::stoi(argv[1]);
+        threads_count  = std::stoi(argv[2]);
+        data_count     = std::stoi(argv[3]);
+    }
+    else if (argc != 1)
+    {
+        std::cout << "Usage: ./combining_guard_test [<attempts_count:1> <threads_count:8> <data_count:20000>]\n";
+        return 0;
+    }
+
+    for (auto i = 0; i < attempts_count; ++i)
+    {
+        std::cout << "=======================================================\n";
+        std::cout << "  Attempt " << i << "/" << attempts_count << "\n";
+
+        counter_test<64>(threads_count, data_count);
+        counter_test<2>(threads_count, data_count);
+        queue_test(threads_count, data_count);
+    }
+
+    std::cout << "Finish.\n";
+
+    return 0;
+}
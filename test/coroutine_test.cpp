@@ -0,0 +1,151 @@
+#include <iostream>
+#include <thread>
+#include <atomic>
+#include <cassert>
+#include <memory>
+#include <vector>
+
+using namespace std;
+
+#include "queue.h"
+#include "coroutine.h"
+
+struct Data
+{
+    Data(int d) : next(nullptr), data(d) {}
+
+    Data *next;
+    int data;
+};
+
+using Queue = types::queue<Data, types::cache_aligned_layout, types::coroutine_wait<>>;
+
+types::task consumer(Queue &q, int n, std::atomic<int> &finished)
+{
+    int expected = 0;
+    while (Data *d = co_await q.async_read())
+    {
+        assert(d->data == expected);
+        expected++;
+
+        delete d;
+    }
+
+    assert(expected == n);
+    finished++;
+}
+
+types::task producer(types::scheduler &sched, Queue &q, int n)
+{
+    for (auto i = 0; i < n; ++i)
+    {
+        q.write(new Data(i));
+        if (i % 16 == 0)
+        {
+            co_await sched.yield();
+        }
+    }
+    q.set_writer_finished();
+}
+
+/*
+ * Producer and consumer coroutines share one thread.
+ */
+void single_thread_test(int data_count)
+{
+    std::cout << "  Single thread...\n";
+
+    types::scheduler sched;
+    Queue q;
+    std::atomic<int> finished(0);
+
+    sched.spawn(consumer(q, data_count, finished));
+    sched.spawn(producer(sched, q, data_count));
+    sched.run();
+
+    assert(finished == 1);
+}
+
+/*
+ * Many consumer coroutines read their own queues in one thread while writer threads write to them.
+ * The scheduler thread sleeps while all consumers are suspended.
+ */
+void multi_thread_test(int consumers, int writers, int data_count)
+{
+    std::cout << "  " << consumers << " consumers, " << writers << " writer threads...\n";
+
+    std::vector<std::unique_ptr<Queue>> queues;
+    for (auto i = 0; i < consumers; ++i)
+    {
+        queues.emplace_back(new Queue());
+    }
+
+    types::scheduler sched;
+    std::atomic<int> finished(0);
+
+    for (auto &q : queues)
+    {
+        sched.spawn(consumer(*q, data_count, finished));
+    }
+
+    std::vector<std::thread> threads;
+    for (auto w = 0; w < writers; ++w)
+    {
+        threads.emplace_back([&, w]
+        {
+            for (auto i = 0; i < data_count; ++i)
+            {
+                for (auto c = w; c < consumers; c += writers)
+                {
+                    queues[c]->write(new Data(i));
+                }
+            }
+
+            for (auto c = w; c < consumers; c += writers)
+            {
+                queues[c]->set_writer_finished();
+            }
+        });
+    }
+
+    sched.run();
+
+    for (auto &t : threads)
+    {
+        t.join();
+    }
+
+    assert(finished == consumers);
+}
+
+int main(int argc, const char* argv[])
+{
+    std::cout << "Start...\n";
+
+    int attempts_count = 1, data_count = 1000;
+
+    if (argc == 3)
+    {
+        attempts_count = std::stoi(argv[1]);
+        data_count     = std::stoi(argv[2]);
+    }
+    else if (argc != 1)
+    {
+        std::cout << "Usage: ./coroutine_test [<attempts_count:1> <data_count:1000>]\n";
+        return 0;
+    }
+
+    for (auto i = 0; i < attempts_count; ++i)
+    {
+        std::cout << "=======================================================\n";
+        std::cout << "  Attempt " << i << "/" << attempts_count << "\n";
+
+        single_thread_test(data_count * 100);
+        multi_thread_test(1, 1, data_count * 100);
+        multi_thread_test(1000, 4, data_count);
+    }
+
+    std::cout << "Finish.\n";
+
+    return 0;
+}
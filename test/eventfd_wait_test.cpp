@@ -0,0 +1,170 @@
+#include <iostream>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <cassert>
+#include <random>
+#include <memory>
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+
+using namespace std;
+
+#include "queue.h"
+
+struct Data
+{
+    Data(int d) : next(nullptr), data(d) {}
+
+    Data *next;
+    int data;
+};
+
+using Queue = types::queue<Data, types::cache_aligned_layout, types::eventfd_wait<>>;
+
+/*
+ * Descriptor is signalled once per handed off segment.
+ */
+void coalescing_test()
+{
+    std::cout << "  Coalescing...\n";
+
+    Queue q;
+    auto &waiter = q.get_wait_policy();
+    assert(waiter.fd() >= 0);
+    assert(waiter.reset() == 0);
+
+    assert(q.write(new Data(0)));
+    assert(!q.write(new Data(1)));
+    assert(!q.write(new Data(2)));
+    assert(waiter.reset() == 1);
+
+    Data *d = nullptr;
+    for (auto i = 0; i < 3; ++i)
+    {
+        assert(q.read(d) && d->data == i);
+        delete d;
+    }
+    assert(!q.read(d));
+
+    assert(q.write(new Data(3)));
+    assert(waiter.reset() == 1);
+
+    q.set_writer_finished();
+    assert(waiter.reset() == 1);
+    assert(q.read_wait(d) && d->data == 3);
+    delete d;
+    assert(!q.read_wait(d));
+}
+
+/*
+ * Reader runs epoll loop with the queue descriptor and a descriptor of other source (timer-like eventfd
+ * that is never signalled). Writer writes with random pauses. No element is left without a wakeup.
+ */
+void epoll_test(int data_count, int w_max_sleep)
+{
+    std::cout << "  Epoll loop...\n";
+
+    auto q = std::make_shared<Queue>();
+
+    int ep = epoll_create1(EPOLL_CLOEXEC);
+    assert(ep >= 0);
+
+    int other = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+
+    struct epoll_event ev = {};
+    ev.events  = EPOLLIN;
+    ev.data.fd = q->get_wait_policy().fd();
+    epoll_ctl(ep, EPOLL_CTL_ADD, ev.data.fd, &ev);
+    ev.data.fd = other;
+    epoll_ctl(ep, EPOLL_CTL_ADD, other, &ev);
+
+    std::thread wt([=]
+    {
+        std::mt19937 gen(data_count);
+        std::uniform_int_distribution<> dis(0, w_max_sleep);
+
+        for (auto i = 0; i < data_count; ++i)
+        {
+            q->write(new Data(i));
+            if (i % 8 == 0)
+            {
+                std::this_thread::sleep_for(std::chrono::microseconds(dis(gen)));
+            }
+        }
+        q->set_writer_finished();
+    });
+
+    int expected = 0, wakeups = 0;
+    bool finished = false;
+    while (!finished)
+    {
+        struct epoll_event events[2];
+        int n = epoll_wait(ep, events, 2, -1);
+        assert(n > 0);
+
+        for (auto i = 0; i < n; ++i)
+        {
+            assert(events[i].data.fd != other);
+
+            wakeups++;
+            q->get_wait_policy().reset();
+
+            finished = q->is_writer_finished();
+
+            Data *d = nullptr;
+            while (q->read(d))
+            {
+                assert(d->data == expected);
+                expected++;
+
+                delete d;
+            }
+        }
+    }
+
+    wt.join();
+
+    assert(expected == data_count);
+    assert(wakeups <= data_count + 1);
+
+    std::cout << "      " << expected << " records, " << wakeups << " wakeups\n";
+
+    close(other);
+    close(ep);
+}
+
+int main(int argc, const char* argv[])
+{
+    std::cout << "Start...\n";
+
+    int attempts_count = 1, data_count = 100000, w_max_sleep = 50;
+
+    if (argc == 4)
+    {
+        attempts_count = std::stoi(argv[1]);
+        data_count     = std::stoi(argv[2]);
+        w_max_sleep    = std::stoi(argv[3]);
+    }
+    else if (argc != 1)
+    {
+        std::cout << "Usage: ./eventfd_wait_test [<attempts_count:1> <data_count:100000> <writer_max_sleep_us:50>]\n";
+        return 0;
+    }
+
+    for (auto i = 0; i < attempts_count; ++i)
+    {
+        std::cout << "=======================================================\n";
+        std::cout << "  Attempt " << i << "/" << attempts_count << "\n";
+
+        coalescing_test();
+        epoll_test(data_count, w_max_sleep);
+        epoll_test(data_count, 0);
+    }
+
+    std::cout << "Finish.\n";
+
+    return 0;
+}
@@ -0,0 +1,156 @@
+
+#include <iostream>
+#include <thread>
+#include <atomic>
+#include <cassert>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+using namespace std;
+
+#include "locks.h"
+#include "queue.h"
+#include "writer.h"
+#include "guard.h"
+
+struct Data
+{
+    Data(int d) : next(nullptr), data(d) {}
+
+    Data *next;
+    int data;
+};
+
+/*
+ * Threads increment not atomic counters under the lock. Lost updates mean the lock doesn't work.
+ */
+template<class Lock>
+void counter_test(const char *name, int threads_count, int n)
+{
+    std::cout << "    " << name << "\n";
+
+    Lock lock;
+    std::uint64_t counter = 0, try_counter = 0;
+
+    assert(lock.try_lock());
+    assert(!lock.try_lock());
+    lock.unlock();
+
+    std::vector<std::thread> threads;
+    for (auto t = 0; t < threads_count; ++t)
+    {
+        threads.emplace_back([&]
+        {
+            for (auto i = 0; i < n; ++i)
+            {
+                std::lock_guard<Lock> l(lock);
+                counter++;
+            }
+
+            for (auto i = 0; i < n; ++i)
+            {
+                if (lock.try_lock())
+                {
+                    try_counter++;
+                    lock.unlock();
+                }
+            }
+        });
+    }
+
+    for (auto &t : threads)
+        t.join();
+
+    assert(counter == static_cast<std::uint64_t>(threads_count) * n);
+    assert(try_counter <= static_cast<std::uint64_t>(threads_count) * n);
+
+    // several locks held by the same thread
+    Lock other;
+    lock.lock();
+    other.lock();
+    lock.unlock();
+    other.unlock();
+}
+
+/*
+ * Writers write to one queue through guard with the lock.
+ */
+template<class Lock>
+void guard_test(const char *name, int writers_count, int n)
+{
+    std::cout << "    guard<writer<queue>, " << name << ">\n";
+
+    using Queue = types::queue<Data>;
+
+    auto q = std::make_shared<Queue>();
+    types::guard<types::writer<Queue>, Lock> w(q);
+
+    std::vector<std::thread> threads;
+    for (auto t = 0; t < writers_count; ++t)
+    {
+        threads.emplace_back([&w, n]
+        {
+            for (auto i = 0; i < n; ++i)
+                w->write(new Data(i));
+        });
+    }
+
+    std::uint64_t count = 0;
+    std::thread reader([&]
+    {
+        auto total = static_cast<std::uint64_t>(writers_count) * n;
+        while (count < total)
+        {
+            auto read = q->drain([](Data *d) { delete d; });
+            if (read == 0)
+                std::this_thread::yield();
+            count += read;
+        }
+    });
+
+    for (auto &t : threads)
+        t.join();
+    reader.join();
+
+    assert(count == static_cast<std::uint64_t>(writers_count) * n);
+}
+
+int main(int argc, const char* argv[])
+{
+    std::cout << "Start...\n";
+
+    int attempts_count = 1, threads_count = 8, data_count = 20000;
+
+    if (argc == 4)
+    {
+        attempts_count = std::stoi(argv[1]);
+        threads_count  = std::stoi(argv[2]);
+        data_count     = std::stoi(argv[3]);
+    }
+    else if (argc != 1)
+    {
+        std::cout << "Usage: ./locks_test [<attempts_count:1> <threads_count:8> <data_count:20000>]\n";
+        return 0;
+    }
+
+    for (auto i = 0; i < attempts_count; ++i)
+    {
+        std::cout << "=======================================================\n";
+        std::cout << "  Attempt " << i << "/" << attempts_count << "\n";
+
+        counter_test<types::ttas_spinlock>("ttas_spinlock", threads_count, data_count);
+        counter_test<types::ticket_lock>("ticket_lock", threads_count, data_count);
+        counter_test<types::mcs_lock>("mcs_lock", threads_count, data_count);
+        counter_test<types::adaptive_mutex>("adaptive_mutex", threads_count, data_count);
+
+        guard_test<types::ttas_spinlock>("ttas_spinlock", threads_count, data_count);
+        guard_test<types::ticket_lock>("ticket_lock", threads_count, data_count);
+        guard_test<types::mcs_lock>("mcs_lock", threads_count, data_count);
+        guard_test<types::adaptive_mutex>("adaptive_mutex", threads_count, data_count);
+    }
+
+    std::cout << "Finish.\n";
+
+    return 0;
+}
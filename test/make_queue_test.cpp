@@ -0,0 +1,185 @@
+#include <iostream>
+#include <thread>
+#include <atomic>
+#include <cassert>
+#include <memory>
+#include <type_traits>
+#include <vector>
+
+using namespace std;
+
+#include "queue.h"
+#include "ring_queue.h"
+#include "mpsc_queue.h"
+#include "mpmc_queue.h"
+#include "make_queue.h"
+#include "writer.h"
+#include "reader.h"
+
+struct Data
+{
+    Data(int p = 0, int d = 0) : next(nullptr), producer(p), data(d) {}
+
+    Data *next;
+    int producer;
+    int data;
+};
+
+struct AtomicData
+{
+    AtomicData(int p = 0, int d = 0) : next(nullptr), producer(p), data(d) {}
+
+    std::atomic<AtomicData*> next;
+    int producer;
+    int data;
+};
+
+static_assert(std::is_same<types::make_queue<Data, 1, 1>, types::queue<Data>>::value, "1x1 unbounded");
+static_assert(std::is_same<types::make_queue<Data, 1, 1, types::unbounded, types::spin_park_wait<>>,
+                           types::queue<Data, types::cache_aligned_layout, types::spin_park_wait<>>>::value,
+              "1x1 unbounded with wait policy");
+static_assert(std::is_same<types::make_queue<Data*, 1, 1, 1024>, types::ring_queue<Data*, 1024>>::value, "1x1 bounded");
+static_assert(std::is_same<types::make_queue<AtomicData, 4, 1>, types::mpsc_queue<AtomicData>>::value, "Nx1 unbounded");
+static_assert(std::is_same<types::make_queue<int, 4, 1, 64>, types::mpmc_queue<int, 64>>::value, "Nx1 bounded");
+static_assert(std::is_same<types::make_queue<int, 1, 4, 64>, types::mpmc_queue<int, 64>>::value, "1xM bounded");
+static_assert(std::is_same<types::make_queue<int, 4, 4, 64>, types::mpmc_queue<int, 64>>::value, "NxM bounded");
+
+/*
+ * Producers write increasing values through writer wrappers, consumers read them through reader wrappers
+ * and check that values of each producer come in order. Writes to a full bounded queue are repeated.
+ */
+template<class Queue, bool Bounded, class Make, class Value>
+void run_test(const char *name, int producers, int consumers, int data_count, Make make, Value value)
+{
+    std::cout << "    " << name << ": " << producers << "x" << consumers << "\n";
+
+    auto q = std::make_shared<Queue>();
+    std::atomic<int> active(producers);
+    std::atomic<std::uint64_t> consumed(0);
+
+    std::vector<std::thread> threads;
+    for (auto p = 0; p < producers; ++p)
+    {
+        threads.emplace_back([&, p]
+        {
+            types::writer<Queue> w(q);
+            for (auto i = 0; i < data_count; ++i)
+            {
+                auto data = make(p, i);
+                while (!w.write(data) && Bounded)
+                {
+                    std::this_thread::yield();
+                }
+            }
+            if (active.fetch_sub(1) == 1)
+            {
+                w.set_writer_finished();
+            }
+        });
+    }
+
+    for (auto c = 0; c < consumers; ++c)
+    {
+        threads.emplace_back([&]
+        {
+            types::reader<Queue> r(q);
+            std::vector<int> last(producers, -1);
+            std::uint64_t count = 0;
+
+            typename Queue::pointer data;
+            auto read = [&]
+            {
+                if (!r.read(data))
+                {
+                    return false;
+                }
+
+                auto v = value(data);
+                assert(v.second > last[v.first]);
+                assert(consumers > 1 || v.second == last[v.first] + 1);
+                last[v.first] = v.second;
+                count++;
+                return true;
+            };
+
+            while (!r.is_writer_finished())
+            {
+                if (!read())
+                {
+                    std::this_thread::yield();
+                }
+            }
+            while (read())
+            {
+            }
+
+            consumed.fetch_add(count);
+        });
+    }
+
+    for (auto &t : threads)
+    {
+        t.join();
+    }
+
+    assert(consumed.load() == static_cast<std::uint64_t>(producers) * data_count);
+}
+
+/*
+ * Intrusive elements are deleted by the reader.
+ */
+template<class Node>
+std::pair<int, int> take(Node *data)
+{
+    auto v = std::make_pair(data->producer, data->data);
+    delete data;
+    return v;
+}
+
+std::pair<int, int> unpack(int data)
+{
+    return std::make_pair(data >> 24, data & 0xFFFFFF);
+}
+
+int main(int argc, const char* argv[])
+{
+    std::cout << "Start...\n";
+
+    int attempts_count = 1, producers = 3, consumers = 2, data_count = 20000;
+
+    if (argc == 5)
+    {
+        attempts_count = std::stoi(argv[1]);
+        producers      = std::stoi(argv[2]);
+        consumers      = std::stoi(argv[3]);
+        data_count     = std::stoi(argv[4]);
+    }
+    else if (argc != 1)
+    {
+        std::cout << "Usage: ./make_queue_test [<attempts_count:1> <producers:3> <consumers:2> <data_count:20000>]\n";
+        return 0;
+    }
+
+    auto make_data = [](int p, int i) { return new Data(p, i); };
+    auto make_atomic_data = [](int p, int i) { return new AtomicData(p, i); };
+    auto make_int = [](int p, int i) { return (p << 24) | i; };
+
+    for (auto i = 0; i < attempts_count; ++i)
+    {
+        std::cout << "=======================================================\n";
+        std::cout << "  Attempt " << i << "/" << attempts_count << "\n";
+
+        run_test<types::make_queue<Data, 1, 1>, false>("1x1 unbounded", 1, 1, data_count,
+                                                                      make_data, take<Data>);
+        run_test<types::make_queue<int, 1, 1, 64>, true>("1x1 bounded", 1, 1, data_count,
+                                                                        make_int, unpack);
+        run_test<types::make_queue<AtomicData, 8, 1>, false>("Nx1 unbounded", producers, 1, data_count,
+                                                                            make_atomic_data, take<AtomicData>);
+        run_test<types::make_queue<int, 8, 8, 64>, true>("NxM bounded", producers, consumers, data_count,
+                                                                        make_int, unpack);
+    }
+
+    std::cout << "Finish.\n";
+
+    return 0;
+}
@@ -0,0 +1,175 @@
+
+#include <iostream>
+#include <thread>
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <memory>
+#include <vector>
+
+using namespace std;
+
+#include "mpmc_queue.h"
+
+using Queue = types::mpmc_queue<std::uint64_t, 8>;
+
+/*
+ * Full queue rejects values, empty one returns false. Positions wrap around the array many times.
+ */
+void single_thread_test()
+{
+    std::cout << "  Single thread...\n";
+
+    Queue q;
+    std::uint64_t value = 0;
+
+    assert(!q.read(value));
+    for (std::uint64_t i = 0; i < 8; ++i)
+    {
+        assert(q.write(i));
+    }
+    assert(!q.write(100));
+
+    for (std::uint64_t i = 0; i < 8; ++i)
+    {
+        assert(q.read(value) && value == i);
+    }
+    assert(!q.read(value));
+
+    // write and read by 5 so each round starts at a different position of the array
+    std::uint64_t next_write = 0, next_read = 0;
+    for (auto round = 0; round < 100; ++round)
+    {
+        for (auto i = 0; i < 5; ++i)
+        {
+            assert(q.write(next_write++));
+        }
+        for (auto i = 0; i < 5; ++i)
+        {
+            assert(q.read(value) && value == next_read++);
+        }
+        assert(!q.read(value));
+    }
+
+    types::mpmc_queue<std::unique_ptr<int>, 2> uq;
+    assert(uq.write(std::unique_ptr<int>(new int(1))));
+    assert(uq.write(std::unique_ptr<int>(new int(2))));
+    assert(!uq.write(std::unique_ptr<int>(new int(3))));
+    std::unique_ptr<int> u;
+    assert(uq.read(u) && *u == 1);
+    assert(uq.read(u) && *u == 2);
+    assert(!uq.read(u));
+}
+
+/*
+ * Each writer writes increasing values tagged with its index. Each reader checks that values of every writer
+ * come in order. All values are read exactly once: the sum of the read values matches the written ones.
+ */
+void multi_thread_test(int writers, int readers, int data_count)
+{
+    std::cout << "  Multiple threads: " << writers << "x" << readers << "\n";
+
+    auto q = std::make_shared<Queue>();
+    std::atomic<int> running_writers(writers);
+    std::atomic<std::uint64_t> read_count(0), read_sum(0);
+
+    std::vector<std::thread> threads;
+    for (auto w = 0; w < writers; ++w)
+    {
+        threads.emplace_back([&, w]
+        {
+            for (auto i = 0; i < data_count; ++i)
+            {
+                auto value = static_cast<std::uint64_t>(w) << 32 | static_cast<std::uint64_t>(i);
+                while (!q->write(value))
+                {
+                    std::this_thread::yield();
+                }
+            }
+
+            // the last writer finishes the queue
+            if (running_writers.fetch_sub(1) == 1)
+            {
+                q->set_writer_finished();
+            }
+        });
+    }
+
+    for (auto r = 0; r < readers; ++r)
+    {
+        threads.emplace_back([&]
+        {
+            std::vector<std::int64_t> last(writers, -1);
+            std::uint64_t count = 0, sum = 0;
+
+            auto process = [&](std::uint64_t value)
+            {
+                auto w = static_cast<int>(value >> 32);
+                auto i = static_cast<std::int64_t>(value & 0xffffffff);
+                assert(w < writers);
+                assert(i > last[w]);
+                last[w] = i;
+                count++;
+                sum += i;
+            };
+
+            std::uint64_t value = 0;
+            while (!q->is_writer_finished())
+            {
+                if (q->read(value))
+                    process(value);
+                else
+                    std::this_thread::yield();
+            }
+
+            while (q->read(value))
+                process(value);
+
+            read_count.fetch_add(count);
+            read_sum.fetch_add(sum);
+        });
+    }
+
+    for (auto &t : threads)
+        t.join();
+
+    auto n = static_cast<std::uint64_t>(data_count);
+    assert(read_count.load() == writers * n);
+    assert(read_sum.load() == writers * n * (n - 1) / 2);
+}
+
+int main(int argc, const char* argv[])
+{
+    std::cout << "Start...\n";
+
+    int attempts_count = 1, writers = 3, readers = 3, data_count = 20000;
+
+    if (argc == 5)
+    {
+        attempts_count = std::stoi(argv[1]);
+        writers        = std::stoi(argv[2]);
+        readers        = std::stoi(argv[3]);
+        data_count     = std::stoi(argv[4]);
+    }
+    else if (argc != 1)
+    {
+        std::cout << "Usage: ./mpmc_queue_test [<attempts_count:1> <writers:3> <readers:3> <data_count:20000>]\n";
+        return 0;
+    }
+
+    for (auto i = 0; i < attempts_count; ++i)
+    {
+        std::cout << "=======================================================\n";
+        std::cout << "  Attempt " << i << "/" << attempts_count << "\n";
+
+        single_thread_test();
+        multi_thread_test(1, 1, data_count);
+        multi_thread_test(writers, 1, data_count);
+        multi_thread_test(1, readers, data_count);
+        multi_thread_test(writers, readers, data_count);
+    }
+
+    std::cout << "Finish.\n";
+
+    return 0;
+}
@@ -0,0 +1,168 @@
+#include <iostream>
+#include <thread>
+#include <atomic>
+#include <cassert>
+#include <memory>
+#include <vector>
+
+using namespace std;
+
+#include "mpsc_queue.h"
+#include "writer.h"
+#include "reader.h"
+
+struct Data
+{
+    Data(int p, int d) : next(nullptr), producer(p), data(d) {}
+
+    std::atomic<Data*> next;
+    int producer;
+    int data;
+};
+
+using Queue = types::mpsc_queue<Data>;
+
+void single_thread_test()
+{
+    std::cout << "    single thread\n";
+
+    Queue q;
+    Data *d = nullptr;
+
+    assert(!q.read(d));
+    assert(q.read_all() == nullptr);
+
+    assert(q.write(new Data(0, 0)));
+    assert(!q.write(new Data(0, 1)));
+
+    assert(q.read(d) && d->data == 0);
+    delete d;
+    assert(q.read(d) && d->data == 1);
+    delete d;
+    assert(!q.read(d));
+
+    // queue is empty again
+    assert(q.write(new Data(0, 2)));
+
+    auto first = new Data(0, 3), last = new Data(0, 4);
+    first->next = last;
+    assert(!q.write_batch(first, last));
+
+    int expected = 2;
+    assert(q.drain([&](Data *d) { assert(d->data == expected++); delete d; }) == 3);
+    assert(!q.read(d));
+
+    // remaining elements are deleted by the destructor
+    q.write(new Data(0, 5));
+}
+
+/*
+ * Producers share one writer wrapper and write increasing values. Consumer checks that values of each
+ * producer come in order and all the values are read.
+ */
+void multi_thread_test(int producers, int data_count, bool batches)
+{
+    std::cout << "    " << producers << " producers" << (batches ? ", read_all" : "") << "\n";
+
+    auto q = std::make_shared<Queue>();
+    types::writer<Queue> w(q);
+    types::reader<Queue> r(q);
+
+    std::atomic<int> active(producers);
+
+    std::vector<std::thread> threads;
+    for (auto p = 0; p < producers; ++p)
+    {
+        threads.emplace_back([&, p]
+        {
+            for (auto i = 0; i < data_count; ++i)
+            {
+                w.write(new Data(p, i));
+            }
+            if (active.fetch_sub(1) == 1)
+            {
+                w.set_writer_finished();
+            }
+        });
+    }
+
+    std::vector<int> last(producers, -1);
+    std::uint64_t count = 0;
+
+    auto process = [&](Data *d)
+    {
+        assert(d->data == last[d->producer] + 1);
+        last[d->producer] = d->data;
+        count++;
+        delete d;
+    };
+
+    auto poll = [&]
+    {
+        if (batches)
+        {
+            return r.drain(process) != 0;
+        }
+
+        Data *d = nullptr;
+        if (!r.read(d))
+        {
+            return false;
+        }
+        process(d);
+        return true;
+    };
+
+    while (!r.is_writer_finished())
+    {
+        if (!poll())
+        {
+            std::this_thread::yield();
+        }
+    }
+
+    while (poll())
+    {
+    }
+
+    for (auto &t : threads)
+    {
+        t.join();
+    }
+
+    assert(count == static_cast<std::uint64_t>(producers) * data_count);
+}
+
+int main(int argc, const char* argv[])
+{
+    std::cout << "Start...\n";
+
+    int attempts_count = 1, producers = 4, data_count = 100000;
+
+    if (argc == 4)
+    {
+        attempts_count = std::stoi(argv[1]);
+        producers      = std::stoi(argv[2]);
+        data_count     = std::stoi(argv[3]);
+    }
+    else if (argc != 1)
+    {
+        std::cout << "Usage: ./mpsc_queue_test [<attempts_count:1> <producers:4> <data_count:100000>]\n";
+        return 0;
+    }
+
+    for (auto i = 0; i < attempts_count; ++i)
+    {
+        std::cout << "=======================================================\n";
+        std::cout << "  Attempt " << i << "/" << attempts_count << "\n";
+
+        single_thread_test();
+        multi_thread_test(1, data_count, false);
+        multi_thread_test(producers, data_count, false);
+        multi_thread_test(producers, data_count, true);
+    }
+
+    std::cout << "Finish.\n";
+
+    return 0;
+}
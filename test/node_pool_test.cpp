@@ -0,0 +1,161 @@
+
+#include <iostream>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <cassert>
+#include <memory>
+
+using namespace std;
+
+#include "queue.h"
+#include "node_pool.h"
+
+struct Data
+{
+    Data(int d) : next(nullptr), data(d) {}
+
+    Data *next;
+    int data;
+};
+
+using Queue = types::queue<Data>;
+using Pool  = types::node_pool<Data>;
+
+void writer_thread(std::shared_ptr<Queue> q, Pool &pool, int n)
+{
+    std::cout << "    Writer start...\n";
+
+    for (auto i = 0; i < n; ++i)
+    {
+        q->write(pool.allocate(i));
+
+        if (i % 64 == 0)
+            std::this_thread::yield();
+    }
+
+    q->set_writer_finished();
+
+    std::cout << "    Writer finish.\n";
+}
+
+void reader_thread(std::shared_ptr<Queue> q, Pool &pool, int n)
+{
+    std::cout << "    Reader start...\n";
+
+    Pool::return_batch batch(pool);
+    int expected = 0;
+
+    auto process = [&](Data *d)
+    {
+        assert(d->data == expected);
+        expected++;
+
+        batch.deallocate(d);
+    };
+
+    while (!q->is_writer_finished())
+    {
+        if (q->drain(process) == 0)
+            std::this_thread::yield();
+    }
+
+    std::cout << "    Reading tail...\n";
+
+    while (q->drain(process) > 0)
+    {
+    }
+
+    assert(expected == n);
+
+    std::cout << "    Reader finish: " << expected << " records.\n";
+}
+
+/*
+ * Queue returns remaining nodes to the pool with clear() instead of deleting them.
+ */
+void clear_test()
+{
+    std::cout << "  Clear...\n";
+
+    Pool pool(8, 8);
+    {
+        Queue q(Queue::flush_policy::on_idle());
+        for (auto i = 0; i < 6; ++i)
+        {
+            q.write(pool.allocate(i));
+            if (i % 2 == 1)
+            {
+                q.flush(); // 0 and 1 are given to the reader, 2 and 3 stay in writer's queue, 4 and 5 are pending
+            }
+            if (i == 3)
+            {
+                Data *d = nullptr;
+                assert(q.read(d) && d->data == 0);
+                pool.deallocate(d);
+            }
+        }
+        q.write(pool.allocate(6)); // pending too
+
+        assert(q.clear([&](Data *d) { pool.deallocate(d); }) == 6);
+
+        Data *d = nullptr;
+        assert(!q.read(d));
+    }
+
+    Data *nodes[8];
+    for (auto &n : nodes)
+    {
+        n = pool.allocate(0);
+    }
+    assert(pool.get_stats().slabs == 1);
+    for (auto n : nodes)
+    {
+        pool.deallocate(n);
+    }
+}
+
+int main(int argc, const char* argv[])
+{
+    std::cout << "Start...\n";
+
+    int attempts_count = 1, data_count = 100000, prealloc_count = 1024;
+
+    if (argc == 4)
+    {
+        attempts_count = std::stoi(argv[1]);
+        data_count     = std::stoi(argv[2]);
+        prealloc_count = std::stoi(argv[3]);
+    }
+    else if (argc != 1)
+    {
+        std::cout << "Usage: ./node_pool_test [<attempts_count:1> <data_count:100000> <prealloc_count:1024>]\n";
+        return 0;
+    }
+
+    for (auto i = 0; i < attempts_count; ++i)
+    {
+        std::cout << "=======================================================\n";
+        std::cout << "  Attempt " << i << "/" << attempts_count << "\n";
+
+        clear_test();
+
+        Pool pool(prealloc_count);
+        {
+            auto q = std::make_shared<Queue>();
+            std::thread wt(writer_thread, q, std::ref(pool), data_count);
+            std::thread rt(reader_thread, q, std::ref(pool), data_count);
+
+            wt.join();
+            rt.join();
+        }
+
+        auto &stats = pool.get_stats();
+        std::cout << "  Pool: " << stats.hits << " hits, " << stats.misses << " misses, "
+                  << stats.slabs << " slabs, " << stats.nodes << " nodes\n";
+    }
+
+    std::cout << "Finish.\n";
+
+    return 0;
+}
@@ -0,0 +1,309 @@
+#include <iostream>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <cassert>
+#include <memory>
+#include <vector>
+
+using namespace std;
+
+#include "queue.h"
+#include "writer.h"
+
+struct Data
+{
+    Data(int d = 0) : next(nullptr), data(d) { alive++; }
+    ~Data() { alive--; }
+
+    Data *next;
+    int data;
+
+    static std::atomic<int> alive;
+};
+
+std::atomic<int> Data::alive(0);
+
+using Queue = types::queue<Data, types::cache_aligned_layout, types::busy_spin_wait, types::counting_stats>;
+using capacity = Queue::capacity_policy;
+using overflow = Queue::overflow_policy;
+using result   = Queue::write_result;
+
+/*
+ * Full queue rejects or drops elements according to the overflow policy.
+ */
+void single_thread_test()
+{
+    std::cout << "  Single thread...\n";
+
+    Data *out    = nullptr;
+    auto destroy = [](Data *d) { delete d; };
+
+    {
+        Queue q(capacity::bounded(3));
+        Data extra(100);
+
+        for (auto i = 0; i < 3; ++i)
+        {
+            assert(q.try_write(new Data(i)) == result::written);
+        }
+        assert(q.depth() == 3);
+        assert(q.try_write(&extra) == result::rejected);
+        assert(!q.write_for(&extra, std::chrono::microseconds(100)));
+
+        assert(q.read(out) && out->data == 0);
+        delete out;
+        assert(q.try_write(new Data(3)) == result::written);
+        assert(q.try_write(&extra) == result::rejected);
+
+        assert(q.drain([](Data *d) { delete d; }) == 3);
+        assert(q.depth() == 0);
+        assert(q.try_write(new Data(4)) == result::written);
+    }
+    assert(Data::alive == 0);
+
+    {
+        Queue q(capacity::bounded(2, overflow::drop_newest));
+        assert(q.try_write(new Data(0), destroy) == result::written);
+        assert(q.try_write(new Data(1), destroy) == result::written);
+        assert(q.try_write(new Data(2), destroy) == result::dropped);
+        assert(Data::alive == 2);
+        assert(q.snapshot().drops == 1);
+
+        assert(q.read(out) && out->data == 0);
+        delete out;
+        assert(q.read(out) && out->data == 1);
+        delete out;
+        assert(!q.read(out));
+    }
+    assert(Data::alive == 0);
+
+    {
+        // first element is given to the reader and can't be dropped, the next ones are in writer's queue
+        Queue q(capacity::bounded(3, overflow::drop_oldest));
+        for (auto i = 0; i < 6; ++i)
+        {
+            assert(q.try_write(new Data(i), destroy) == result::written);
+        }
+        assert(Data::alive == 3);
+        assert(q.depth() == 3);
+        assert(q.snapshot().drops == 3);
+
+        int expected[] = {0, 4, 5};
+        for (auto e : expected)
+        {
+            assert(q.read(out) && out->data == e);
+            delete out;
+        }
+        assert(!q.read(out));
+    }
+    assert(Data::alive == 0);
+
+    {
+        // pending elements are dropped when the whole writer's queue belongs to the reader
+        Queue q(Queue::flush_policy::on_idle(), capacity::bounded(2, overflow::drop_oldest));
+        assert(q.try_write(new Data(0), destroy) == result::written);
+        assert(q.try_write(new Data(1), destroy) == result::written);
+        assert(q.try_write(new Data(2), destroy) == result::written);
+        assert(Data::alive == 2);
+
+        q.flush();
+        assert(q.read(out) && out->data == 1);
+        delete out;
+        assert(q.read(out) && out->data == 2);
+        delete out;
+    }
+    assert(Data::alive == 0);
+
+    {
+        // dropped pending elements were never counted as written
+        Queue q(Queue::flush_policy::after_items(100), capacity::bounded(2, overflow::drop_oldest));
+        assert(q.try_write(new Data(0), destroy) == result::written);
+        q.flush();
+        assert(q.read(out) && out->data == 0);
+        delete out;
+        for (auto i = 1; i <= 5; ++i)
+        {
+            assert(q.try_write(new Data(i), destroy) == result::written);
+        }
+        q.flush();
+
+        auto stats = q.snapshot();
+        assert(stats.writes == 3);
+        assert(stats.drops == 3);
+        assert(stats.max_depth == 2);
+        assert(q.drain([](Data *d) { delete d; }) == 2);
+    }
+    assert(Data::alive == 0);
+
+    {
+        // pending elements are passed to the reader when the queue is full, otherwise it never gets room
+        Queue q(Queue::flush_policy::after_items(8), capacity::bounded(4));
+        Data extra(100);
+        for (auto i = 0; i < 4; ++i)
+        {
+            assert(q.try_write(new Data(i)) == result::written);
+        }
+        assert(!q.read(out));
+        assert(q.try_write(&extra) == result::rejected);
+        assert(q.read(out) && out->data == 0);
+        delete out;
+        assert(q.write_for(new Data(4), std::chrono::microseconds(100)));
+        assert(!q.write_for(&extra, std::chrono::microseconds(100)));
+        assert(q.drain([](Data *d) { delete d; }) == 3);
+        q.flush();
+        assert(q.drain([](Data *d) { delete d; }) == 1);
+    }
+    assert(Data::alive == 0);
+
+    {
+        // dropped elements are passed to the disposer instead of being deleted
+        Data pool[4] = {0, 1, 2, 3};
+        std::vector<int> disposed;
+        auto dispose = [&disposed](Data *d) { disposed.push_back(d->data); };
+
+        Queue q(capacity::bounded(2, overflow::drop_oldest));
+        for (auto &d : pool)
+        {
+            assert(q.try_write(&d, dispose) == result::written);
+        }
+        assert((disposed == std::vector<int>{1, 2}));
+        assert(q.read(out) && out == &pool[0]);
+        assert(q.read(out) && out == &pool[3]);
+        assert(!q.read(out));
+
+        Queue q2(capacity::bounded(1, overflow::drop_newest));
+        assert(q2.try_write(&pool[0], dispose) == result::written);
+        assert(q2.try_write(&pool[1], dispose) == result::dropped);
+        assert((disposed == std::vector<int>{1, 2, 1}));
+        assert(q2.read(out) && out == &pool[0]);
+    }
+    assert(Data::alive == 0);
+
+    {
+        // elements taken by the reader can't be dropped
+        Queue q(capacity::bounded(1, overflow::drop_oldest));
+        assert(q.try_write(new Data(0), destroy) == result::written);
+        assert(q.try_write(new Data(1), destroy) == result::dropped);
+        assert(q.read(out) && out->data == 0);
+        delete out;
+    }
+    assert(Data::alive == 0);
+}
+
+/*
+ * Writer is faster than the reader. Queue never grows above its capacity and lossless writers keep the order.
+ */
+void multi_thread_test(const char *name, overflow policy, bool blocking, int data_count, std::size_t max_items,
+                       Queue::flush_policy flush = Queue::flush_policy::immediate())
+{
+    std::cout << "  " << name << "...\n";
+
+    auto q = std::make_shared<Queue>(flush, capacity::bounded(max_items, policy));
+    types::writer<Queue> w(q);
+
+    std::atomic<std::size_t> max_depth(0);
+
+    std::thread wt([&]
+    {
+        for (auto i = 0; i < data_count; ++i)
+        {
+            auto d = new Data(i);
+            if (blocking)
+            {
+                while (!w.write_for(d, std::chrono::milliseconds(1)))
+                {
+                }
+            }
+            else if (w.try_write(d, [](Data *e) { delete e; }) == result::rejected)
+            {
+                delete d;
+            }
+
+            auto depth = q->depth();
+            assert(depth <= max_items);
+            if (depth > max_depth)
+            {
+                max_depth = depth;
+            }
+        }
+        w.set_writer_finished();
+    });
+
+    int read = 0, last = -1;
+    Data *d = nullptr;
+    while (!q->is_writer_finished() || q->read(d))
+    {
+        if (d != nullptr || q->read(d))
+        {
+            assert(d->data > last);
+            assert(!blocking || d->data == last + 1);
+            last = d->data;
+            read++;
+
+            delete d;
+            d = nullptr;
+
+            if (read % 64 == 0)
+            {
+                std::this_thread::sleep_for(std::chrono::microseconds(10));
+            }
+        }
+        else
+        {
+            std::this_thread::yield(); // batched writer passes elements only when the queue is full
+        }
+    }
+
+    wt.join();
+
+    auto stats = q->snapshot();
+    assert(!blocking || read == data_count);
+    assert(read + stats.drops == std::uint64_t(data_count) || policy == overflow::reject);
+    assert(Data::alive == 0);
+
+    std::cout << "      " << read << " read, " << stats.drops << " dropped, max depth " << max_depth << "\n";
+}
+
+int main(int argc, const char* argv[])
+{
+    std::cout << "Start...\n";
+
+    int attempts_count = 1, data_count = 100000;
+
+    if (argc == 3)
+    {
+        attempts_count = std::stoi(argv[1]);
+        data_count     = std::stoi(argv[2]);
+    }
+    else if (argc != 1)
+    {
+        std::cout << "Usage: ./queue_capacity_test [<attempts_count:1> <data_count:100000>]\n";
+        return 0;
+    }
+
+    for (auto i = 0; i < attempts_count; ++i)
+    {
+        std::cout << "=======================================================\n";
+        std::cout << "  Attempt " << i << "/" << attempts_count << "\n";
+
+        single_thread_test();
+
+        multi_thread_test("write_for", overflow::reject, true, data_count, 64);
+        multi_thread_test("reject", overflow::reject, false, data_count, 64);
+        multi_thread_test("drop_newest", overflow::drop_newest, false, data_count, 64);
+        multi_thread_test("drop_oldest", overflow::drop_oldest, false, data_count, 64);
+
+        // flush threshold above the capacity
+        multi_thread_test("write_for, batched", overflow::reject, true, data_count, 4,
+                          Queue::flush_policy::after_items(8));
+        multi_thread_test("reject, batched", overflow::reject, false, data_count, 4,
+                          Queue::flush_policy::after_items(8));
+        multi_thread_test("drop_oldest, batched", overflow::drop_oldest, false, data_count, 4,
+                          Queue::flush_policy::after_items(8));
+    }
+
+    std::cout << "Finish.\n";
+
+    return 0;
+}
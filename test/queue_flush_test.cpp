@@ -0,0 +1,158 @@
+
+#include <iostream>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <cassert>
+#include <memory>
+
+using namespace std;
+
+#include "queue.h"
+
+struct Data
+{
+    Data(int d = 0) : next(nullptr), data(d) {}
+
+    Data *next;
+    int data;
+};
+
+using Queue = types::queue<Data>;
+
+/*
+ * Pending elements are not visible to the reader until flush policy passes them.
+ */
+void single_thread_test()
+{
+    std::cout << "  Single thread...\n";
+
+    Data d[8];
+    Data *out = nullptr;
+
+    {
+        Queue q(Queue::flush_policy::after_items(3));
+        assert(!q.write(&d[0]));
+        assert(!q.write(&d[1]));
+        assert(!q.read(out));
+        assert(q.write(&d[2]));
+        assert(q.read(out) && out == &d[0]);
+
+        d[3].next = &d[4];
+        assert(!q.write_batch(&d[3], &d[4]));
+        assert(!q.flush_if_due());
+        assert(!q.flush()); // reader still has elements so they are left in writer's queue
+        assert(q.drain([](Data*) {}) == 2);
+        assert(q.drain([](Data*) {}) == 2);
+        assert(!q.read(out));
+    }
+
+    {
+        Queue q(Queue::flush_policy::on_idle());
+        for (auto i = 0; i < 8; ++i)
+        {
+            assert(!q.write(&d[i]));
+        }
+        assert(!q.flush_if_due());
+        assert(!q.read(out));
+
+        q.set_writer_finished(); // flushes pending elements
+        for (auto i = 0; i < 8; ++i)
+        {
+            assert(q.read(out) && out == &d[i]);
+        }
+        assert(!q.read(out));
+    }
+
+    {
+        Queue q(Queue::flush_policy::after_delay(std::chrono::microseconds(1000)));
+        assert(!q.write(&d[0]));
+        assert(!q.flush_if_due());
+        std::this_thread::sleep_for(std::chrono::milliseconds(2));
+        assert(q.flush_if_due());
+        assert(q.read(out) && out == &d[0]);
+
+        q.set_flush_policy(Queue::flush_policy::immediate());
+        assert(q.write(&d[1]));
+        assert(q.read(out) && out == &d[1]);
+    }
+}
+
+/*
+ * Writer writes bursts and flushes pending elements with flush_if_due() while it is idle.
+ */
+void multi_thread_test(int n, std::size_t max_items, int max_delay)
+{
+    std::cout << "  Multiple threads: max_items=" << max_items << ", max_delay=" << max_delay << "us...\n";
+
+    auto q = std::make_shared<Queue>(Queue::flush_policy(max_items, std::chrono::microseconds(max_delay)));
+
+    std::thread wt([q, n]
+    {
+        for (auto i = 0; i < n; ++i)
+        {
+            q->write(new Data(i));
+
+            if (i % 100 == 99)
+            {
+                auto idle_until = std::chrono::steady_clock::now() + std::chrono::microseconds(200);
+                while (std::chrono::steady_clock::now() < idle_until)
+                {
+                    q->flush_if_due();
+                    std::this_thread::yield();
+                }
+            }
+        }
+        q->set_writer_finished();
+    });
+
+    std::thread rt([q, n]
+    {
+        int expected = 0;
+        Data *d = nullptr;
+        while (q->read_wait(d))
+        {
+            assert(d->data == expected);
+            expected++;
+            delete d;
+        }
+        assert(expected == n);
+    });
+
+    wt.join();
+    rt.join();
+}
+
+int main(int argc, const char* argv[])
+{
+    std::cout << "Start...\n";
+
+    int attempts_count = 1, data_count = 10000;
+
+    if (argc == 3)
+    {
+        attempts_count = std::stoi(argv[1]);
+        data_count     = std::stoi(argv[2]);
+    }
+    else if (argc != 1)
+    {
+        std::cout << "Usage: ./queue_flush_test [<attempts_count:1> <data_count:10000>]\n";
+        return 0;
+    }
+
+    for (auto i = 0; i < attempts_count; ++i)
+    {
+        std::cout << "=======================================================\n";
+        std::cout << "  Attempt " << i << "/" << attempts_count << "\n";
+
+        single_thread_test();
+        multi_thread_test(data_count, 1, 0);
+        multi_thread_test(data_count, 32, 0);
+        multi_thread_test(data_count, 32, 50);
+        multi_thread_test(data_count, SIZE_MAX, 50);
+    }
+
+    std::cout << "Finish.\n";
+
+    return 0;
+}
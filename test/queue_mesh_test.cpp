@@ -0,0 +1,147 @@
+
+#include <iostream>
+#include <thread>
+#include <atomic>
+#include <cassert>
+#include <memory>
+#include <mutex>
+#include <vector>
+
+using namespace std;
+
+#include "queue.h"
+#include "queue_mesh.h"
+
+struct Data
+{
+    Data(int p, int c, int d) : next(nullptr), producer(p), consumer(c), data(d) {}
+
+    Data *next;
+    int producer;
+    int consumer; // lane's consumer
+    int data;
+};
+
+using Mesh = types::queue_mesh<Data>;
+
+/*
+ * Producers write increasing values. Each consumer checks that values of each lane come in order
+ * and all the values are read.
+ */
+void mesh_test(const char *name, int producers, int consumers, Mesh::polling mode, bool stealing, int n)
+{
+    std::cout << "    " << name << ": " << producers << "x" << consumers << "\n";
+
+    Mesh mesh(producers, consumers, mode, stealing);
+    std::atomic<std::uint64_t> consumed(0);
+
+    std::vector<std::thread> threads;
+    for (auto p = 0; p < producers; ++p)
+    {
+        threads.emplace_back([&, p]
+        {
+            for (auto i = 0; i < n; ++i)
+            {
+                auto c = static_cast<int>(i % consumers);
+                mesh.write_to(p, c, new Data(p, c, i));
+            }
+            mesh.set_writer_finished(p);
+        });
+    }
+
+    for (auto c = 0; c < consumers; ++c)
+    {
+        threads.emplace_back([&, c]
+        {
+            // last value of each lane seen by this consumer
+            std::vector<int> last(producers * consumers, -1);
+            std::uint64_t count = 0;
+
+            auto process = [&](Data *d)
+            {
+                auto &l = last[d->producer * consumers + d->consumer];
+                assert(d->data > l);
+                assert(stealing || d->consumer == c);
+                l = d->data;
+                count++;
+                delete d;
+            };
+
+            Data *d = nullptr;
+            while (!mesh.is_writer_finished())
+            {
+                if (mesh.read(c, d))
+                    process(d);
+                else
+                    std::this_thread::yield();
+            }
+
+            while (mesh.read(c, d))
+                process(d);
+
+            consumed.fetch_add(count);
+        });
+    }
+
+    for (auto &t : threads)
+        t.join();
+
+    assert(consumed.load() == static_cast<std::uint64_t>(producers) * n);
+}
+
+void round_robin_write_test()
+{
+    std::cout << "    write() round-robin\n";
+
+    Mesh mesh(1, 3);
+    for (auto i = 0; i < 6; ++i)
+        mesh.write(0, new Data(0, i % 3, i));
+
+    for (auto c = 0; c < 3; ++c)
+    {
+        Data *d = nullptr;
+        for (auto i = 0; i < 2; ++i)
+        {
+            assert(mesh.read(c, d));
+            assert(d->data % 3 == c);
+            delete d;
+        }
+        assert(!mesh.read(c, d));
+    }
+}
+
+int main(int argc, const char* argv[])
+{
+    std::cout << "Start...\n";
+
+    int attempts_count = 1, producers = 4, consumers = 3, data_count = 20000;
+
+    if (argc == 5)
+    {
+        attempts_count = std::stoi(argv[1]);
+        producers      = std::stoi(argv[2]);
+        consumers      = std::stoi(argv[3]);
+        data_count     = std::stoi(argv[4]);
+    }
+    else if (argc != 1)
+    {
+        std::cout << "Usage: ./queue_mesh_test [<attempts_count:1> <producers:4> <consumers:3> <data_count:20000>]\n";
+        return 0;
+    }
+
+    for (auto i = 0; i < attempts_count; ++i)
+    {
+        std::cout << "=======================================================\n";
+        std::cout << "  Attempt " << i << "/" << attempts_count << "\n";
+
+        round_robin_write_test();
+        mesh_test("round_robin", producers, consumers, Mesh::polling::round_robin, false, data_count);
+        mesh_test("by_depth", producers, consumers, Mesh::polling::by_depth, false, data_count);
+        mesh_test("round_robin + stealing", producers, consumers, Mesh::polling::round_robin, true, data_count);
+        mesh_test("by_depth + stealing", producers, consumers, Mesh::polling::by_depth, true, data_count);
+    }
+
+    std::cout << "Finish.\n";
+
+    return 0;
+}
@@ -81,9 +81,20 @@ void reader_thread(int index, GuardedReader<Queue> &q, int max_sleep)
     std::uniform_int_distribution<> dis(0, max_sleep);
 
     Data *d = nullptr;
-    while (!q->is_writer_finished())
+    for (;;)
     {
-        if (q->read(d))
+        bool finished = false, has_data = false;
+        {
+            // check and read under one lock
+            auto r = q.lock();
+            finished = r->is_writer_finished();
+            has_data = !finished && r->read(d);
+        }
+
+        if (finished)
+            break;
+
+        if (has_data)
         {
             if (d != nullptr)
             {
@@ -107,21 +118,17 @@ void reader_thread(int index, GuardedReader<Queue> &q, int max_sleep)
     std::cout << "    [" << index << "] Reading tail...\n";
     std::cout.flush();
 
-    while (q->read(d))
+    // drain many items per lock acquisition
+    while (q.with([&](Reader<Queue> &r)
     {
-        if (d != nullptr)
+        return r.drain([&](Data *d)
         {
             std::cout << "      [" << index << "] = " << d->data << "\n";
-            std::cout.flush();
-
             delete d;
-            d = nullptr;
-        }
-        else
-        {
-            std::cout << "      = E\n";
-            std::cout.flush();
-        }
+        });
+    }) > 0)
+    {
+        std::cout.flush();
 
         std::chrono::milliseconds ms(dis(gen));
         std::this_thread::sleep_for(ms);
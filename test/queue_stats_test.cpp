@@ -0,0 +1,210 @@
+
+#include <iostream>
+#include <thread>
+#include <atomic>
+#include <cassert>
+#include <memory>
+#include <vector>
+
+using namespace std;
+
+#include "queue.h"
+#include "LockFreeQueue.h"
+
+struct Data
+{
+    Data(int d = 0) : next(nullptr), data(d) {}
+
+    Data *next;
+    int data;
+};
+
+using Queue = types::queue<Data, types::cache_aligned_layout, types::busy_spin_wait, types::counting_stats>;
+
+// Disabled statistics must not change the size of the queue: 3 pointers and the finished flag.
+static_assert(sizeof(LockFreeQueue<Data>) == 4 * sizeof(void *), "no_stats must not add padding to LockFreeQueue");
+
+void print_stats(const types::queue_stats &s)
+{
+    std::cout << "    writes=" << s.writes << " reads=" << s.reads << " empty_reads=" << s.empty_reads
+              << " handoffs=" << s.handoffs << " avg_handoff=" << s.average_handoff_items()
+              << " max_handoff=" << s.max_handoff_items << " max_depth=" << s.max_depth << "\n";
+}
+
+/*
+ * Counters in one thread are exact.
+ */
+void single_thread_test()
+{
+    std::cout << "  Single thread...\n";
+
+    Queue q;
+    Data d[5];
+    Data *out = nullptr;
+
+    assert(!q.read(out));
+
+    assert(q.write(&d[0]));  // reader is empty, handoff of 1 element
+    assert(!q.write(&d[1])); // reader has data
+    d[2].next = &d[3];
+    assert(!q.write_batch(&d[2], &d[3]));
+
+    assert(q.read(out) && out == &d[0]);
+    assert(q.write(&d[4])); // handoff of 4 elements
+
+    auto n = q.drain([](Data*) {});
+    assert(n == 4);
+    assert(q.read_all() == nullptr);
+
+    auto s = q.snapshot();
+    print_stats(s);
+
+    assert(s.writes == 5);
+    assert(s.reads == 5);
+    assert(s.empty_reads == 2);
+    assert(s.handoffs == 2);
+    assert(s.handoff_items == 5);
+    assert(s.max_handoff_items == 4);
+    assert(s.max_depth == 4);
+
+    LockFreeQueue<Data, types::counting_stats> lfq;
+    assert(lfq.Write(&d[0]));
+    assert(!lfq.Write(&d[1]));
+    assert(lfq.Read(out) && out == &d[0]);
+    assert(!lfq.Read(out));
+    assert(lfq.Flush());
+    assert(lfq.Read(out) && out == &d[1]);
+
+    s = lfq.Snapshot();
+    print_stats(s);
+
+    assert(s.writes == 2);
+    assert(s.reads == 2);
+    assert(s.empty_reads == 1);
+    assert(s.handoffs == 2);
+    assert(s.handoff_items == 2);
+}
+
+/*
+ * Writer fills the queue while reader doesn't read. Depth is sampled on each write, not only at handoffs.
+ */
+void stalled_reader_test(int n)
+{
+    std::cout << "  Stalled reader...\n";
+
+    Queue q;
+    std::vector<Data> d(n);
+    Data *out = nullptr;
+
+    for (auto &e : d)
+    {
+        q.write(&e);
+    }
+
+    auto s = q.snapshot();
+    print_stats(s);
+    assert(s.handoffs == 1);
+    assert(s.max_depth == static_cast<std::uint64_t>(n));
+
+    for (auto i = 0; i < n; ++i)
+    {
+        assert(q.read(out) && out == &d[i]);
+    }
+    assert(!q.read(out));
+    assert(q.snapshot().max_depth == static_cast<std::uint64_t>(n));
+
+    // LockFreeQueue samples the depth on each write too
+    LockFreeQueue<Data, types::counting_stats> lfq;
+    for (auto i = 0; i < n; ++i)
+    {
+        lfq.Write(&d[i]);
+    }
+    s = lfq.Snapshot();
+    assert(s.max_depth == static_cast<std::uint64_t>(n));
+}
+
+/*
+ * Counters are read by another thread while writer and reader are working.
+ */
+void multi_thread_test(int n)
+{
+    std::cout << "  Multiple threads...\n";
+
+    auto q = std::make_shared<Queue>();
+    std::atomic<bool> done(false);
+
+    std::thread wt([q, n]
+    {
+        for (auto i = 0; i < n; ++i)
+            q->write(new Data(i));
+        q->set_writer_finished();
+    });
+
+    std::thread rt([q, n]
+    {
+        int expected = 0;
+        Data *d = nullptr;
+        while (q->read_wait(d))
+        {
+            assert(d->data == expected);
+            expected++;
+            delete d;
+        }
+        assert(expected == n);
+    });
+
+    std::thread st([q, n, &done]
+    {
+        while (!done.load())
+        {
+            auto s = q->snapshot();
+            assert(s.max_handoff_items <= static_cast<std::uint64_t>(n));
+            std::this_thread::yield();
+        }
+    });
+
+    wt.join();
+    rt.join();
+    done.store(true);
+    st.join();
+
+    auto s = q->snapshot();
+    print_stats(s);
+
+    assert(s.writes == static_cast<std::uint64_t>(n));
+    assert(s.reads == static_cast<std::uint64_t>(n));
+    assert(s.handoffs > 0);
+    assert(s.max_depth <= s.writes);
+}
+
+int main(int argc, const char* argv[])
+{
+    std::cout << "Start...\n";
+
+    int attempts_count = 1, data_count = 100000;
+
+    if (argc == 3)
+    {
+        attempts_count = std::stoi(argv[1]);
+        data_count     = std::stoi(argv[2]);
+    }
+    else if (argc != 1)
+    {
+        std::cout << "Usage: ./queue_stats_test [<attempts_count:1> <data_count:100000>]\n";
+        return 0;
+    }
+
+    for (auto i = 0; i < attempts_count; ++i)
+    {
+        std::cout << "=======================================================\n";
+        std::cout << "  Attempt " << i << "/" << attempts_count << "\n";
+
+        single_thread_test();
+        stalled_reader_test(1000);
+        multi_thread_test(data_count);
+    }
+
+    std::cout << "Finish.\n";
+
+    return 0;
+}
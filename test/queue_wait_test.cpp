@@ -0,0 +1,125 @@
+
+#include <iostream>
+#include <chrono>
+#include <thread>
+#include <atomic>
+#include <cassert>
+#include <random>
+#include <memory>
+
+using namespace std;
+
+#include "queue.h"
+
+struct Data
+{
+    Data(int d) : next(nullptr), data(d) {}
+
+    Data *next;
+    int data;
+};
+
+std::random_device rd;
+std::mt19937 gen(rd());
+
+template<class Queue>
+void writer_thread(std::shared_ptr<Queue> q, int n, int max_sleep)
+{
+    std::uniform_int_distribution<> dis(0, max_sleep);
+
+    for (auto i = 0; i < n; ++i)
+    {
+        q->write(new Data(i));
+
+        std::chrono::microseconds us(dis(gen));
+        std::this_thread::sleep_for(us);
+    }
+
+    q->set_writer_finished();
+}
+
+template<class Queue>
+void reader_thread(std::shared_ptr<Queue> q, int n, int timeout)
+{
+    int expected = 0, timeouts = 0;
+
+    Data *d = nullptr;
+    while (!q->is_writer_finished())
+    {
+        if (q->read_for(d, std::chrono::microseconds(timeout)))
+        {
+            assert(d->data == expected);
+            expected++;
+
+            delete d;
+        }
+        else
+        {
+            timeouts++;
+        }
+    }
+
+    while (q->read_wait(d))
+    {
+        assert(d->data == expected);
+        expected++;
+
+        delete d;
+    }
+
+    assert(expected == n);
+
+    std::cout << "      " << expected << " records, " << timeouts << " timeouts\n";
+}
+
+template<class Wait>
+void run(const char *name, int data_count, int w_max_sleep, int r_timeout)
+{
+    using Queue = types::queue<Data, types::cache_aligned_layout, Wait>;
+
+    std::cout << "    " << name << "\n";
+
+    auto q = std::make_shared<Queue>();
+    std::thread wt(writer_thread<Queue>, q, data_count, w_max_sleep);
+    std::thread rt(reader_thread<Queue>, q, data_count, r_timeout);
+
+    wt.join();
+    rt.join();
+}
+
+int main(int argc, const char* argv[])
+{
+    std::cout << "Start...\n";
+
+    int attempts_count = 1, data_count = 1000, w_max_sleep = 200, r_timeout = 100;
+
+    if (argc == 5)
+    {
+        attempts_count = std::stoi(argv[1]);
+        data_count     = std::stoi(argv[2]);
+        w_max_sleep    = std::stoi(argv[3]);
+        r_timeout      = std::stoi(argv[4]);
+    }
+    else if (argc != 1)
+    {
+        std::cout << "Usage: ./queue_wait_test [<attempts_count:1> <data_count:1000> <writer_max_sleep_us:200> <reader_timeout_us:100>]\n";
+        return 0;
+    }
+
+    for (auto i = 0; i < attempts_count; ++i)
+    {
+        std::cout << "=======================================================\n";
+        std::cout << "  Attempt " << i << "/" << attempts_count << "\n";
+
+        run<types::busy_spin_wait>("busy_spin_wait", data_count, w_max_sleep, r_timeout);
+        run<types::spin_yield_wait<>>("spin_yield_wait", data_count, w_max_sleep, r_timeout);
+        run<types::spin_park_wait<>>("spin_park_wait", data_count, w_max_sleep, r_timeout);
+#ifdef __linux__
+        run<types::eventfd_wait<>>("eventfd_wait", data_count, w_max_sleep, r_timeout);
+#endif
+    }
+
+    std::cout << "Finish.\n";
+
+    return 0;
+}
@@ -0,0 +1,190 @@
+#include <iostream>
+#include <thread>
+#include <atomic>
+#include <cassert>
+#include <vector>
+
+#include "reclaim.h"
+
+struct Node
+{
+    static const int live_mark = 0x5a5a5a5a;
+
+    Node(int v) : value(v), mark(live_mark) { alive++; }
+    ~Node() { mark = 0; alive--; }
+
+    int value;
+    volatile int mark;
+
+    static std::atomic<int> alive;
+};
+
+std::atomic<int> Node::alive(0);
+
+void hazard_single_thread_test()
+{
+    std::cout << "    hazard_reclaim single thread\n";
+
+    {
+        types::hazard_reclaim<2> domain(4);
+        auto reader = domain.attach();
+        auto writer = domain.attach();
+
+        std::atomic<Node*> src(new Node(0));
+        {
+            auto guard = reader.pin();
+            Node *n = guard.protect(0, src);
+            assert(n->value == 0);
+
+            src.store(new Node(1));
+            writer.retire(n);
+            assert(writer.reclaim() == 0);
+            assert(n->mark == Node::live_mark);
+
+            // moving the slot to another pointer releases the previous one
+            guard.protect(0, src);
+            assert(writer.reclaim() == 1);
+        }
+
+        // retired elements are reclaimed when the threshold is reached
+        for (auto i = 0; i < 8; ++i)
+        {
+            writer.retire(new Node(i));
+        }
+        assert(writer.retired_count() < 8);
+
+        writer.retire(src.exchange(nullptr));
+
+        // remaining retired elements are passed to the domain
+    }
+    assert(Node::alive == 0);
+}
+
+void epoch_single_thread_test()
+{
+    std::cout << "    epoch_reclaim single thread\n";
+
+    {
+        types::epoch_reclaim domain(1000);
+        auto reader = domain.attach();
+        auto writer = domain.attach();
+
+        std::atomic<Node*> src(new Node(0));
+        {
+            auto guard = reader.pin();
+            Node *n = guard.protect(0, src);
+
+            src.store(new Node(1));
+            writer.retire(n);
+
+            // pinned reader blocks epoch after the current one
+            for (auto i = 0; i < 4; ++i)
+            {
+                assert(writer.reclaim() == 0);
+            }
+            assert(n->mark == Node::live_mark);
+
+            // nested guard doesn't unpin the thread
+            {
+                auto nested = reader.pin();
+                assert(nested.protect(0, src)->value == 1);
+            }
+            assert(writer.reclaim() == 0);
+        }
+
+        // epoch is advanced once while the reader is pinned and once after it
+        assert(writer.reclaim() == 1);
+
+        writer.retire(src.exchange(nullptr));
+    }
+    assert(Node::alive == 0);
+}
+
+/*
+ * Writer replaces the shared element and retires the old one, readers read the element under protection
+ * and check that it is not deleted.
+ */
+template<class Domain>
+void multi_thread_test(const char *name, int readers, int data_count)
+{
+    std::cout << "    " << name << " " << readers << " readers\n";
+
+    {
+        Domain domain;
+        std::atomic<Node*> src(new Node(0));
+        std::atomic<bool> done(false);
+
+        std::vector<std::thread> threads;
+        for (auto r = 0; r < readers; ++r)
+        {
+            threads.emplace_back([&]
+            {
+                auto handle = domain.attach();
+                int last = 0;
+                while (!done.load(std::memory_order_acquire))
+                {
+                    auto guard = handle.pin();
+                    Node *n = guard.protect(0, src);
+                    assert(n->mark == Node::live_mark);
+                    assert(n->value >= last);
+                    last = n->value;
+                }
+            });
+        }
+
+        {
+            auto handle = domain.attach();
+            for (auto i = 1; i <= data_count; ++i)
+            {
+                handle.retire(src.exchange(new Node(i)));
+                if (i % 256 == 0)
+                {
+                    std::this_thread::yield();
+                }
+            }
+            done.store(true, std::memory_order_release);
+        }
+
+        for (auto &t : threads)
+        {
+            t.join();
+        }
+
+        delete src.load();
+    }
+    assert(Node::alive == 0);
+}
+
+int main(int argc, const char* argv[])
+{
+    std::cout << "Start...\n";
+
+    int attempts_count = 1, readers = 3, data_count = 20000;
+
+    if (argc == 4)
+    {
+        attempts_count = std::stoi(argv[1]);
+        readers        = std::stoi(argv[2]);
+        data_count     = std::stoi(argv[3]);
+    }
+    else if (argc != 1)
+    {
+        std::cout << "Usage: ./reclaim_test [<attempts_count:1> <readers:3> <data_count:20000>]\n";
+        return 0;
+    }
+
+    for (auto i = 0; i < attempts_count; ++i)
+    {
+        std::cout << "=======================================================\n";
+        std::cout << "  Attempt " << i << "/" << attempts_count << "\n";
+
+        hazard_single_thread_test();
+        epoch_single_thread_test();
+        multi_thread_test<types::hazard_reclaim<1>>("hazard_reclaim", readers, data_count);
+        multi_thread_test<types::epoch_reclaim>("epoch_reclaim", readers, data_count);
+    }
+
+    std::cout << "Finish.\n";
+
+    return 0;
+}
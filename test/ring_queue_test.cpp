@@ -0,0 +1,150 @@
+
+#include <iostream>
+#include <thread>
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <memory>
+
+using namespace std;
+
+#include "ring_queue.h"
+#include "writer.h"
+#include "reader.h"
+
+using Queue = types::ring_queue<int, 8>;
+
+/*
+ * Full queue rejects values, empty one returns false. Positions wrap around the array many times.
+ */
+void single_thread_test()
+{
+    std::cout << "  Single thread...\n";
+
+    Queue q;
+    int value = -1;
+
+    assert(!q.read(value));
+    for (auto i = 0; i < 8; ++i)
+    {
+        assert(q.write(i));
+    }
+    assert(!q.write(100));
+
+    for (auto i = 0; i < 8; ++i)
+    {
+        assert(q.read(value) && value == i);
+    }
+    assert(!q.read(value));
+
+    // write and read by 5 so each round starts at a different position of the array
+    auto next_write = 0, next_read = 0;
+    for (auto round = 0; round < 100; ++round)
+    {
+        for (auto i = 0; i < 5; ++i)
+        {
+            assert(q.write(next_write++));
+        }
+        for (auto i = 0; i < 5; ++i)
+        {
+            assert(q.read(value) && value == next_read++);
+        }
+        assert(!q.read(value));
+    }
+
+    types::ring_queue<std::unique_ptr<int>, 2> uq;
+    assert(uq.write(std::unique_ptr<int>(new int(1))));
+    assert(uq.write(std::unique_ptr<int>(new int(2))));
+    assert(!uq.write(std::unique_ptr<int>(new int(3))));
+    std::unique_ptr<int> u;
+    assert(uq.read(u) && *u == 1);
+    assert(uq.read(u) && *u == 2);
+    assert(!uq.read(u));
+
+    // move-only values go through the writer and reader facades without copies
+    using UniqueQueue = types::ring_queue<std::unique_ptr<int>, 1>;
+    auto fq = std::make_shared<UniqueQueue>();
+    types::writer<UniqueQueue> w(fq);
+    types::reader<UniqueQueue> r(fq);
+    std::unique_ptr<int> first(new int(1)), second(new int(2));
+    assert(w.write(std::move(first)) && first == nullptr);
+    assert(!w.write(std::move(second)) && *second == 2); // rejected value stays with the caller
+    assert(r.read(u) && *u == 1);
+    assert(w.write(std::move(second)) && second == nullptr);
+    assert(r.read(u) && *u == 2);
+}
+
+/*
+ * Writer is faster than the reader and often finds the queue full. Reader checks the order and the sum.
+ */
+void multi_thread_test(int data_count)
+{
+    std::cout << "  Multiple threads...\n";
+
+    auto q = std::make_shared<Queue>();
+
+    std::thread wt([q, data_count]
+    {
+        for (auto i = 0; i < data_count; ++i)
+        {
+            while (!q->write(i))
+            {
+                std::this_thread::yield();
+            }
+        }
+        q->set_writer_finished();
+    });
+
+    std::uint64_t sum = 0;
+    int count = 0, value = 0;
+    while (count < data_count)
+    {
+        if (q->read(value))
+        {
+            assert(value == count);
+            sum += value;
+            count++;
+        }
+        else
+        {
+            std::this_thread::yield();
+        }
+    }
+
+    wt.join();
+
+    assert(q->is_writer_finished());
+    assert(!q->read(value));
+    assert(sum == static_cast<std::uint64_t>(data_count) * (data_count - 1) / 2);
+}
+
+int main(int argc, const char* argv[])
+{
+    std::cout << "Start...\n";
+
+    int attempts_count = 1, data_count = 100000;
+
+    if (argc == 3)
+    {
+        attempts_count = std::stoi(argv[1]);
+        data_count     = std::stoi(argv[2]);
+    }
+    else if (argc != 1)
+    {
+        std::cout << "Usage: ./ring_queue_test [<attempts_count:1> <data_count:100000>]\n";
+        return 0;
+    }
+
+    for (auto i = 0; i < attempts_count; ++i)
+    {
+        std::cout << "=======================================================\n";
+        std::cout << "  Attempt " << i << "/" << attempts_count << "\n";
+
+        single_thread_test();
+        multi_thread_test(data_count);
+    }
+
+    std::cout << "Finish.\n";
+
+    return 0;
+}
@@ -6,6 +6,11 @@ using namespace rl;
 #define assert RL_ASSERT
 
 #include "queue.h"
+#include "ring_queue.h"
+#include "byte_ring.h"
+#include "broadcast_queue.h"
+#include "mpmc_queue.h"
+#include "mpsc_queue.h"
 #include "writer.h"
 #include "reader.h"
 #include "guard.h"
@@ -30,6 +35,52 @@ std::ostream& operator<< (std::ostream& o, const Data* data)
 
 using Queue = types::queue<Data>;
 
+struct MpscData
+{
+    MpscData(int w, int d) : writer(w), data(d)
+    {
+        next.store(nullptr, memory_order_relaxed);
+    }
+    int writer;
+    int data;
+    atomic<MpscData*> next;
+};
+
+using MpscQueue = types::mpsc_queue<MpscData>;
+
+/*
+ * Wait policy that counts notifications about handed off segments like eventfd_wait does.
+ */
+struct handoff_signal_wait
+{
+    static const bool handoff_only = true;
+
+    atomic<int> signals;
+
+    handoff_signal_wait()
+    {
+        signals.store(0, memory_order_relaxed);
+    }
+
+    void notify(bool handed_off)
+    {
+        if (handed_off)
+        {
+            signals.fetch_add(1, memory_order_release);
+        }
+    }
+};
+
+using HandoffQueue = types::queue<Data, types::cache_aligned_layout, handoff_signal_wait>;
+
+using RingQueue = types::ring_queue<int, 2>;
+
+using MpmcQueue = types::mpmc_queue<int, 2>;
+
+using ByteRing = types::byte_ring<64>;
+
+using BroadcastQueue = types::broadcast_queue<int, 2>;
+
 template<class T>
 using Writer = types::writer<T>;
 
@@ -74,77 +125,491 @@ struct queue_single_rw_test: rl::test_suite<queue_single_rw_test, 2>
     }
 };
 
-struct queue_multi_rw_test: rl::test_suite<queue_multi_rw_test, 3>
+struct queue_order_test: rl::test_suite<queue_order_test, 2>
 {
-    int value = 0;
+    static const int count = 3;
 
-    std::shared_ptr<Queue> q = std::make_shared<Queue>();
-    GuardedWriter<Queue> writer;
-    GuardedReader<Queue> reader;
+    Queue q;
 
-    queue_multi_rw_test() : writer(q), reader(q)
-    {}
+    void thread(unsigned thread_index)
+    {
+        if (0 == thread_index)
+        {
+            for (int i = 0; i < count; ++i)
+            {
+                q.write(new Queue::value_type(i));
+            }
+        }
+        else
+        {
+            for (int i = 0; i < count; ++i)
+            {
+                Queue::pointer data = nullptr;
+
+                while (!q.read(data))
+                {
+                }
+
+                RL_ASSERT(nullptr != data);
+                RL_ASSERT(i == data->data);
+
+                delete data;
+            }
+        }
+    }
+};
+
+struct queue_batch_test: rl::test_suite<queue_batch_test, 2>
+{
+    static const int count = 3;
+
+    Queue q;
+
+    void thread(unsigned thread_index)
+    {
+        if (0 == thread_index)
+        {
+            auto first = new Queue::value_type(0);
+            auto last  = new Queue::value_type(1);
+            first->VAR(next) = last;
+
+            q.write_batch(first, last);
+            q.write(new Queue::value_type(2));
+        }
+        else
+        {
+            int expected = 0;
+            while (expected < count)
+            {
+                q.drain([&](Queue::pointer data)
+                {
+                    RL_ASSERT(expected == data->data);
+                    expected++;
+
+                    delete data;
+                });
+            }
+        }
+    }
+};
+
+/*
+ * Reader reads until the queue is empty and then waits for the next handoff notification.
+ * If writer doesn't notify after reader saw the queue empty then reader spins forever.
+ */
+struct queue_handoff_notify_test: rl::test_suite<queue_handoff_notify_test, 2>
+{
+    static const int count = 3;
+
+    HandoffQueue q;
+
+    void thread(unsigned thread_index)
+    {
+        if (0 == thread_index)
+        {
+            for (int i = 0; i < count; ++i)
+            {
+                q.write(new Data(i));
+            }
+        }
+        else
+        {
+            int expected = 0;
+            for (;;)
+            {
+                int signals = q.get_wait_policy().signals.load(memory_order_acquire);
+
+                HandoffQueue::pointer data = nullptr;
+                while (q.read(data))
+                {
+                    RL_ASSERT(expected == data->data);
+                    expected++;
+
+                    delete data;
+                }
+
+                if (expected == count)
+                {
+                    break;
+                }
+
+                while (signals == q.get_wait_policy().signals.load(memory_order_acquire))
+                {
+                }
+            }
+        }
+    }
+};
+
+struct queue_bounded_test: rl::test_suite<queue_bounded_test, 2>
+{
+    static const int count = 3;
+
+    Queue q{Queue::capacity_policy::bounded(1)};
+
+    void thread(unsigned thread_index)
+    {
+        if (0 == thread_index)
+        {
+            for (int i = 0; i < count; ++i)
+            {
+                auto data = new Data(i);
+                while (q.try_write(data) != Queue::write_result::written)
+                {
+                }
+                RL_ASSERT(q.depth() <= 1);
+            }
+        }
+        else
+        {
+            int expected = 0;
+            while (expected < count)
+            {
+                Queue::pointer data = nullptr;
+                if (q.read(data))
+                {
+                    RL_ASSERT(expected == data->data);
+                    expected++;
+
+                    delete data;
+                }
+            }
+        }
+    }
+};
+
+struct ring_queue_test: rl::test_suite<ring_queue_test, 2>
+{
+    static const int count = 4;
+
+    RingQueue q;
+
+    void thread(unsigned thread_index)
+    {
+        if (0 == thread_index)
+        {
+            for (int i = 0; i < count; ++i)
+            {
+                while (!q.write(i))
+                {
+                }
+            }
+
+            q.set_writer_finished();
+        }
+        else
+        {
+            for (int i = 0; i < count; ++i)
+            {
+                int data = -1;
+
+                while (!q.read(data))
+                {
+                }
+
+                RL_ASSERT(i == data);
+            }
+
+            int data = -1;
+            RL_ASSERT(!q.read(data));
+        }
+    }
+};
+
+/*
+ * Messages of 16 and 20 bytes don't fit to the end of 64 byte ring so writer has to wrap with padding
+ * while reader still reads the previous ones.
+ */
+struct byte_ring_test: rl::test_suite<byte_ring_test, 2>
+{
+    static const int count = 4;
+
+    ByteRing q;
+
+    static std::size_t size_of(int i)
+    {
+        return 16 + (i % 2) * 4;
+    }
+
+    void thread(unsigned thread_index)
+    {
+        if (0 == thread_index)
+        {
+            for (int i = 0; i < count; ++i)
+            {
+                unsigned char *space;
+                while ((space = static_cast<unsigned char*>(q.reserve(size_of(i)))) == nullptr)
+                {
+                }
+
+                for (std::size_t j = 0; j < size_of(i); ++j)
+                {
+                    space[j] = static_cast<unsigned char>(i);
+                }
+                q.commit();
+            }
+
+            q.set_writer_finished();
+        }
+        else
+        {
+            for (int i = 0; i < count; ++i)
+            {
+                std::size_t size = 0;
+                const unsigned char *msg;
+
+                while ((msg = static_cast<const unsigned char*>(q.peek(size))) == nullptr)
+                {
+                }
+
+                RL_ASSERT(size_of(i) == size);
+                for (std::size_t j = 0; j < size; ++j)
+                {
+                    RL_ASSERT(i == msg[j]);
+                }
+                q.release();
+            }
+
+            std::size_t size = 0;
+            RL_ASSERT(nullptr == q.peek(size));
+        }
+    }
+};
+
+/*
+ * Both readers get all elements. Reader 1 reads batches in place while writer waits for the slower reader.
+ */
+struct broadcast_queue_test: rl::test_suite<broadcast_queue_test, 3>
+{
+    static const int count = 4;
+
+    BroadcastQueue q{2};
+
+    void thread(unsigned thread_index)
+    {
+        if (0 == thread_index)
+        {
+            for (int i = 0; i < count; ++i)
+            {
+                while (!q.write(i))
+                {
+                }
+            }
+
+            q.set_writer_finished();
+        }
+        else if (1 == thread_index)
+        {
+            for (int i = 0; i < count; ++i)
+            {
+                int data = -1;
+
+                while (!q.read(0, data))
+                {
+                }
+
+                RL_ASSERT(i == data);
+            }
+
+            int data = -1;
+            RL_ASSERT(!q.read(0, data));
+        }
+        else
+        {
+            int expected = 0;
+            while (expected < count)
+            {
+                q.read_all(1, [&](int data)
+                {
+                    RL_ASSERT(expected == data);
+                    expected++;
+                });
+            }
+        }
+    }
+};
+
+/*
+ * Two writers and two readers, every value is received exactly once.
+ * Not run in main() until it passes rl::simulate with the Relacy library.
+ */
+struct mpmc_queue_test: rl::test_suite<mpmc_queue_test, 4>
+{
+    static const int writers = 2;
+
+    MpmcQueue q;
+    VAR_T(int) received[writers];
 
     void before()
     {
-        std::cout << "+++++++++++++++++++++\n";
-//        std::cout << "Writers : Readers\n";
-//        for (int i = 0; i < params::static_thread_count; i += 2)
-//            std::cout << i << "  ";
-//        std::cout << "|  ";
-//        for (int i = 1; i < params::static_thread_count; i += 2)
-//            std::cout << i << "  ";
-//        std::cout << "\n";
+        for (int i = 0; i < writers; ++i)
+        {
+            VAR(received[i]) = 0;
+        }
+    }
+
+    void after()
+    {
+        for (int i = 0; i < writers; ++i)
+        {
+            RL_ASSERT(1 == VAR(received[i]));
+        }
     }
 
     void thread(unsigned thread_index)
     {
-//        std::cout << "Test: " << thread_index << "\n";
+        if (thread_index < writers)
+        {
+            while (!q.write(thread_index))
+            {
+                rl::yield(1, $);
+            }
+        }
+        else
+        {
+            int data = -1;
 
-        if (0 == (thread_index & 1))
+            while (!q.read(data))
+            {
+                rl::yield(1, $);
+            }
+
+            RL_ASSERT(0 <= data && data < writers);
+
+            VAR(received[data])++;
+        }
+    }
+};
+
+struct mpsc_queue_test: rl::test_suite<mpsc_queue_test, 3>
+{
+    static const int writers = 2;
+    static const int count = 2;
+
+    MpscQueue q;
+
+    void thread(unsigned thread_index)
+    {
+        if (0 == thread_index)
+        {
+            for (int i = 0; i < count; ++i)
+            {
+                q.write(new MpscData(thread_index, i));
+            }
+        }
+        else if (1 == thread_index)
+        {
+            // the whole chain is appended at once
+            auto first = new MpscData(thread_index, 0);
+            auto last  = new MpscData(thread_index, 1);
+            first->next.store(last, memory_order_relaxed);
+            q.write_batch(first, last);
+        }
+        else
+        {
+            int expected[writers] = {0, 0};
+            int received = 0;
+            while (received < writers * count)
+            {
+                MpscQueue::pointer data = nullptr;
+                if (q.read(data))
+                {
+                    RL_ASSERT(expected[data->writer] == data->data);
+                    expected[data->writer]++;
+                    received++;
+
+                    delete data;
+                }
+            }
+        }
+    }
+};
+
+struct mpsc_queue_read_all_test: rl::test_suite<mpsc_queue_read_all_test, 3>
+{
+    static const int writers = 2;
+
+    MpscQueue q;
+
+    void thread(unsigned thread_index)
+    {
+        if (thread_index < writers)
         {
-            auto data = new Queue::value_type(value);
-            auto flush = !writer->write(data);
+            q.write(new MpscData(thread_index, 0));
+            q.write(new MpscData(thread_index, 1));
+        }
+        else
+        {
+            int expected[writers] = {0, 0};
+            int received = 0;
+            while (received < writers * 2)
+            {
+                received += q.drain([&](MpscQueue::pointer data)
+                {
+                    RL_ASSERT(expected[data->writer] == data->data);
+                    expected[data->writer]++;
+
+                    delete data;
+                });
+            }
+        }
+    }
+};
+
+/*
+ * Two writers and two readers share one queue via guard. Each writer writes one element and each reader
+ * reads one, so every element is received exactly once and nothing is left in the queue.
+ * Not run in main() until it passes rl::simulate with the Relacy library.
+ */
+struct queue_multi_rw_test: rl::test_suite<queue_multi_rw_test, 4>
+{
+    static const int writers = 2;
 
-            std::cout << "New[" << thread_index << "]: " << data << "\n";
+    std::shared_ptr<Queue> q = std::make_shared<Queue>();
+    GuardedWriter<Queue> writer;
+    GuardedReader<Queue> reader;
+    VAR_T(int) received[writers];
 
-            value++;
+    queue_multi_rw_test() : writer(q), reader(q)
+    {}
 
-//            data = new Queue::value_type(value);
-//            flush = !writer->write(data);
-//
-//            std::cout << "New[" << thread_index << "]: " << data << "\n";
-//
-//            value++;
+    void before()
+    {
+        for (int i = 0; i < writers; ++i)
+        {
+            VAR(received[i]) = 0;
+        }
+    }
 
-//            for (int i = 0; i < (thread_index >> 1); ++i)
-//                std::cout << "   ";
-//            std::cout << (value - 1) << "\n";
+    void after()
+    {
+        for (int i = 0; i < writers; ++i)
+        {
+            RL_ASSERT(1 == VAR(received[i]));
+        }
+    }
 
-//            writer.set_writer_finished();
+    void thread(unsigned thread_index)
+    {
+        if (thread_index < writers)
+        {
+            writer->write(new Queue::value_type(thread_index));
         }
         else
         {
             Queue::pointer data = nullptr;
 
             while (!reader->read(data))
-            {}
+            {
+                rl::yield(1, $);
+            }
 
             RL_ASSERT(nullptr != data);
+            RL_ASSERT(0 <= data->data && data->data < writers);
 
-//            for (int i = 0; i < (params::static_thread_count >> 1); ++i)
-//                std::cout << "   ";
-//            std::cout << "      ";
-//            for (int i = 0; i < (thread_index >> 1); ++i)
-//                std::cout << "   ";
-//
-//            std::cout << data->data << "\n";
-
-            std::cout << "Del[" << thread_index << "]: " << data << "\n";
+            VAR(received[data->data])++;
 
             delete data;
-
-            std::cout << "-----\n";
         }
     }
 };
@@ -152,7 +617,15 @@ struct queue_multi_rw_test: rl::test_suite<queue_multi_rw_test, 3>
 int main()
 {
     rl::simulate<queue_single_rw_test>();
-//    rl::simulate<queue_multi_rw_test>(); // TODO: fix test
+    rl::simulate<queue_order_test>();
+    rl::simulate<queue_batch_test>();
+    rl::simulate<queue_handoff_notify_test>();
+    rl::simulate<queue_bounded_test>();
+    rl::simulate<ring_queue_test>();
+    rl::simulate<byte_ring_test>();
+    rl::simulate<broadcast_queue_test>();
+    rl::simulate<mpsc_queue_test>();
+    rl::simulate<mpsc_queue_read_all_test>();
 
     return 0;
 }
@@ -0,0 +1,175 @@
+#include <iostream>
+#include <thread>
+#include <atomic>
+#include <cassert>
+#include <cstdint>
+#include <string>
+
+#include <sys/wait.h>
+#include <unistd.h>
+
+using namespace std;
+
+#include "shm_queue.h"
+
+struct Message
+{
+    std::uint64_t seq;
+    char payload[56];
+};
+
+using Queue = types::shm_queue<Message>;
+
+/*
+ * Named region is mapped twice so writer and reader see the queue at different addresses.
+ * Nodes are returned to the writer after they are read.
+ */
+void named_region_test()
+{
+    std::cout << "  Named region...\n";
+
+    std::string name = "/types_shm_queue_test_" + std::to_string(getpid());
+    const std::uint32_t capacity = 16;
+
+    auto created = types::shm_region::create(name.c_str(), Queue::region_size(capacity));
+    assert(created.is_open());
+    auto opened = types::shm_region::open(name.c_str());
+    assert(opened.is_open());
+    assert(opened.size() == created.size());
+    assert(opened.data() != created.data());
+    types::shm_region::unlink(name.c_str());
+
+    Queue w(created.data(), created.size(), Queue::create_mode);
+    Queue r(opened.data(), opened.size(), Queue::attach_mode);
+    assert(w.is_valid() && r.is_valid());
+    assert(r.capacity() == capacity);
+
+    Message m = {};
+    for (std::uint64_t i = 0; i < capacity; ++i)
+    {
+        m.seq = i;
+        assert(w.push(m));
+    }
+    assert(w.allocate() == nullptr);
+
+    Message *data = nullptr;
+    for (std::uint64_t i = 0; i < capacity / 2; ++i)
+    {
+        assert(r.read(data) && data->seq == i);
+        r.release(data);
+    }
+
+    for (std::uint64_t i = capacity; i < capacity + capacity / 2; ++i)
+    {
+        m.seq = i;
+        assert(w.push(m));
+    }
+    assert(!w.push(m));
+    w.set_writer_finished();
+
+    std::uint64_t expected = capacity / 2;
+    while (r.read_wait(data))
+    {
+        assert(data->seq == expected++);
+        r.release(data);
+    }
+    assert(expected == capacity + capacity / 2);
+    assert(r.is_writer_finished());
+
+    // region without a queue or with a queue of other type can't be attached
+    auto other = types::shm_region::anonymous(Queue::region_size(capacity));
+    assert(!Queue(other.data(), other.size(), Queue::attach_mode).is_valid());
+    assert(!types::shm_queue<std::uint64_t>(opened.data(), opened.size(), types::shm_queue<std::uint64_t>::attach_mode).is_valid());
+}
+
+/*
+ * Writer is a child process that maps the unnamed region by descriptor again. Small capacity makes
+ * the writer wait for nodes returned by the reader.
+ */
+void process_test(int data_count, std::uint32_t capacity)
+{
+    std::cout << "    " << data_count << " messages, " << capacity << " nodes\n";
+
+    auto region = types::shm_region::anonymous(Queue::region_size(capacity));
+    assert(region.is_open());
+
+    Queue q(region.data(), region.size(), Queue::create_mode);
+    assert(q.is_valid());
+
+    pid_t pid = fork();
+    assert(pid >= 0);
+
+    if (pid == 0)
+    {
+        auto mapped = types::shm_region::from_fd(region.fd());
+        Queue w(mapped.data(), mapped.size(), Queue::attach_mode);
+        if (!w.is_valid())
+        {
+            _exit(1);
+        }
+
+        for (auto i = 0; i < data_count; ++i)
+        {
+            Message *m;
+            while ((m = w.allocate()) == nullptr)
+            {
+                std::this_thread::yield();
+            }
+            m->seq = std::uint64_t(i);
+            m->payload[0] = char(i);
+            w.write(m);
+        }
+        w.set_writer_finished();
+
+        _exit(0);
+    }
+
+    int expected = 0;
+    Message *m = nullptr;
+    while (q.read_wait(m))
+    {
+        assert(m->seq == std::uint64_t(expected));
+        assert(m->payload[0] == char(expected));
+        expected++;
+        q.release(m);
+    }
+    assert(expected == data_count);
+
+    int status = 0;
+    waitpid(pid, &status, 0);
+    assert(WIFEXITED(status) && WEXITSTATUS(status) == 0);
+}
+
+int main(int argc, const char* argv[])
+{
+    std::cout << "Start...\n";
+
+    int attempts_count = 1, data_count = 1000000;
+
+    if (argc == 3)
+    {
+        attempts_count = std::stoi(argv[1]);
+        data_count     = std::stoi(argv[2]);
+    }
+    else if (argc != 1)
+    {
+        std::cout << "Usage: ./shm_queue_test [<attempts_count:1> <data_count:1000000>]\n";
+        return 0;
+    }
+
+    for (auto i = 0; i < attempts_count; ++i)
+    {
+        std::cout << "=======================================================\n";
+        std::cout << "  Attempt " << i << "/" << attempts_count << "\n";
+
+        named_region_test();
+
+        std::cout << "  Writer process...\n";
+        process_test(data_count, 4);
+        process_test(data_count, 1024);
+    }
+
+    std::cout << "Finish.\n";
+
+    return 0;
+}
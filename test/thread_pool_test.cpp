@@ -0,0 +1,153 @@
+
+#include <iostream>
+#include <thread>
+#include <atomic>
+#include <cassert>
+#include <memory>
+#include <mutex>
+#include <stdexcept>
+#include <vector>
+
+using namespace std;
+
+#include "queue.h"
+#include "thread_pool.h"
+
+/*
+ * Recursive fork/join. Waiting for subtasks runs other tasks so workers are not blocked.
+ */
+std::uint64_t fib(types::thread_pool &pool, int n)
+{
+    if (n < 2)
+        return n;
+
+    if (n < 12)
+        return fib(pool, n - 1) + fib(pool, n - 2);
+
+    auto f = pool.submit([&pool, n] { return fib(pool, n - 1); });
+    auto b = fib(pool, n - 2);
+    return pool.wait(f) + b;
+}
+
+std::uint64_t fib_seq(int n)
+{
+    return n < 2 ? n : fib_seq(n - 1) + fib_seq(n - 2);
+}
+
+void futures_test(types::thread_pool &pool)
+{
+    std::cout << "    Futures\n";
+
+    auto f1 = pool.submit([] { return 42; });
+    auto f2 = pool.submit([] { return std::string("text"); });
+    auto f3 = pool.submit([] { throw std::runtime_error("error"); });
+    auto f4 = pool.submit([] {});
+
+    assert(pool.wait(f1) == 42);
+    assert(f2.get() == "text");
+    pool.wait(f4);
+
+    bool thrown = false;
+    try
+    {
+        pool.wait(f3);
+    }
+    catch (const std::runtime_error&)
+    {
+        thrown = true;
+    }
+    assert(thrown);
+}
+
+void fork_join_test(types::thread_pool &pool, int n)
+{
+    std::cout << "    Fork/join: fib(" << n << ")\n";
+
+    auto f = pool.submit([&pool, n] { return fib(pool, n); });
+    assert(pool.wait(f) == fib_seq(n));
+}
+
+/*
+ * Several threads that are not workers post tasks. Each task increments the counter.
+ */
+void fan_out_test(types::thread_pool &pool, int submitters, int n)
+{
+    std::cout << "    Fan-out: " << submitters << " submitters\n";
+
+    std::atomic<int> counter(0);
+
+    std::vector<std::thread> threads;
+    for (auto s = 0; s < submitters; ++s)
+    {
+        threads.emplace_back([&]
+        {
+            for (auto i = 0; i < n; ++i)
+                pool.post([&counter] { counter.fetch_add(1); });
+        });
+    }
+
+    for (auto &t : threads)
+        t.join();
+
+    auto total = submitters * n;
+    while (counter.load() != total)
+        std::this_thread::yield();
+}
+
+/*
+ * Pool runs remaining tasks before it is destroyed.
+ */
+void shutdown_test(std::size_t workers, int n)
+{
+    std::cout << "    Shutdown\n";
+
+    std::atomic<int> counter(0);
+    {
+        types::thread_pool pool(workers);
+        for (auto i = 0; i < n; ++i)
+        {
+            pool.post([&pool, &counter]
+            {
+                pool.post([&counter] { counter.fetch_add(1); });
+                counter.fetch_add(1);
+            });
+        }
+    }
+    assert(counter.load() == 2 * n);
+}
+
+int main(int argc, const char* argv[])
+{
+    std::cout << "Start...\n";
+
+    int attempts_count = 1, workers_count = 4, data_count = 20000;
+
+    if (argc == 4)
+    {
+        attempts_count = std::stoi(argv[1]);
+        workers_count  = std::stoi(argv[2]);
+        data_count     = std::stoi(argv[3]);
+    }
+    else if (argc != 1)
+    {
+        std::cout << "Usage: ./thread_pool_test [<attempts_count:1> <workers_count:4> <data_count:20000>]\n";
+        return 0;
+    }
+
+    for (auto i = 0; i < attempts_count; ++i)
+    {
+        std::cout << "=======================================================\n";
+        std::cout << "  Attempt " << i << "/" << attempts_count << "\n";
+
+        types::thread_pool pool(workers_count);
+
+        futures_test(pool);
+        fork_join_test(pool, 25);
+        fan_out_test(pool, 3, data_count);
+        shutdown_test(workers_count, data_count);
+    }
+
+    std::cout << "Finish.\n";
+
+    return 0;
+}
@@ -0,0 +1,140 @@
+
+#include <iostream>
+#include <thread>
+#include <atomic>
+#include <cassert>
+#include <memory>
+#include <mutex>
+#include <string>
+
+using namespace std;
+
+#include "queue.h"
+#include "node_pool.h"
+#include "value_queue.h"
+
+struct Large
+{
+    Large(int d = 0) : data(d) {}
+
+    int data;
+    char payload[256];
+};
+
+static_assert(types::value_queue<int>::is_inline, "int should be stored inline");
+static_assert(types::value_queue<std::string>::is_inline, "std::string should be stored inline");
+static_assert(!types::value_queue<Large>::is_inline, "Large should be boxed");
+
+/*
+ * Values are moved through the queue and remaining values are destroyed with the queue.
+ */
+void single_thread_test()
+{
+    std::cout << "  Single thread...\n";
+
+    auto counter = std::make_shared<int>(0);
+    {
+        types::value_queue<std::shared_ptr<int>> q;
+        q.push(counter);
+        q.push(counter);
+        q.emplace(counter);
+        assert(counter.use_count() == 4);
+
+        std::shared_ptr<int> p;
+        assert(q.try_pop(p) && p == counter);
+        p.reset();
+        assert(counter.use_count() == 3);
+    }
+    assert(counter.use_count() == 1);
+
+    types::value_queue<std::unique_ptr<int>> uq;
+    uq.push(std::unique_ptr<int>(new int(42)));
+    std::unique_ptr<int> u;
+    assert(uq.try_pop(u) && *u == 42);
+    assert(!uq.try_pop(u));
+
+    types::value_queue<Large> lq;
+    lq.emplace(7);
+    Large l;
+    assert(lq.try_pop(l) && l.data == 7);
+
+#ifdef TYPES_HAS_OPTIONAL
+    types::value_queue<std::string> sq;
+    sq.push("text");
+    auto s = sq.pop();
+    assert(s && *s == "text");
+    assert(!sq.pop());
+#endif
+}
+
+template<class T, class Make, class Check>
+void multi_thread_test(const char *name, int n, Make make, Check check)
+{
+    std::cout << "  Multiple threads: " << name << "...\n";
+
+    auto q = std::make_shared<types::value_queue<T>>(1024);
+
+    std::thread wt([q, n, make]
+    {
+        for (auto i = 0; i < n; ++i)
+        {
+            q->push(make(i));
+        }
+        q->set_writer_finished();
+    });
+
+    std::thread rt([q, n, check]
+    {
+        int expected = 0;
+        T value;
+        while (q->pop_wait(value))
+        {
+            check(value, expected);
+            expected++;
+        }
+        assert(expected == n);
+    });
+
+    wt.join();
+    rt.join();
+}
+
+int main(int argc, const char* argv[])
+{
+    std::cout << "Start...\n";
+
+    int attempts_count = 1, data_count = 100000;
+
+    if (argc == 3)
+    {
+        attempts_count = std::stoi(argv[1]);
+        data_count     = std::stoi(argv[2]);
+    }
+    else if (argc != 1)
+    {
+        std::cout << "Usage: ./value_queue_test [<attempts_count:1> <data_count:100000>]\n";
+        return 0;
+    }
+
+    for (auto i = 0; i < attempts_count; ++i)
+    {
+        std::cout << "=======================================================\n";
+        std::cout << "  Attempt " << i << "/" << attempts_count << "\n";
+
+        single_thread_test();
+
+        multi_thread_test<int>("int", data_count,
+                               [](int i) { return i; },
+                               [](int v, int expected) { assert(v == expected); });
+        multi_thread_test<std::string>("std::string", data_count,
+                                       [](int i) { return std::to_string(i); },
+                                       [](const std::string &v, int expected) { assert(v == std::to_string(expected)); });
+        multi_thread_test<Large>("Large", data_count,
+                                 [](int i) { return Large(i); },
+                                 [](const Large &v, int expected) { assert(v.data == expected); });
+    }
+
+    std::cout << "Finish.\n";
+
+    return 0;
+}
@@ -0,0 +1,539 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Oleg Khryptul aka HaronK
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// NOTE: queue.h should be included before this file.
+// Thread pool uses std::atomic directly and is not checked with Relacy Race Detector library.
+
+#include "platform.h"
+#include "locks.h"
+
+#include <atomic>
+#include <cassert>
+#include <condition_variable>
+#include <future>
+#include <memory>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+namespace types
+{
+
+/**
+ * Task of the thread pool. Tasks are linked via next pointer while they are in the injection queue.
+ */
+struct pool_task
+{
+    virtual ~pool_task() {}
+    virtual void run() = 0;
+
+    pool_task *next = nullptr;
+};
+
+/**
+ * Chase-Lev work stealing deque of tasks.
+ *
+ * Owner thread pushes and pops tasks at the bottom (LIFO), other threads steal them from the top (FIFO).
+ * Owner's operations take no read-modify-write operations except when one task is left.
+ * Buffer grows when it is full. Old buffers are kept until the deque is destroyed because thieves
+ * could still read from them.
+ *
+ * See "Correct and Efficient Work-Stealing for Weak Memory Models" by N.M. Le, A. Pop, A. Cohen
+ * and F. Zappa Nardelli.
+ */
+class work_deque
+{
+public:
+    explicit work_deque(std::size_t capacity = 256)
+    {
+        buffers.emplace_back(new buffer(capacity));
+        current.store(buffers.back().get(), std::memory_order_relaxed);
+    }
+
+    work_deque(const work_deque&) = delete;
+    work_deque& operator=(const work_deque&) = delete;
+
+    /**
+     * Owner only method.
+     */
+    void push(pool_task *t)
+    {
+        auto b = bottom.load(std::memory_order_relaxed);
+        auto tp = top.load(std::memory_order_acquire);
+        auto buf = current.load(std::memory_order_relaxed);
+
+        if (b - tp > static_cast<std::int64_t>(buf->mask))
+        {
+            buf = grow(buf, tp, b);
+        }
+
+        buf->put(b, t);
+        bottom.store(b + 1, std::memory_order_release);
+    }
+
+    /**
+     * Owner only method.
+     *
+     * @return task or nullptr if deque is empty.
+     */
+    pool_task* pop()
+    {
+        auto b = bottom.load(std::memory_order_relaxed) - 1;
+        auto buf = current.load(std::memory_order_relaxed);
+        bottom.store(b, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        auto tp = top.load(std::memory_order_relaxed);
+
+        if (tp > b)
+        {
+            bottom.store(b + 1, std::memory_order_relaxed); // empty
+            return nullptr;
+        }
+
+        auto t = buf->get(b);
+        if (tp == b)
+        {
+            // last task, race with thieves
+            if (!top.compare_exchange_strong(tp, tp + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+            {
+                t = nullptr;
+            }
+            bottom.store(b + 1, std::memory_order_relaxed);
+        }
+        return t;
+    }
+
+    /**
+     * Can be called from any thread.
+     *
+     * @return task or nullptr if deque is empty or another thread has taken the task first.
+     */
+    pool_task* steal()
+    {
+        auto tp = top.load(std::memory_order_acquire);
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+        auto b = bottom.load(std::memory_order_acquire);
+
+        if (tp >= b)
+        {
+            return nullptr;
+        }
+
+        auto buf = current.load(std::memory_order_acquire);
+        auto t = buf->get(tp);
+        if (!top.compare_exchange_strong(tp, tp + 1, std::memory_order_seq_cst, std::memory_order_relaxed))
+        {
+            return nullptr;
+        }
+        return t;
+    }
+
+    bool empty() const
+    {
+        return bottom.load(std::memory_order_relaxed) <= top.load(std::memory_order_relaxed);
+    }
+
+private:
+    struct buffer
+    {
+        explicit buffer(std::size_t capacity) : mask(capacity - 1), tasks(new std::atomic<pool_task*>[capacity])
+        {
+            assert((capacity & mask) == 0);
+        }
+
+        pool_task* get(std::int64_t i) const
+        {
+            return tasks[i & mask].load(std::memory_order_relaxed);
+        }
+
+        void put(std::int64_t i, pool_task *t)
+        {
+            tasks[i & mask].store(t, std::memory_order_relaxed);
+        }
+
+        const std::size_t mask;
+        std::unique_ptr<std::atomic<pool_task*>[]> tasks;
+    };
+
+    buffer* grow(buffer *old, std::int64_t tp, std::int64_t b)
+    {
+        buffers.emplace_back(new buffer((old->mask + 1) * 2));
+        auto buf = buffers.back().get();
+        for (auto i = tp; i < b; ++i)
+        {
+            buf->put(i, old->get(i));
+        }
+        current.store(buf, std::memory_order_release);
+        return buf;
+    }
+
+    alignas(TYPES_CACHE_LINE_SIZE) std::atomic<std::int64_t> top{0};
+    alignas(TYPES_CACHE_LINE_SIZE) std::atomic<std::int64_t> bottom{0};
+    std::atomic<buffer*> current;
+    std::vector<std::unique_ptr<buffer>> buffers; // owner's
+};
+
+/**
+ * Work stealing thread pool.
+ *
+ * Each worker has its own work_deque. Tasks submitted by a worker go to its deque, tasks submitted
+ * by other threads go to the injection queue (queue.h) which is written under a lock. Idle worker
+ * takes the whole injection segment with read_all(), runs the first task and pushes the rest to its
+ * deque so other idle workers can steal them. Workers with nothing to do steal from other workers
+ * and then sleep until new tasks are submitted.
+ *
+ * wait() runs other tasks while the future is not ready so recursive (fork/join) tasks don't block
+ * workers.
+ *
+ * Tasks left in the pool are run before the destructor returns.
+ *
+ * Example:
+ *   thread_pool pool(4);
+ *   auto f = pool.submit([] { return 42; });
+ *   pool.post([] { ... });         // no future, task can call a completion callback itself
+ *   auto v = pool.wait(f);         // helping wait
+ */
+class thread_pool
+{
+public:
+    explicit thread_pool(std::size_t workers_count = std::thread::hardware_concurrency());
+    ~thread_pool();
+
+    thread_pool(const thread_pool&) = delete;
+    thread_pool& operator=(const thread_pool&) = delete;
+
+    /**
+     * Submit task and get its result via future. Exception thrown by the task is stored in the future.
+     */
+    template<class Function>
+    auto submit(Function fn) -> std::future<decltype(fn())>
+    {
+        using result_type = decltype(fn());
+
+        std::packaged_task<result_type()> task(std::move(fn));
+        auto result = task.get_future();
+        post(std::move(task));
+        return result;
+    }
+
+    /**
+     * Submit task without a future. Task should not throw exceptions.
+     */
+    template<class Function>
+    void post(Function fn)
+    {
+        schedule(new function_task<Function>(std::move(fn)));
+    }
+
+    /**
+     * Wait for the future running other tasks meanwhile.
+     *
+     * @return result of the future.
+     */
+    template<class R>
+    R wait(std::future<R> &f)
+    {
+        while (f.wait_for(std::chrono::seconds(0)) != std::future_status::ready)
+        {
+            if (!run_one())
+            {
+                std::this_thread::yield();
+            }
+        }
+        return f.get();
+    }
+
+    std::size_t size() const
+    {
+        return workers.size();
+    }
+
+private:
+    template<class Function>
+    struct function_task : pool_task
+    {
+        explicit function_task(Function &&fn) : fn(std::move(fn)) {}
+
+        void run() override
+        {
+            fn();
+        }
+
+        Function fn;
+    };
+
+    struct worker
+    {
+        work_deque deque;
+        std::thread thread;
+    };
+
+    static const std::size_t no_worker = static_cast<std::size_t>(-1);
+    static const unsigned spin_rounds  = 64;
+
+    /*
+     * Index of the calling thread's worker in the pool or no_worker for other threads.
+     */
+    std::size_t current_worker() const
+    {
+        return current().pool == this ? current().index : no_worker;
+    }
+
+    struct worker_id
+    {
+        const thread_pool *pool = nullptr;
+        std::size_t index = 0;
+    };
+
+    static worker_id& current()
+    {
+        static thread_local worker_id id;
+        return id;
+    }
+
+    void schedule(pool_task *t);
+    bool run_one();
+    pool_task* find_task(std::size_t index);
+    pool_task* take_injected(std::size_t index);
+    void notify();
+    void worker_loop(std::size_t index);
+
+    std::vector<std::unique_ptr<worker>> workers;
+
+    // tasks from the threads that are not workers
+    queue<pool_task> injected;
+    adaptive_mutex injected_writer_lock;
+    ttas_spinlock injected_reader_lock;
+
+    // sleeping workers
+    alignas(TYPES_CACHE_LINE_SIZE) std::atomic<std::size_t> sleeping{0};
+    std::atomic<bool> stopping{false};
+    std::uint64_t signals = 0; // guarded by sleep_mutex
+    std::mutex sleep_mutex;
+    std::condition_variable sleep_cv;
+};
+
+inline thread_pool::thread_pool(std::size_t workers_count)
+{
+    if (workers_count == 0)
+    {
+        workers_count = 1;
+    }
+
+    for (std::size_t i = 0; i < workers_count; ++i)
+    {
+        workers.emplace_back(new worker);
+    }
+
+    for (std::size_t i = 0; i < workers_count; ++i)
+    {
+        workers[i]->thread = std::thread(&thread_pool::worker_loop, this, i);
+    }
+}
+
+inline thread_pool::~thread_pool()
+{
+    {
+        std::lock_guard<std::mutex> lock(sleep_mutex);
+        stopping.store(true, std::memory_order_seq_cst);
+        signals++;
+    }
+    sleep_cv.notify_all();
+
+    for (auto &w : workers)
+    {
+        w->thread.join();
+    }
+}
+
+inline void thread_pool::schedule(pool_task *t)
+{
+    auto index = current_worker();
+    if (index != no_worker)
+    {
+        workers[index]->deque.push(t);
+    }
+    else
+    {
+        std::lock_guard<adaptive_mutex> lock(injected_writer_lock);
+        injected.write(t);
+    }
+
+    notify();
+}
+
+/*
+ * Wake up one sleeping worker. Sleeping counter is checked after the task is published and worker
+ * checks for tasks after it increments the counter so either the worker sees the task or this
+ * thread sees the worker.
+ */
+inline void thread_pool::notify()
+{
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (sleeping.load(std::memory_order_relaxed) > 0)
+    {
+        {
+            std::lock_guard<std::mutex> lock(sleep_mutex);
+            signals++;
+        }
+        sleep_cv.notify_one();
+    }
+}
+
+inline bool thread_pool::run_one()
+{
+    auto t = find_task(current_worker());
+    if (t == nullptr)
+    {
+        return false;
+    }
+
+    t->run();
+    delete t;
+    return true;
+}
+
+/*
+ * Own deque first, then injection queue and then other workers' deques starting from the next one.
+ * Threads that are not workers only steal.
+ */
+inline pool_task* thread_pool::find_task(std::size_t index)
+{
+    pool_task *t = nullptr;
+    if (index != no_worker)
+    {
+        t = workers[index]->deque.pop();
+        if (t == nullptr)
+        {
+            t = take_injected(index);
+        }
+    }
+
+    auto count = workers.size();
+    auto start = index != no_worker ? index + 1 : 0;
+    for (std::size_t i = 0; t == nullptr && i < count; ++i)
+    {
+        auto victim = (start + i) % count;
+        if (victim != index)
+        {
+            t = workers[victim]->deque.steal();
+        }
+    }
+
+    return t;
+}
+
+inline pool_task* thread_pool::take_injected(std::size_t index)
+{
+    if (!injected_reader_lock.try_lock())
+    {
+        return nullptr;
+    }
+
+    auto first = injected.read_all();
+    injected_reader_lock.unlock();
+
+    if (first == nullptr)
+    {
+        return nullptr;
+    }
+
+    bool pushed = false;
+    for (auto t = first->next; t != nullptr;)
+    {
+        auto next = t->next;
+        workers[index]->deque.push(t);
+        pushed = true;
+        t = next;
+    }
+
+    if (pushed)
+    {
+        notify();
+    }
+
+    return first;
+}
+
+/*
+ * Worker spins for a while looking for tasks and then sleeps until a new task is submitted.
+ * Remaining tasks are run before the worker exits.
+ */
+inline void thread_pool::worker_loop(std::size_t index)
+{
+    current().pool  = this;
+    current().index = index;
+
+    unsigned idle = 0;
+    for (;;)
+    {
+        if (run_one())
+        {
+            idle = 0;
+            continue;
+        }
+
+        if (stopping.load(std::memory_order_acquire))
+        {
+            break;
+        }
+
+        if (++idle < spin_rounds)
+        {
+            std::this_thread::yield();
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(sleep_mutex);
+        auto s = signals;
+        sleeping.fetch_add(1, std::memory_order_relaxed);
+        lock.unlock();
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        auto t = find_task(index);
+        if (t == nullptr)
+        {
+            lock.lock();
+            sleep_cv.wait(lock, [&] { return signals != s || stopping.load(std::memory_order_relaxed); });
+            lock.unlock();
+        }
+        sleeping.fetch_sub(1, std::memory_order_relaxed);
+        idle = 0;
+
+        if (t != nullptr)
+        {
+            t->run();
+            delete t;
+        }
+    }
+
+    // tasks could be left in the own deque if steals failed
+    while (auto t = workers[index]->deque.pop())
+    {
+        t->run();
+        delete t;
+    }
+}
+
+} // namespace types
@@ -0,0 +1,232 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Oleg Khryptul aka HaronK
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+// NOTE: VAR_T and VAR macros are used for testing with
+// Relacy Race Detector library:
+// http://www.1024cores.net/home/relacy-race-detector/rrd-introduction
+// http://www.1024cores.net/home/relacy-race-detector
+//
+// queue.h and node_pool.h should be included before this file.
+
+#include <memory>
+#include <type_traits>
+#include <utility>
+
+#if __cplusplus >= 201703L || (defined(_MSVC_LANG) && _MSVC_LANG >= 201703L)
+#include <optional>
+#define TYPES_HAS_OPTIONAL
+#endif
+
+#if !defined(VAR_T) || !defined(VAR)
+#define VAR_T(t) t
+#define VAR(v) v
+#define VAR_UNDEF
+#endif
+
+namespace types
+{
+
+/**
+ * Lock free queue of values for 1 writer and 1 reader threads.
+ *
+ * Non-intrusive front-end of queue: values don't need next member and are passed by value.
+ * Values are stored in nodes taken from node_pool owned by the writer, reader returns nodes to the pool
+ * in batches. Values that are not larger than InlineSize bytes are stored in the node itself so passing
+ * them doesn't allocate memory in a steady state. Larger values are allocated on the heap and the node
+ * keeps a pointer to them.
+ *
+ * Example:
+ *   value_queue<std::string> q;
+ *   q.push("text");           // writer
+ *   std::string s;
+ *   if (q.try_pop(s)) ...     // reader
+ */
+template<class T, class Wait = busy_spin_wait, std::size_t InlineSize = TYPES_CACHE_LINE_SIZE - sizeof(void*)>
+class value_queue
+{
+public:
+    using value_type = T;
+
+    static const bool is_inline = sizeof(T) <= InlineSize;
+
+    /**
+     * @param preallocate Number of nodes to allocate at startup.
+     * @param slab_size Number of nodes allocated at once when there are no free nodes.
+     */
+    explicit value_queue(std::size_t preallocate = 0, std::size_t slab_size = 64)
+        : pool(preallocate, slab_size), returns(pool)
+    {
+    }
+
+    ~value_queue();
+
+    value_queue(const value_queue&) = delete;
+    value_queue& operator=(const value_queue&) = delete;
+
+    /**
+     * Write value to the queue. Writer only method.
+     *
+     * @return true if data was send to the reader otherwise false (see queue::write()).
+     */
+    bool push(const T &value)
+    {
+        return emplace(value);
+    }
+
+    bool push(T &&value)
+    {
+        return emplace(std::move(value));
+    }
+
+    /**
+     * Construct value in the queue. Writer only method.
+     */
+    template<class... Args>
+    bool emplace(Args&&... args)
+    {
+        return impl.write(pool.allocate(std::forward<Args>(args)...));
+    }
+
+    /**
+     * Read value from the queue. Reader only method.
+     *
+     * @param value [OUT] Value to retrieve.
+     * @return true if value was retrieved otherwise false.
+     */
+    bool try_pop(T &value)
+    {
+        node *n = nullptr;
+        return impl.read(n) && take(n, value);
+    }
+
+    /**
+     * Read value from the queue waiting for it according to the wait policy. Reader only method.
+     *
+     * @return true if value was retrieved otherwise false (timeout or writer is finished and queue is empty).
+     */
+    template<class Rep, class Period>
+    bool try_pop_for(T &value, const std::chrono::duration<Rep, Period> &timeout)
+    {
+        node *n = nullptr;
+        return impl.read_for(n, timeout) && take(n, value);
+    }
+
+    /**
+     * Read value from the queue waiting for it until writer is finished. Reader only method.
+     *
+     * @return true if value was retrieved otherwise false (writer is finished and queue is empty).
+     */
+    bool pop_wait(T &value)
+    {
+        node *n = nullptr;
+        return impl.read_wait(n) && take(n, value);
+    }
+
+#ifdef TYPES_HAS_OPTIONAL
+    /**
+     * Read value from the queue. Reader only method.
+     *
+     * @return retrieved value or empty optional if queue is empty.
+     */
+    std::optional<T> pop()
+    {
+        node *n = nullptr;
+        if (!impl.read(n))
+        {
+            return std::nullopt;
+        }
+
+        std::optional<T> value(std::move(n->get()));
+        returns.deallocate(n);
+        return value;
+    }
+#endif
+
+    void set_writer_finished()
+    {
+        impl.set_writer_finished();
+    }
+
+    bool is_writer_finished()
+    {
+        return impl.is_writer_finished();
+    }
+
+private:
+    struct inline_node
+    {
+        template<class... Args>
+        explicit inline_node(Args&&... args) : value(std::forward<Args>(args)...) {}
+
+        T& get()
+        {
+            return value;
+        }
+
+        VAR_T(inline_node*) next;
+        T value;
+    };
+
+    struct boxed_node
+    {
+        template<class... Args>
+        explicit boxed_node(Args&&... args) : value(new T(std::forward<Args>(args)...)) {}
+
+        T& get()
+        {
+            return *value;
+        }
+
+        VAR_T(boxed_node*) next;
+        std::unique_ptr<T> value;
+    };
+
+    using node = typename std::conditional<is_inline, inline_node, boxed_node>::type;
+
+    bool take(node *n, T &value)
+    {
+        value = std::move(n->get());
+        returns.deallocate(n);
+        return true;
+    }
+
+    // remaining nodes are returned to the pool before the queue and the pool are destroyed
+    node_pool<node> pool;                 // writer's
+    queue<node, cache_aligned_layout, Wait> impl;
+    typename node_pool<node>::return_batch returns; // reader's
+};
+
+template<class T, class Wait, std::size_t InlineSize>
+value_queue<T, Wait, InlineSize>::~value_queue()
+{
+    impl.clear([&](node *n) { returns.deallocate(n); });
+}
+
+} // namespace types
+
+#ifdef VAR_UNDEF
+#undef VAR_T
+#undef VAR
+#undef VAR_UNDEF
+#endif
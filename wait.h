@@ -0,0 +1,370 @@
+/**
+ * The MIT License (MIT)
+ *
+ * Copyright (c) 2015 Oleg Khryptul aka HaronK
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy
+ * of this software and associated documentation files (the "Software"), to deal
+ * in the Software without restriction, including without limitation the rights
+ * to use, copy, modify, merge, publish, distribute, sublicense, and/or sell
+ * copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all
+ * copies or substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+ * IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+ * FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL THE
+ * AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+ * LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE
+ * SOFTWARE.
+ */
+
+#ifndef TYPES_WAIT_H
+#define TYPES_WAIT_H
+
+// NOTE: wait policies use std::atomic directly. They are not part of the lock free algorithms
+// and are not checked with Relacy Race Detector library.
+
+#include "platform.h"
+
+#include <atomic>
+#include <chrono>
+#include <climits>
+#include <cstdint>
+#include <thread>
+#include <type_traits>
+
+#ifdef __linux__
+#include <poll.h>
+#include <sys/eventfd.h>
+#include <unistd.h>
+#else
+#include <condition_variable>
+#include <mutex>
+#endif
+
+namespace types
+{
+
+/**
+ * Wait policies define how a reader waits for data.
+ *
+ * Each policy has 2 methods:
+ *   template<class Ready, class TimePoint> bool wait_until(Ready ready, const TimePoint &deadline);
+ *     Reader only method. Calls ready() until it returns true or deadline is reached.
+ *     Returns the last result of ready().
+ *   void notify(bool handed_off);
+ *     Writer only method. Called after each write with the write result and after writer is finished.
+ *
+ * Policy that wakes the reader only when handed_off is true should define static handoff_only = true
+ * (see is_handoff_wait). For such policies queue also passes true when reader could miss writer's queue.
+ */
+
+/**
+ * Check if wait policy wakes the reader only on handoff.
+ */
+template<class Wait, class = void>
+struct is_handoff_wait : std::false_type
+{
+};
+
+template<class Wait>
+struct is_handoff_wait<Wait, typename std::enable_if<Wait::handoff_only>::type> : std::true_type
+{
+};
+
+/**
+ * Busy spin with a pause instruction. Lowest latency but the reader burns the whole core while waiting.
+ */
+struct busy_spin_wait
+{
+    template<class Ready, class TimePoint>
+    bool wait_until(Ready ready, const TimePoint &deadline)
+    {
+        for (unsigned i = 1; !ready(); ++i)
+        {
+            if (i % 64 == 0 && TimePoint::clock::now() >= deadline)
+            {
+                return ready();
+            }
+            cpu_relax();
+        }
+        return true;
+    }
+
+    void notify(bool)
+    {
+    }
+};
+
+/**
+ * Spin for a while and then give the cpu to other threads with std::this_thread::yield().
+ */
+template<unsigned Spins = 128>
+struct spin_yield_wait
+{
+    template<class Ready, class TimePoint>
+    bool wait_until(Ready ready, const TimePoint &deadline)
+    {
+        for (unsigned i = 0; i < Spins; ++i)
+        {
+            if (ready())
+            {
+                return true;
+            }
+            cpu_relax();
+        }
+
+        while (!ready())
+        {
+            if (TimePoint::clock::now() >= deadline)
+            {
+                return ready();
+            }
+            std::this_thread::yield();
+        }
+        return true;
+    }
+
+    void notify(bool)
+    {
+    }
+};
+
+/**
+ * Check if wait policy only polls the queue and keeps no state that the writer has to signal,
+ * so the writer and the reader can be in different processes (see shm_queue.h).
+ */
+template<class Wait>
+struct is_process_agnostic_wait : std::false_type
+{
+};
+
+template<>
+struct is_process_agnostic_wait<busy_spin_wait> : std::true_type
+{
+};
+
+template<unsigned Spins>
+struct is_process_agnostic_wait<spin_yield_wait<Spins>> : std::true_type
+{
+};
+
+/**
+ * Spin for a while and then park the reader on a futex (condition variable on other platforms).
+ *
+ * Writer checks whether the reader is parked after each write and wakes it up only in this case,
+ * so the notification costs one fence and one load when nobody is waiting.
+ * Reader registers itself as parked before the last check of ready() so the wakeup can't be lost:
+ * either the reader sees the data or the writer sees the reader.
+ */
+template<unsigned Spins = 128>
+class spin_park_wait
+{
+public:
+    template<class Ready, class TimePoint>
+    bool wait_until(Ready ready, const TimePoint &deadline)
+    {
+        for (unsigned i = 0; i < Spins; ++i)
+        {
+            if (ready())
+            {
+                return true;
+            }
+            cpu_relax();
+        }
+
+        for (;;)
+        {
+            auto e = epoch.load(std::memory_order_acquire);
+
+            parked.fetch_add(1, std::memory_order_seq_cst);
+            std::atomic_thread_fence(std::memory_order_seq_cst);
+
+            if (ready())
+            {
+                parked.fetch_sub(1, std::memory_order_relaxed);
+                return true;
+            }
+
+            auto now = TimePoint::clock::now();
+            if (now >= deadline)
+            {
+                parked.fetch_sub(1, std::memory_order_relaxed);
+                return ready();
+            }
+
+            park(e, std::chrono::duration_cast<std::chrono::nanoseconds>(deadline - now));
+
+            parked.fetch_sub(1, std::memory_order_relaxed);
+
+            if (ready())
+            {
+                return true;
+            }
+        }
+    }
+
+    void notify(bool)
+    {
+        std::atomic_thread_fence(std::memory_order_seq_cst);
+
+        if (parked.load(std::memory_order_relaxed) != 0)
+        {
+            epoch.fetch_add(1, std::memory_order_release);
+            unpark();
+        }
+    }
+
+private:
+#ifdef __linux__
+    void park(std::uint32_t e, std::chrono::nanoseconds timeout)
+    {
+        static_assert(sizeof(epoch) == sizeof(std::uint32_t), "futex requires 32 bit value");
+
+        struct timespec ts;
+        ts.tv_sec  = static_cast<time_t>(timeout.count() / 1000000000);
+        ts.tv_nsec = static_cast<long>(timeout.count() % 1000000000);
+        futex_wait(&epoch, e, &ts);
+    }
+
+    void unpark()
+    {
+        futex_wake(&epoch, INT_MAX);
+    }
+#else
+    void park(std::uint32_t e, std::chrono::nanoseconds timeout)
+    {
+        std::unique_lock<std::mutex> lock(mutex);
+        cv.wait_for(lock, timeout, [&] { return epoch.load(std::memory_order_acquire) != e; });
+    }
+
+    void unpark()
+    {
+        std::lock_guard<std::mutex> lock(mutex);
+        cv.notify_all();
+    }
+
+    std::mutex mutex;
+    std::condition_variable cv;
+#endif
+
+    std::atomic<std::uint32_t> epoch{0};
+    std::atomic<std::uint32_t> parked{0};
+};
+
+#ifdef __linux__
+
+/**
+ * Notification via eventfd for readers that run in an event loop (epoll, poll, select).
+ *
+ * Writer signals the eventfd only when it hands its segment to the empty reader (write() returns true),
+ * so notifications are coalesced and the reader gets one wakeup per segment instead of one per element.
+ * Reader should consume the notification with reset() and then read until read() returns false:
+ * after that the next element is always signalled.
+ *
+ * Example:
+ *   epoll_ctl(ep, EPOLL_CTL_ADD, q.get_wait_policy().fd(), &ev); // EPOLLIN
+ *   ...
+ *   q.get_wait_policy().reset();                                 // when fd is readable
+ *   while (q.read(data)) process(data);
+ *
+ * read_for() and read_wait() spin and then block in poll().
+ */
+template<unsigned Spins = 128>
+class eventfd_wait
+{
+public:
+    static const bool handoff_only = true;
+
+    eventfd_wait() : efd(eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC))
+    {
+    }
+
+    ~eventfd_wait()
+    {
+        if (efd >= 0)
+        {
+            close(efd);
+        }
+    }
+
+    eventfd_wait(const eventfd_wait&) = delete;
+    eventfd_wait& operator=(const eventfd_wait&) = delete;
+
+    /**
+     * Descriptor that becomes readable when there is data to read. -1 if eventfd can't be created.
+     */
+    int fd() const
+    {
+        return efd;
+    }
+
+    /**
+     * Consume pending notifications. Reader only method.
+     *
+     * @return number of notifications since the last call.
+     */
+    std::uint64_t reset()
+    {
+        std::uint64_t count = 0;
+        if (::read(efd, &count, sizeof(count)) != sizeof(count))
+        {
+            count = 0;
+        }
+        return count;
+    }
+
+    template<class Ready, class TimePoint>
+    bool wait_until(Ready ready, const TimePoint &deadline)
+    {
+        for (unsigned i = 0; i < Spins; ++i)
+        {
+            if (ready())
+            {
+                return true;
+            }
+            cpu_relax();
+        }
+
+        while (!ready())
+        {
+            auto now = TimePoint::clock::now();
+            if (now >= deadline)
+            {
+                return ready();
+            }
+
+            auto ms = std::chrono::duration_cast<std::chrono::milliseconds>(deadline - now).count() + 1;
+
+            struct pollfd pfd = { efd, POLLIN, 0 };
+            poll(&pfd, 1, ms < INT_MAX ? static_cast<int>(ms) : -1);
+            reset();
+        }
+        return true;
+    }
+
+    void notify(bool handed_off)
+    {
+        if (handed_off)
+        {
+            std::uint64_t one = 1;
+            if (::write(efd, &one, sizeof(one)) != sizeof(one))
+            {
+                // counter overflow, reader has pending notification anyway
+            }
+        }
+    }
+
+private:
+    int efd;
+};
+
+#endif
+
+} // namespace types
+
+#endif // TYPES_WAIT_H
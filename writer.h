@@ -36,11 +36,52 @@ class writer
 public:
     writer(const std::shared_ptr<T> &impl) : impl(impl) {}
 
-    bool write(typename T::pointer data)
+    bool write(const typename T::pointer &data)
     {
         return impl->write(data);
     }
 
+    /**
+     * Value queues (ring_queue, mpmc_queue) move the data only if it was written, otherwise it stays with the caller.
+     */
+    bool write(typename T::pointer &&data)
+    {
+        return impl->write(std::move(data));
+    }
+
+    template<class Q = T>
+    auto try_write(typename Q::pointer data) -> decltype(std::declval<Q&>().try_write(data))
+    {
+        return impl->try_write(data);
+    }
+
+    template<class Function, class Q = T>
+    auto try_write(typename Q::pointer data, Function dispose) -> decltype(std::declval<Q&>().try_write(data, dispose))
+    {
+        return impl->try_write(data, dispose);
+    }
+
+    template<class Rep, class Period>
+    bool write_for(typename T::pointer data, const std::chrono::duration<Rep, Period> &timeout)
+    {
+        return impl->write_for(data, timeout);
+    }
+
+    bool write_batch(typename T::pointer first, typename T::pointer last)
+    {
+        return impl->write_batch(first, last);
+    }
+
+    bool flush()
+    {
+        return impl->flush();
+    }
+
+    bool flush_if_due()
+    {
+        return impl->flush_if_due();
+    }
+
     void set_writer_finished()
     {
         impl->set_writer_finished();